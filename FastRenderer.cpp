@@ -19,15 +19,18 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -64,9 +67,11 @@ namespace dmrender
     /// Shadow cascades store world-space distance; see the note where they are created.
     constexpr ImageFormat kShadowFormat = ImageFormat::R32_FLOAT;
 
-    /// Buffer slots. Slot 0 is geometry by convention; 1 is per-pass state; 2 is instances.
+    /// Buffer slots. Slot 0 is geometry by convention; 1 is per-pass state; 2 is instances; 3
+    /// is the VertexBlock grids, bound only for a scene in the compact vertex layout.
     constexpr uint32_t kFrameSlot = 1;
     constexpr uint32_t kInstanceSlot = 2;
+    constexpr uint32_t kVertexBlockSlot = 3;
     /// Texture slot the cascade array is bound to. 0 is albedo, 1 is the normal map.
     constexpr uint32_t kShadowSlot = 2;
 
@@ -131,8 +136,8 @@ namespace dmrender
     static_assert(sizeof(DrawConstants) <= kMaxPushConstantBytes,
                   "DrawConstants must fit the guaranteed push constant range");
 
-    /// 80 bytes. One per drawn copy; this viewer draws the scene once, but the mechanism is what
-    /// the vertex shader is written against.
+    /// 80 bytes. One per drawn copy: the identity for everything drawn where it stands, and one
+    /// per copy of an instanced subset.
     struct InstanceData {
         float model[16];
         float tint[4];
@@ -276,6 +281,95 @@ namespace dmrender
         return true;
     }
 
+    /// @brief The same test for a bounding sphere, which is what clusters carry.
+    bool insideFrustum(const std::array<Plane, 6>& planes, const float center[3], float radius)
+    {
+        for (const Plane& p : planes) {
+            if (p.nx * center[0] + p.ny * center[1] + p.nz * center[2] + p.d < -radius) return false;
+        }
+        return true;
+    }
+
+    /// @brief Whether every triangle of @p cluster faces away from an eye at @p eye.
+    bool facesAway(const MeshCluster& cluster, const Vec3& eye)
+    {
+        const float dx = cluster.center[0] - eye.x;
+        const float dy = cluster.center[1] - eye.y;
+        const float dz = cluster.center[2] - eye.z;
+        const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        return dx * cluster.coneAxis[0] + dy * cluster.coneAxis[1] + dz * cluster.coneAxis[2] >=
+               cluster.coneCutoff * distance + cluster.radius;
+    }
+
+    /**
+     * @brief Adds an index range to an indirect command list.
+     *
+     * Extends the last command instead when the range continues it. Ranges arrive in
+     * index-buffer order, so a run of neighbours that all survive culling occupies one contiguous
+     * range of indices and is drawn as a single command. Worth doing on both backends, but it is
+     * not a micro-optimisation on Metal: an indirect draw there executes exactly one command, so
+     * the length of the list is the number of draw calls issued.
+     *
+     * Commands before @p mergeFrom belong to another draw, with its own material, and are never
+     * extended even when the ranges happen to meet. Nor is a command with a different
+     * @p vertexOffset: a 16-bit subset's indices mean nothing without its own base vertex.
+     */
+    void appendIndexRange(std::vector<DrawIndexedIndirectCommand>& commands,
+                          uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset,
+                          size_t mergeFrom = 0)
+    {
+        if (commands.size() > mergeFrom) {
+            DrawIndexedIndirectCommand& last = commands.back();
+            if (last.vertexOffset == vertexOffset && last.firstInstance == 0 &&
+                last.firstIndex + last.indexCount == firstIndex) {
+                last.indexCount += indexCount;
+                return;
+            }
+        }
+        DrawIndexedIndirectCommand command{};
+        command.indexCount = indexCount;
+        command.instanceCount = 1;
+        // In indices here, unlike drawIndexed()'s byte offset. The two APIs disagree and each
+        // setter follows its own.
+        command.firstIndex = firstIndex;
+        command.vertexOffset = vertexOffset;
+        command.firstInstance = 0;
+        commands.push_back(command);
+    }
+
+    /**
+     * @brief Adds one instance of an index range to a list of instanced draws.
+     *
+     * Extends the last draw instead when it has the same range and ends at the instance before.
+     * A subset's instances are stored in Morton order of where they stand, so neighbours that
+     * survive culling at the same level become one draw of several instances. Draws before
+     * @p mergeFrom belong to another subset.
+     *
+     * The list is issued with drawIndexed(), not indirectly: a nonzero firstInstance in an
+     * indirect command is an optional device feature on Vulkan.
+     */
+    void appendInstance(std::vector<DrawIndexedIndirectCommand>& draws, uint32_t firstIndex,
+                        uint32_t indexCount, int32_t vertexOffset, uint32_t instance,
+                        size_t mergeFrom)
+    {
+        if (draws.size() > mergeFrom) {
+            DrawIndexedIndirectCommand& last = draws.back();
+            if (last.firstIndex == firstIndex && last.indexCount == indexCount &&
+                last.vertexOffset == vertexOffset &&
+                last.firstInstance + last.instanceCount == instance) {
+                ++last.instanceCount;
+                return;
+            }
+        }
+        DrawIndexedIndirectCommand draw{};
+        draw.indexCount = indexCount;
+        draw.instanceCount = 1;
+        draw.firstIndex = firstIndex;
+        draw.vertexOffset = vertexOffset;
+        draw.firstInstance = instance;
+        draws.push_back(draw);
+    }
+
     // Declared here rather than with the rest of the camera code below, because
     // computeCascades() fits its volumes to the camera frustum and needs the type.
     struct Camera {
@@ -473,6 +567,14 @@ namespace dmrender
         MaterialBlendMode blendMode = MaterialBlendMode::Opaque;
         bool     twoSided = false;
         float    viewDepth = 0.0f;
+        /// The subset's surviving clusters, as a run of the frame's indirect commands. Zero
+        /// commands means the whole subset is drawn directly.
+        uint32_t firstCommand = 0;
+        uint32_t commandCount = 0;
+        uint32_t indexCount = 0;   ///< What those commands draw.
+        /// The commands are a run of the frame's instanced draws instead: the subset's visible
+        /// copies.
+        bool     instanced = false;
     };
 
     struct FrameStats {
@@ -481,11 +583,16 @@ namespace dmrender
         uint32_t materialChanges = 0;
         uint32_t subsetsVisible = 0;
         uint32_t subsetsCulled = 0;
+        uint32_t clustersCulled = 0;
+        uint32_t instancesCulled = 0;
+        uint64_t trianglesCulled = 0;
         uint64_t trianglesSubmitted = 0;
+        uint64_t trianglesSavedByLod = 0;   ///< Full detail minus what the chosen levels drew.
         uint32_t shadowDraws = 0;
         uint32_t shadowSkipped = 0;
         uint32_t shadowIndirectCalls = 0;
         uint64_t shadowTriangles = 0;
+        uint64_t shadowTrianglesSavedByLod = 0;
         /// Commands actually issued after merging neighbours. On a backend without
         /// multi-draw-indirect this is the number of draw calls the shadow pass costs.
         uint32_t shadowCommands = 0;
@@ -547,44 +654,75 @@ namespace dmrender
     {
         using Clock = std::chrono::steady_clock;
 
-        // ── Load the scene before opening a window: nothing to show without one ──
+        const auto processStart = Clock::now();
+        auto secondsSinceStart = [&]() {
+            return std::chrono::duration<double>(Clock::now() - processStart).count();
+        };
+
+        // ── Load the scene on a thread of its own ──
+        //
+        // A large scene takes a minute to parse the first time and several seconds from the
+        // cache. Spent before the window opens, that minute is a terminal and nothing else, which
+        // reads as a hang; spent behind a progress bar, it is a load.
         const std::filesystem::path modelPath = resolveModelPath();
         std::fprintf(stderr, "Loading %s\n", modelPath.string().c_str());
 
-        Mesh mesh;
-        const auto loadStart = Clock::now();
-        const bool fromCache = loadSceneCache(modelPath, mesh);
-
-        if (!fromCache) {
-            std::string loadError;
-            mesh = loadMesh(modelPath, loadError);
-            if (mesh.empty()) {
-                std::fprintf(stderr, "Failed to load model: %s\n", loadError.c_str());
-                return;
-            }
-            // Parsing a gigabyte of text OBJ is a minute of work; writing the result back turns
-            // every subsequent start into three large reads.
-            if (saveSceneCache(modelPath, mesh)) {
-                std::fprintf(stderr, "Wrote cache: %s\n",
-                             sceneCachePath(modelPath).filename().string().c_str());
-            }
-        }
-        const double loadSeconds = std::chrono::duration<double>(Clock::now() - loadStart).count();
+        // The loader fills loadedMesh and nothing else; this thread draws `mesh`, and takes the
+        // loaded one over only once loadDone says the loader has let go of it.
+        Mesh loadedMesh;
+        LoadProgress loadProgress;
+        std::atomic<bool> loadDone{ false };
+        bool fromCache = false;
+        std::string loadError;
+        double loadSeconds = 0.0;
 
-        std::fprintf(stderr,
-                     "%s: %s, %zu vertices, %zu triangles, %zu subsets, %zu materials\n"
-                     "  geometry %.0f MiB, loaded in %.2f s%s\n",
-                     modelPath.filename().string().c_str(), mesh.sourceFormat.c_str(),
-                     mesh.vertices.size(), mesh.indices.size() / 3,
-                     mesh.subsets.size(), mesh.materials.size(),
-                     mesh.geometryBytes() / 1048576.0, loadSeconds,
-                     fromCache ? " (from cache)" : "");
+        // ── Preview: the reader's output, drawn while the load passes run on the real thing ──
+        //
+        // On a cold load of a large scene the passes take as long as the parse, and until they
+        // finish there is nothing to draw but a bar. The reader's subsets are already a complete
+        // scene, only an unoptimised one, so they go up as soon as it is done and are replaced
+        // when the passes are. Not for captures, which should show the scene they were asked for,
+        // and off with DMRENDER_NOPREVIEW for a machine that cannot hold the geometry twice.
+        Mesh previewMesh;
+        std::atomic<bool> previewReady{ false };
+        if (!std::getenv("DMRENDER_SCREENSHOT") && !std::getenv("DMRENDER_NOPREVIEW")) {
+            loadProgress.preview = [&](Mesh&& preview) {
+                previewMesh = std::move(preview);
+                previewReady = true;
+            };
+        }
 
-        const Vec3 sceneCenter{ mesh.center()[0], mesh.center()[1], mesh.center()[2] };
-        const float sceneExtent = std::max(mesh.boundsExtent(), 1e-3f);
-        std::fprintf(stderr, "  bounds (%.2f %.2f %.2f) .. (%.2f %.2f %.2f), extent %.2f\n",
-                     mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2],
-                     mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2], sceneExtent);
+        std::thread loader([&] {
+            const auto loadStart = Clock::now();
+            try {
+                loadProgress.phase = "cache";
+                fromCache = loadSceneCache(modelPath, loadedMesh);
+                if (!fromCache) {
+                    loadedMesh = loadMesh(modelPath, loadError, &loadProgress);
+                    // Parsing a gigabyte of text OBJ is a minute of work; writing the result back
+                    // turns every subsequent start into three large reads.
+                    if (!loadedMesh.empty()) {
+                        loadProgress.phase = "writing cache";
+                        if (saveSceneCache(modelPath, loadedMesh)) {
+                            std::fprintf(stderr, "Wrote cache: %s\n",
+                                         sceneCachePath(modelPath).filename().string().c_str());
+                        }
+                    }
+                }
+            } catch (const std::exception& e) {
+                // An exception leaving a std::thread ends the process; carry it back instead.
+                loadedMesh = Mesh{};
+                loadError = e.what();
+            }
+            loadSeconds = std::chrono::duration<double>(Clock::now() - loadStart).count();
+            loadDone = true;
+        });
+        // Every way out of this function waits for the loader first: a std::thread destroyed
+        // while still running ends the process.
+        struct JoinOnExit {
+            std::thread& thread;
+            ~JoinOnExit() { if (thread.joinable()) thread.join(); }
+        } joinLoader{ loader };
 
         // ── Window and device ──
         if (!glfwInit()) return;
@@ -609,6 +747,137 @@ namespace dmrender
         glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
         helper::initImgui(swapChain);
 
+        // ── Loading screen, until the loader is done or has a preview ──
+        //
+        // Only the interface is drawn, over a clear: the pipelines, buffers and even the shaders
+        // all depend on what the scene turns out to need. Closing the window here still waits
+        // for the loader, which cannot be interrupted, but then exits without building anything.
+        double windowUpSeconds = 0.0;
+        /// @return false when there was nothing to draw into, as while the window is minimised.
+        auto drawLoadingFrame = [&](const char* phase, float fraction) -> bool {
+            std::shared_ptr<GImage> target = swapChain->acquireNextImage();
+            if (!target || swapChain->width() == 0 || swapChain->height() == 0) return false;
+
+            ClearValue clear{};
+            clear.color[0] = 0.42f; clear.color[1] = 0.55f;
+            clear.color[2] = 0.75f; clear.color[3] = 1.0f;
+            std::shared_ptr<RenderPassDescriptor> uiPass = helper::createRenderPassDescriptor();
+            uiPass->setColorAttachment(0, target, /*clear=*/true, clear);
+
+            helper::newFrameImgui(uiPass);
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            {
+                const ImVec2 display = ImGui::GetIO().DisplaySize;
+                ImGui::SetNextWindowPos(ImVec2(display.x * 0.5f, display.y * 0.5f),
+                                        ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+                ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_Always);
+                ImGui::Begin("Loading", nullptr,
+                             ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove |
+                             ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings);
+                ImGui::Text("%s", modelPath.filename().string().c_str());
+                ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), phase);
+                ImGui::Text("%.1f s", secondsSinceStart());
+                ImGui::End();
+            }
+            ImGui::Render();
+
+            std::shared_ptr<CommandBuffer> cmd = helper::createCommandBuffer(queue);
+            cmd->beginRenderPass(uiPass);
+            helper::renderInternalImgui(cmd);
+            cmd->endRenderPass();
+            cmd->present(target);
+            cmd->commit();
+
+            if (windowUpSeconds == 0.0) {
+                windowUpSeconds = secondsSinceStart();
+                std::fprintf(stderr, "Window up %.2f s after start\n", windowUpSeconds);
+            }
+            return true;
+        };
+
+        while (!loadDone && !previewReady) {
+            glfwPollEvents();
+            if (glfwWindowShouldClose(window)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            // Without an image to draw into nothing paces the loop, and it would spin a core
+            // against the loader until the window came back; wait for events a while instead.
+            if (!drawLoadingFrame(loadProgress.phase.load(), loadProgress.fraction.load())) {
+                glfwWaitEventsTimeout(0.05);
+            }
+        }
+
+        // Drawn from the preview until the loader finishes; see swapInLoadedMesh().
+        bool provisional = !loadDone;
+        Mesh mesh;
+        if (provisional) {
+            mesh = std::move(previewMesh);
+            std::fprintf(stderr, "Preview: %zu triangles in %zu subsets, drawn while the load passes run\n",
+                         mesh.triangleCount(), mesh.subsets.size());
+        } else {
+            loader.join();
+            mesh = std::move(loadedMesh);
+        }
+        previewMesh = Mesh{};
+
+        auto closeWindow = [&]() {
+            helper::shutdownImgui();
+            ImGui_ImplGlfw_Shutdown();
+            ImGui::DestroyContext();
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        };
+        if (mesh.empty()) {
+            std::fprintf(stderr, "Failed to load model: %s\n", loadError.c_str());
+            closeWindow();
+            return;
+        }
+        if (glfwWindowShouldClose(window)) {
+            closeWindow();
+            return;
+        }
+
+        /// The finished load, once: now, or when it replaces the preview.
+        auto reportScene = [&]() {
+            std::fprintf(stderr,
+                         "%s: %s, %zu vertices of %zu bytes, %zu triangles, %zu subsets, %zu materials\n"
+                         "  geometry %.0f MiB, loaded in %.2f s%s, resident %.0f MiB (peak %.0f MiB)\n",
+                         modelPath.filename().string().c_str(), mesh.sourceFormat.c_str(),
+                         mesh.vertices.size(),
+                         mesh.compactVertices.empty() ? sizeof(MeshVertex) : sizeof(CompactVertex),
+                         mesh.triangleCount(),
+                         mesh.subsets.size(), mesh.materials.size(),
+                         mesh.geometryBytes() / 1048576.0, loadSeconds,
+                         fromCache ? " (from cache)" : "",
+                         currentResidentBytes() / 1048576.0, peakResidentBytes() / 1048576.0);
+
+            // Where the time went: what a slow start on someone else's machine gets triaged from.
+            const LoadStats& stats = mesh.loadStats;
+            std::fprintf(stderr, "  phases:");
+            for (size_t i = 0; i < stats.phases.size(); ++i) {
+                std::fprintf(stderr, "%s %s %.2f s", i ? "," : "",
+                             stats.phases[i].name.c_str(), stats.phases[i].seconds);
+            }
+            std::fprintf(stderr, "\n  read %.1f MiB", stats.bytesRead / 1048576.0);
+            if (stats.cornersRead > 0) {
+                std::fprintf(stderr, ", %zu corners deduplicated to %zu vertices",
+                             stats.cornersRead, stats.verticesAfterDedup);
+            }
+            std::fprintf(stderr, "\n");
+        };
+        if (!provisional) reportScene();
+
+        const Vec3 sceneCenter{ mesh.center()[0], mesh.center()[1], mesh.center()[2] };
+        const float sceneExtent = std::max(mesh.boundsExtent(), 1e-3f);
+        std::fprintf(stderr, "  bounds (%.2f %.2f %.2f) .. (%.2f %.2f %.2f), extent %.2f\n",
+                     mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2],
+                     mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2], sceneExtent);
+
+        // Texture decoding blocks this thread; one more frame says so instead of freezing the bar.
+        drawLoadingFrame("textures", 1.0f);
+
         // ── Textures ──
         // Decoding runs across every core; uploading stays here. A quarter of a gigabyte of PNG
         // takes long enough that doing it serially would be the slowest part of startup.
@@ -630,6 +899,7 @@ namespace dmrender
         }
         const double textureSeconds =
             std::chrono::duration<double>(Clock::now() - textureStart).count();
+        mesh.loadStats.add("textures", textureSeconds);
 
         std::fprintf(stderr, "Textures: %zu loaded, %.0f MiB, %.2f s",
                      textures.count(), textures.uploadedBytes() / 1048576.0, textureSeconds);
@@ -646,16 +916,21 @@ namespace dmrender
         // MTL can only declare a mask through `map_d`, and San Miguel's file does not use it at
         // all: its foliage carries the mask in the alpha channel of the albedo image. The file
         // says nothing, so the pixels have to. This is the one classification that cannot be made
-        // at parse time, and getting it wrong draws every leaf as an opaque rectangle.
-        uint32_t promotedToCutout = 0;
-        for (MeshMaterial& material : mesh.materials) {
-            if (material.blendMode == MaterialBlendMode::Opaque &&
-                textures.hasVaryingAlpha(material.albedoTexture)) {
-                material.blendMode = MaterialBlendMode::Cutout;
-                material.twoSided = true;
-                ++promotedToCutout;
+        // at parse time, and getting it wrong draws every leaf as an opaque rectangle. Applied
+        // again to the loaded mesh when it replaces the preview, whose materials it shares.
+        auto promoteMaskedMaterials = [&]() {
+            uint32_t promoted = 0;
+            for (MeshMaterial& material : mesh.materials) {
+                if (material.blendMode == MaterialBlendMode::Opaque &&
+                    textures.hasVaryingAlpha(material.albedoTexture)) {
+                    material.blendMode = MaterialBlendMode::Cutout;
+                    material.twoSided = true;
+                    ++promoted;
+                }
             }
-        }
+            return promoted;
+        };
+        const uint32_t promotedToCutout = promoteMaskedMaterials();
         if (promotedToCutout > 0) {
             std::fprintf(stderr,
                          "Materials: %u promoted to alpha-cutout by inspecting texture alpha\n",
@@ -663,26 +938,81 @@ namespace dmrender
         }
 
         // ── Geometry in video memory ──
-        std::shared_ptr<GBuffer> vertexBuffer = device->createBuffer(
-            BufferType::Vertex, BufferUsage::Static,
-            mesh.vertices.size() * sizeof(MeshVertex), mesh.vertices.data(), "SceneVertices");
-        std::shared_ptr<GBuffer> indexBuffer = device->createBuffer(
-            BufferType::Index, BufferUsage::Static,
-            mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), "SceneIndices");
-        if (!vertexBuffer || !indexBuffer) {
-            std::fprintf(stderr, "Failed to create geometry buffers (out of memory?)\n");
-            return;
-        }
-
-        // One instance, identity transform: the scene is already in world space. The mechanism
-        // stays because the vertex shader is written against it, and it costs 80 bytes.
-        InstanceData instance{};
-        const Mat4 modelMatrix = identity();
-        std::copy(modelMatrix.begin(), modelMatrix.end(), instance.model);
-        instance.tint[0] = instance.tint[1] = instance.tint[2] = instance.tint[3] = 1.0f;
-        std::shared_ptr<GBuffer> instanceBuffer = device->createBuffer(
-            BufferType::Storage, BufferUsage::Static,
-            sizeof(InstanceData), &instance, "SceneInstances");
+        // In the compact layout when the load produced one; the CPU-side vertices stay 24 bytes.
+        // Uploaded again when the loaded mesh replaces the preview; a frame still in flight
+        // keeps the buffers it bound, as it keeps a sampler rebuildSampler() has replaced.
+        bool compactVertices = false;
+        std::shared_ptr<GBuffer> vertexBuffer;
+        std::shared_ptr<GBuffer> vertexBlockBuffer;
+        // Two index buffers when narrowIndices() ran: the subsets that fit in 16 bits, and the
+        // rest. Either can be empty, and an empty one is not created.
+        std::shared_ptr<GBuffer> indexBuffer;
+        std::shared_ptr<GBuffer> index16Buffer;
+        std::shared_ptr<GBuffer> instanceBuffer;
+        auto uploadGeometry = [&]() -> bool {
+            compactVertices = !mesh.compactVertices.empty();
+            vertexBuffer = compactVertices
+                ? device->createBuffer(BufferType::Vertex, BufferUsage::Static,
+                                       mesh.compactVertices.size() * sizeof(CompactVertex),
+                                       mesh.compactVertices.data(), "SceneVertices")
+                : device->createBuffer(BufferType::Vertex, BufferUsage::Static,
+                                       mesh.vertices.size() * sizeof(MeshVertex),
+                                       mesh.vertices.data(), "SceneVertices");
+            vertexBlockBuffer = compactVertices
+                ? device->createBuffer(BufferType::Storage, BufferUsage::Static,
+                                       mesh.vertexBlocks.size() * sizeof(VertexBlock),
+                                       mesh.vertexBlocks.data(), "SceneVertexBlocks")
+                : nullptr;
+            indexBuffer = mesh.indices.empty() ? nullptr
+                : device->createBuffer(BufferType::Index, BufferUsage::Static,
+                                       mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(),
+                                       "SceneIndices");
+            index16Buffer = mesh.indices16.empty() ? nullptr
+                : device->createBuffer(BufferType::Index, BufferUsage::Static,
+                                       mesh.indices16.size() * sizeof(uint16_t), mesh.indices16.data(),
+                                       "SceneIndices16");
+
+            // Instance 0 is the identity, for every subset that is drawn once where it stands:
+            // the scene is already in world space. The copies findInstances() found follow it,
+            // so the instance of Mesh::instances[k] is k + 1.
+            std::vector<InstanceData> instances(1 + mesh.instances.size());
+            for (size_t k = 0; k < instances.size(); ++k) {
+                InstanceData& instance = instances[k];
+                Mat4 modelMatrix = identity();
+                if (k > 0) {
+                    const float* rows = mesh.instances[k - 1].transform;
+                    for (int row = 0; row < 3; ++row) {
+                        for (int column = 0; column < 4; ++column) modelMatrix[column * 4 + row] = rows[row * 4 + column];
+                    }
+                }
+                std::copy(modelMatrix.begin(), modelMatrix.end(), instance.model);
+                instance.tint[0] = instance.tint[1] = instance.tint[2] = instance.tint[3] = 1.0f;
+            }
+            instanceBuffer = device->createBuffer(
+                BufferType::Storage, BufferUsage::Static,
+                instances.size() * sizeof(InstanceData), instances.data(), "SceneInstances");
+
+            if (!vertexBuffer || (compactVertices && !vertexBlockBuffer) ||
+                (!mesh.indices.empty() && !indexBuffer) ||
+                (!mesh.indices16.empty() && !index16Buffer) || !instanceBuffer) {
+                std::fprintf(stderr, "Failed to create geometry buffers (out of memory?)\n");
+                return false;
+            }
+            return true;
+        };
+        if (!uploadGeometry()) return;
+
+        /// Where a subset's indices are and how to read them. Its clusters and levels are in the
+        /// same place.
+        struct IndexRun {
+            std::shared_ptr<GBuffer> buffer;
+            IndexType type;
+            size_t indexSize;
+        };
+        auto indexRunOf = [&](const MeshSubset& subset) -> IndexRun {
+            return subset.index16 ? IndexRun{ index16Buffer, IndexType::UInt16, sizeof(uint16_t) }
+                                  : IndexRun{ indexBuffer, IndexType::UInt32, sizeof(uint32_t) };
+        };
 
         std::shared_ptr<GBuffer> frameBuffer = device->createBuffer(
             BufferType::Uniform, BufferUsage::Dynamic,
@@ -705,27 +1035,40 @@ namespace dmrender
         rebuildSampler(static_cast<uint32_t>(anisotropy));
 
         // ── Shaders ──
+        // The vertex stages follow the vertex layout, so they are loaded again if the loaded
+        // mesh's layout differs from the preview's.
         const std::filesystem::path shaderPath = std::filesystem::path(SHADER_DIR) / "Mesh";
-        std::shared_ptr<ShaderFunction> vertexFunction =
-            helper::createShaderFunction(device, shaderPath, "mesh_vertex_shader");
+        const std::filesystem::path shadowShaderPath =
+            std::filesystem::path(SHADER_DIR) / "MeshShadow";
+        std::shared_ptr<ShaderFunction> vertexFunction;
+        std::shared_ptr<ShaderFunction> shadowVertexFunction;
+        auto loadVertexFunctions = [&]() -> bool {
+            vertexFunction = helper::createShaderFunction(
+                device, shaderPath, compactVertices ? "mesh_vertex_compact" : "mesh_vertex_shader");
+            shadowVertexFunction = helper::createShaderFunction(
+                device, shadowShaderPath, compactVertices ? "shadow_vertex_compact" : "shadow_vertex_shader");
+            if (!vertexFunction || !shadowVertexFunction) {
+                std::fprintf(stderr, "Failed to load vertex shaders from %s\n", SHADER_DIR);
+                return false;
+            }
+            return true;
+        };
+        if (!loadVertexFunctions()) return;
+
         std::shared_ptr<ShaderFunction> fragmentFunction =
             helper::createShaderFunction(device, shaderPath, "mesh_fragment_shader");
         std::shared_ptr<ShaderFunction> maskedFunction =
             helper::createShaderFunction(device, shaderPath, "mesh_fragment_masked");
-        if (!vertexFunction || !fragmentFunction || !maskedFunction) {
+        if (!fragmentFunction || !maskedFunction) {
             std::fprintf(stderr, "Failed to load shaders from %s\n", shaderPath.string().c_str());
             return;
         }
 
-        const std::filesystem::path shadowShaderPath =
-            std::filesystem::path(SHADER_DIR) / "MeshShadow";
-        std::shared_ptr<ShaderFunction> shadowVertexFunction =
-            helper::createShaderFunction(device, shadowShaderPath, "shadow_vertex_shader");
         std::shared_ptr<ShaderFunction> shadowFragmentFunction =
             helper::createShaderFunction(device, shadowShaderPath, "shadow_fragment_shader");
         std::shared_ptr<ShaderFunction> shadowMaskedFunction =
             helper::createShaderFunction(device, shadowShaderPath, "shadow_fragment_masked");
-        if (!shadowVertexFunction || !shadowFragmentFunction || !shadowMaskedFunction) {
+        if (!shadowFragmentFunction || !shadowMaskedFunction) {
             std::fprintf(stderr, "Failed to load shadow shaders from %s\n",
                          shadowShaderPath.string().c_str());
             return;
@@ -767,6 +1110,19 @@ namespace dmrender
                 ? std::strtof(std::getenv("DMRENDER_CASTER_CULL"), nullptr)
                 : 1.0f;
 
+        /**
+         * @brief Largest error, in pixels, a subset's simplified level may show on screen.
+         *
+         * A level is drawn once its error, projected at the subset's nearest point, falls below
+         * this. One pixel is the point at which the change stops being visible in a still frame;
+         * in motion, somewhat more passes unnoticed. The shadow pass applies the same test with
+         * shadow-map texels in place of pixels.
+         */
+        float lodPixelError =
+            std::getenv("DMRENDER_LOD_PIXELS")
+                ? std::strtof(std::getenv("DMRENDER_LOD_PIXELS"), nullptr)
+                : 1.0f;
+
         const SampleCount maxSamples = device->maxSupportedSampleCount();
         const SampleCount msaaSamples =
             static_cast<uint32_t>(maxSamples) >= 4 ? SampleCount::Four : maxSamples;
@@ -797,6 +1153,7 @@ namespace dmrender
 
                 desc.bufferSlots = defaultBufferSlotLayout();
                 desc.bufferSlots[kInstanceSlot] = BufferBindingType::Storage;
+                if (compactVertices) desc.bufferSlots[kVertexBlockSlot] = BufferBindingType::Storage;
                 desc.debugName = "ShadowPipeline";
 
                 std::shared_ptr<Pipeline> shadowPipeline = helper::createPipeline(device, desc);
@@ -830,6 +1187,7 @@ namespace dmrender
 
             desc.bufferSlots = defaultBufferSlotLayout();
             desc.bufferSlots[kInstanceSlot] = BufferBindingType::Storage;
+            if (compactVertices) desc.bufferSlots[kVertexBlockSlot] = BufferBindingType::Storage;
             desc.debugName = "ScenePipeline";
 
             std::shared_ptr<Pipeline> created = helper::createPipeline(device, desc);
@@ -838,7 +1196,7 @@ namespace dmrender
         };
 
         // Build every variant the scene needs up front, so no frame pays for a compile.
-        {
+        auto buildPipelines = [&]() {
             const auto buildStart = Clock::now();
             for (bool multisampled : { false, true }) {
                 if (multisampled && msaaSamples == SampleCount::One) continue;
@@ -852,7 +1210,8 @@ namespace dmrender
             pipelineFor({ MaterialBlendMode::Cutout, false, false, true });
             std::fprintf(stderr, "Pipelines: %zu variants in %.2f s\n", pipelines.size(),
                          std::chrono::duration<double>(Clock::now() - buildStart).count());
-        }
+        };
+        buildPipelines();
 
         // ── Shadow maps ──
         //
@@ -919,25 +1278,30 @@ namespace dmrender
          *
          * Masked casters still go one at a time. Each needs its own albedo texture bound, and an
          * indirect batch shares one binding across every command in it.
+         *
+         * An indirect call reads one index buffer, so casters with 16-bit indices get a list of
+         * their own and a second call. Copies of an instanced subset are drawn directly, as runs
+         * of instances, each run with the subset it belongs to.
          */
         struct ShadowList {
             std::vector<DrawIndexedIndirectCommand> opaque;
+            std::vector<DrawIndexedIndirectCommand> opaque16;
             std::vector<uint32_t> maskedSubsets;
+            std::vector<DrawIndexedIndirectCommand> instanced;
+            std::vector<uint32_t> instancedSubsets;
         };
         std::vector<ShadowList> shadowLists(kCascadeCount);
         /// Whether every cascade layer has been rendered into at least once.
         bool shadowMapsInitialised = false;
 
         // All four cascades' commands in one buffer, written once a frame and selected by
-        // offset — the same reason the pass uniforms are laid out that way.
-        const size_t shadowCommandStride =
-            mesh.subsets.size() * sizeof(DrawIndexedIndirectCommand);
-        std::vector<DrawIndexedIndirectCommand> shadowCommandStaging(
-            mesh.subsets.size() * kCascadeCount);
-        std::shared_ptr<GBuffer> shadowCommands = device->createBuffer(
-            BufferType::Indirect, BufferUsage::Dynamic,
-            shadowCommandStaging.size() * sizeof(DrawIndexedIndirectCommand),
-            nullptr, "ShadowDrawCommands");
+        // offset — the same reason the pass uniforms are laid out that way. A cascade issues at
+        // most one command per subset, or per cluster when casters are culled by cluster. Sized
+        // by sizeCommandBuffers(), below, with the camera pass's commands.
+        size_t shadowCommandsPerCascade = 0;
+        size_t shadowCommandStride = 0;
+        std::vector<DrawIndexedIndirectCommand> shadowCommandStaging;
+        std::shared_ptr<GBuffer> shadowCommands;
 
         std::fprintf(stderr, "Shadows: %u cascades at %ux%u, %.0f MiB\n",
                      kCascadeCount, shadowResolution, shadowResolution,
@@ -993,7 +1357,8 @@ namespace dmrender
                          budget.nativeAllocationCount,
                          vertexBuffer->memoryLocation() == MemoryLocation::DeviceLocal
                              ? "VRAM" : "host memory",
-                         indexBuffer->memoryLocation() == MemoryLocation::DeviceLocal
+                         (indexBuffer ? indexBuffer : index16Buffer)->memoryLocation() ==
+                                 MemoryLocation::DeviceLocal
                              ? "VRAM" : "host memory");
         }
 
@@ -1061,6 +1426,8 @@ namespace dmrender
 
         bool  useMsaa = msaaSamples != SampleCount::One;
         bool  cullingEnabled = true;
+        bool  clusterCullingEnabled = !mesh.clusters.empty();
+        bool  lodEnabled = !mesh.lods.empty();
         bool  sortingEnabled = true;
         float exposure = 1.15f;
         float sunAzimuth = -0.6f;
@@ -1088,34 +1455,166 @@ namespace dmrender
         drawItems.reserve(mesh.subsets.size());
         FrameStats stats;
 
+        // The camera pass's surviving clusters, as indirect commands. Built by buildDrawList()
+        // and uploaded by recordScene(), inside the frame, for the reason given where the
+        // screenshot path renders: a dynamic buffer has one region per frame in flight.
+        // At most one command per cluster, or one per subset drawn at a coarser level.
+        std::vector<DrawIndexedIndirectCommand> drawCommandStaging;
+        std::shared_ptr<GBuffer> drawCommands;
+        /// Both command buffers, for the scene now in `mesh`.
+        auto sizeCommandBuffers = [&]() -> bool {
+            const size_t maxDrawCommands = std::max({ mesh.clusters.size(), mesh.subsets.size(), size_t(1) });
+            drawCommandStaging.reserve(maxDrawCommands);
+            drawCommands = device->createBuffer(
+                BufferType::Indirect, BufferUsage::Dynamic,
+                maxDrawCommands * sizeof(DrawIndexedIndirectCommand),
+                nullptr, "SceneDrawCommands");
+
+            shadowCommandsPerCascade = std::max({ mesh.subsets.size(), mesh.clusters.size(), size_t(1) });
+            shadowCommandStride = shadowCommandsPerCascade * sizeof(DrawIndexedIndirectCommand);
+            shadowCommandStaging.assign(shadowCommandsPerCascade * kCascadeCount, DrawIndexedIndirectCommand{});
+            shadowCommands = device->createBuffer(
+                BufferType::Indirect, BufferUsage::Dynamic,
+                shadowCommandStaging.size() * sizeof(DrawIndexedIndirectCommand),
+                nullptr, "ShadowDrawCommands");
+            if (!drawCommands || !shadowCommands) {
+                std::fprintf(stderr, "Failed to create draw command buffers\n");
+                return false;
+            }
+            return true;
+        };
+        if (!sizeCommandBuffers()) return;
+        // Instanced subsets' visible copies, issued directly; see appendInstance().
+        std::vector<DrawIndexedIndirectCommand> instanceDraws;
+
+        /// @brief The coarsest level of @p subset whose error is within @p maxError world
+        /// units, or null for full detail.
+        auto selectLod = [&](const MeshSubset& subset, float maxError) -> const MeshLod* {
+            if (!lodEnabled) return nullptr;
+            for (uint32_t l = subset.lodCount; l-- > 0;) {
+                const MeshLod& lod = mesh.lods[subset.firstLod + l];
+                if (lod.error <= maxError) return &lod;
+            }
+            return nullptr;
+        };
+
         // Culling, sorting and recording, factored out so the offscreen capture path below and
         // the interactive loop cannot drift apart — a screenshot that does not match what the
         // window shows would be worse than no screenshot at all.
-        auto buildDrawList = [&](const Mat4& viewProjection, const Vec3& eye) {
+        auto buildDrawList = [&](const Mat4& viewProjection, const Vec3& eye, float fovY, float viewportHeight) {
             drawItems.clear();
+            drawCommandStaging.clear();
+            instanceDraws.clear();
             const std::array<Plane, 6> planes = extractFrustumPlanes(viewProjection);
+            // World units per pixel at unit distance, times the pixels a level may be off by.
+            const float lodAllowed = lodPixelError * 2.0f * std::tan(fovY * 0.5f) / viewportHeight;
 
             for (uint32_t i = 0; i < mesh.subsets.size(); ++i) {
                 const MeshSubset& subset = mesh.subsets[i];
                 if (subset.indexCount == 0) continue;
 
-                if (cullingEnabled && !insideFrustum(planes, subset.boundsMin, subset.boundsMax)) {
+                // An instanced subset's bounds are its shape's, not any copy's; its copies are
+                // tested below instead.
+                if (cullingEnabled && subset.instanceCount == 0 &&
+                    !insideFrustum(planes, subset.boundsMin, subset.boundsMax)) {
                     ++stats.subsetsCulled;
+                    stats.trianglesCulled += subset.indexCount / 3;
                     continue;
                 }
 
                 DrawItem item;
                 item.subsetIndex = i;
                 item.materialIndex = subset.materialIndex;
+                item.indexCount = subset.indexCount;
                 if (subset.materialIndex >= 0 &&
                     subset.materialIndex < static_cast<int32_t>(mesh.materials.size())) {
                     const MeshMaterial& material = mesh.materials[subset.materialIndex];
                     item.blendMode = material.blendMode;
                     item.twoSided = material.twoSided;
                 }
-
                 const std::array<float, 3> center = subset.center();
                 item.viewDepth = length(Vec3{ center[0], center[1], center[2] } - eye);
+
+                // Copies are culled and given a level one by one, exactly as separate subsets
+                // would be. Their clusters go unused: the spheres and cones are the shape's.
+                if (subset.instanceCount > 0) {
+                    item.instanced = true;
+                    item.firstCommand = static_cast<uint32_t>(instanceDraws.size());
+                    item.indexCount = 0;
+                    item.viewDepth = std::numeric_limits<float>::max();
+                    for (uint32_t k = 0; k < subset.instanceCount; ++k) {
+                        const MeshInstance& instance = mesh.instances[subset.firstInstance + k];
+                        if (cullingEnabled && !insideFrustum(planes, instance.center, instance.radius)) {
+                            ++stats.instancesCulled;
+                            stats.trianglesCulled += subset.indexCount / 3;
+                            continue;
+                        }
+                        const float distance =
+                            length(Vec3{ instance.center[0], instance.center[1], instance.center[2] } - eye);
+                        item.viewDepth = std::min(item.viewDepth, distance);
+                        // The levels' errors are in the shape's units, and a copy is scaled.
+                        const float nearest = distance - instance.radius;
+                        const MeshLod* lod =
+                            nearest > 0.0f ? selectLod(subset, lodAllowed * nearest / instance.scale) : nullptr;
+                        const uint32_t firstIndex = lod ? lod->firstIndex : subset.firstIndex;
+                        const uint32_t indexCount = lod ? lod->indexCount : subset.indexCount;
+                        appendInstance(instanceDraws, firstIndex, indexCount,
+                                       static_cast<int32_t>(subset.baseVertex), 1 + subset.firstInstance + k,
+                                       item.firstCommand);
+                        item.indexCount += indexCount;
+                        stats.trianglesSavedByLod += (subset.indexCount - indexCount) / 3;
+                    }
+                    item.commandCount = static_cast<uint32_t>(instanceDraws.size()) - item.firstCommand;
+                    if (item.commandCount == 0) {
+                        ++stats.subsetsCulled;
+                        continue;
+                    }
+                    drawItems.push_back(item);
+                    ++stats.subsetsVisible;
+                    continue;
+                }
+
+                // Far away, a coarser level looks the same and is drawn whole. The error is
+                // projected from the nearest point of the bounding sphere, so a subset the eye is
+                // inside of always gets full detail. Clusters belong to the full level only, so a
+                // subset drawn at a coarser one is not culled further.
+                const float nearest = item.viewDepth - subset.radius();
+                const MeshLod* lod = nearest > 0.0f ? selectLod(subset, lodAllowed * nearest) : nullptr;
+                if (lod) {
+                    item.firstCommand = static_cast<uint32_t>(drawCommandStaging.size());
+                    item.commandCount = 1;
+                    item.indexCount = lod->indexCount;
+                    appendIndexRange(drawCommandStaging, lod->firstIndex, lod->indexCount,
+                                     static_cast<int32_t>(subset.baseVertex), item.firstCommand);
+                    stats.trianglesSavedByLod += (subset.indexCount - lod->indexCount) / 3;
+                }
+                // A visible subset is rarely visible whole. Its clusters are tested again, and
+                // for one-sided materials also against their normal cones: a cluster that faces
+                // entirely away would be discarded by the rasteriser anyway, after its vertices
+                // had been shaded.
+                else if (clusterCullingEnabled && subset.clusterCount > 0) {
+                    item.firstCommand = static_cast<uint32_t>(drawCommandStaging.size());
+                    item.indexCount = 0;
+                    for (uint32_t c = 0; c < subset.clusterCount; ++c) {
+                        const MeshCluster& cluster = mesh.clusters[subset.firstCluster + c];
+                        if ((cullingEnabled && !insideFrustum(planes, cluster.center, cluster.radius)) ||
+                            (!item.twoSided && facesAway(cluster, eye))) {
+                            ++stats.clustersCulled;
+                            stats.trianglesCulled += cluster.indexCount / 3;
+                            continue;
+                        }
+                        appendIndexRange(drawCommandStaging, cluster.firstIndex, cluster.indexCount,
+                                         static_cast<int32_t>(subset.baseVertex), item.firstCommand);
+                        item.indexCount += cluster.indexCount;
+                    }
+                    item.commandCount =
+                        static_cast<uint32_t>(drawCommandStaging.size()) - item.firstCommand;
+                    if (item.commandCount == 0) {
+                        ++stats.subsetsCulled;
+                        continue;
+                    }
+                }
+
                 drawItems.push_back(item);
                 ++stats.subsetsVisible;
             }
@@ -1206,9 +1705,17 @@ namespace dmrender
             Pipeline* boundPipeline = nullptr;
             int32_t boundMaterial = -2;
 
+            if (!drawCommandStaging.empty()) {
+                drawCommands->update(drawCommandStaging.data(),
+                                     drawCommandStaging.size() * sizeof(DrawIndexedIndirectCommand));
+            }
+
             auto bindShared = [&]() {
                 cmd->setVertexBuffer(0, vertexBuffer);
                 cmd->setStorageBuffer(kInstanceSlot, ShaderStage::Vertex, instanceBuffer);
+                if (vertexBlockBuffer) {
+                    cmd->setStorageBuffer(kVertexBlockSlot, ShaderStage::Vertex, vertexBlockBuffer);
+                }
                 cmd->setUniformBuffer(kFrameSlot, ShaderStage::Vertex, frameBuffer);
                 cmd->setUniformBuffer(kFrameSlot, ShaderStage::Fragment, frameBuffer);
             };
@@ -1279,11 +1786,28 @@ namespace dmrender
                 cmd->setPushConstants(ShaderStage::Fragment, &constants, sizeof(constants));
 
                 const MeshSubset& subset = mesh.subsets[item.subsetIndex];
-                cmd->drawIndexed(indexBuffer, IndexType::UInt32, subset.indexCount, 1,
-                                 subset.firstIndex * sizeof(uint32_t), 0, 0);
-
-                ++stats.drawCalls;
-                stats.trianglesSubmitted += subset.indexCount / 3;
+                const IndexRun run = indexRunOf(subset);
+                if (item.instanced) {
+                    for (uint32_t c = 0; c < item.commandCount; ++c) {
+                        const DrawIndexedIndirectCommand& draw = instanceDraws[item.firstCommand + c];
+                        cmd->drawIndexed(run.buffer, run.type, draw.indexCount, draw.instanceCount,
+                                         draw.firstIndex * run.indexSize, draw.vertexOffset,
+                                         draw.firstInstance);
+                    }
+                    stats.drawCalls += item.commandCount;
+                } else if (item.commandCount > 0) {
+                    cmd->drawIndexedIndirect(run.buffer, run.type, drawCommands,
+                                             item.commandCount,
+                                             item.firstCommand * sizeof(DrawIndexedIndirectCommand));
+                    // Counted per command: on Metal each one is a draw call of its own.
+                    stats.drawCalls += item.commandCount;
+                } else {
+                    cmd->drawIndexed(run.buffer, run.type, subset.indexCount, 1,
+                                     subset.firstIndex * run.indexSize,
+                                     static_cast<int32_t>(subset.baseVertex), 0);
+                    ++stats.drawCalls;
+                }
+                stats.trianglesSubmitted += item.indexCount / 3;
             }
         };
 
@@ -1298,7 +1822,10 @@ namespace dmrender
             for (uint32_t c = 0; c < kCascadeCount; ++c) {
                 ShadowList& list = shadowLists[c];
                 list.opaque.clear();
+                list.opaque16.clear();
                 list.maskedSubsets.clear();
+                list.instanced.clear();
+                list.instancedSubsets.clear();
 
                 const Cascade& cascade = cascades[c];
                 const std::array<Plane, 6> lightPlanes =
@@ -1316,6 +1843,32 @@ namespace dmrender
                     // Glass casting a solid shadow looks worse than glass casting none.
                     if (material && material->blendMode == MaterialBlendMode::Transparent) continue;
 
+                    // Copies one by one, under the same tests as whole subsets below.
+                    if (subset.instanceCount > 0) {
+                        const bool masked = material && material->blendMode == MaterialBlendMode::Cutout;
+                        const size_t mergeFrom = list.instanced.size();
+                        for (uint32_t k = 0; k < subset.instanceCount; ++k) {
+                            const MeshInstance& instance = mesh.instances[subset.firstInstance + k];
+                            if (!insideFrustum(lightPlanes, instance.center, instance.radius)) continue;
+                            if (instance.radius < cascade.texelWorldSize * shadowCasterCullTexels) {
+                                ++stats.shadowSkipped;
+                                continue;
+                            }
+                            const MeshLod* lod = masked ? nullptr
+                                : selectLod(subset, lodPixelError * cascade.texelWorldSize / instance.scale);
+                            const uint32_t firstIndex = lod ? lod->firstIndex : subset.firstIndex;
+                            const uint32_t indexCount = lod ? lod->indexCount : subset.indexCount;
+                            appendInstance(list.instanced, firstIndex, indexCount,
+                                           static_cast<int32_t>(subset.baseVertex),
+                                           1 + subset.firstInstance + k, mergeFrom);
+                            list.instancedSubsets.resize(list.instanced.size(), i);
+                            stats.shadowTriangles += indexCount / 3;
+                            stats.shadowTrianglesSavedByLod += (subset.indexCount - indexCount) / 3;
+                            ++stats.shadowDraws;
+                        }
+                        continue;
+                    }
+
                     if (!insideFrustum(lightPlanes, subset.boundsMin, subset.boundsMax)) continue;
 
                     // A caster smaller than the texel it would land in cannot produce a shadow
@@ -1327,48 +1880,51 @@ namespace dmrender
                         continue;
                     }
 
+                    // The projection is orthographic, so the texel size alone decides the level:
+                    // detail finer than a texel cannot show in the map. Masked casters are drawn
+                    // one by one from their subset's own range, so they keep full detail.
+                    const MeshLod* lod = selectLod(subset, lodPixelError * cascade.texelWorldSize);
+                    std::vector<DrawIndexedIndirectCommand>& opaque =
+                        subset.index16 ? list.opaque16 : list.opaque;
+                    const int32_t baseVertex = static_cast<int32_t>(subset.baseVertex);
+
                     if (material && material->blendMode == MaterialBlendMode::Cutout) {
                         list.maskedSubsets.push_back(i);
+                        stats.shadowTriangles += subset.indexCount / 3;
+                    } else if (lod) {
+                        appendIndexRange(opaque, lod->firstIndex, lod->indexCount, baseVertex);
+                        stats.shadowTriangles += lod->indexCount / 3;
+                        stats.shadowTrianglesSavedByLod += (subset.indexCount - lod->indexCount) / 3;
+                    } else if (clusterCullingEnabled && subset.clusterCount > 0) {
+                        // Frustum only, no cones: the shadow pass culls no faces, for the reason
+                        // given on its pipeline.
+                        for (uint32_t c = 0; c < subset.clusterCount; ++c) {
+                            const MeshCluster& cluster = mesh.clusters[subset.firstCluster + c];
+                            if (!insideFrustum(lightPlanes, cluster.center, cluster.radius)) continue;
+                            appendIndexRange(opaque, cluster.firstIndex, cluster.indexCount, baseVertex);
+                            stats.shadowTriangles += cluster.indexCount / 3;
+                        }
                     } else {
-                        DrawIndexedIndirectCommand command{};
-                        command.indexCount = subset.indexCount;
-                        command.instanceCount = 1;
-                        // In indices here, unlike drawIndexed()'s byte offset. The two APIs
-                        // disagree and each setter follows its own.
-                        command.firstIndex = subset.firstIndex;
-                        command.vertexOffset = 0;
-                        command.firstInstance = 0;
-
-                        // Subsets are visited in index-buffer order, so a run of neighbours that
-                        // all survive culling occupies one contiguous range of indices and can be
-                        // drawn as a single command. Worth doing on both backends, but it is not
-                        // a micro-optimisation on Metal: an indirect draw there executes exactly
-                        // one command, so the length of this list is the number of draw calls the
-                        // pass issues. The shadow pipeline binds nothing per subset, which is what
+                        // Subsets are visited in index-buffer order, so neighbours merge into one
+                        // command. The shadow pipeline binds nothing per subset, which is what
                         // makes merging legal — the masked casters above cannot be merged for
                         // exactly that reason, since each needs its own albedo.
-                        bool merged = false;
-                        if (!list.opaque.empty()) {
-                            DrawIndexedIndirectCommand& last = list.opaque.back();
-                            if (last.vertexOffset == command.vertexOffset &&
-                                last.firstInstance == command.firstInstance &&
-                                last.firstIndex + last.indexCount == command.firstIndex) {
-                                last.indexCount += command.indexCount;
-                                merged = true;
-                            }
-                        }
-                        if (!merged) list.opaque.push_back(command);
+                        appendIndexRange(opaque, subset.firstIndex, subset.indexCount, baseVertex);
+                        stats.shadowTriangles += subset.indexCount / 3;
                     }
 
                     ++stats.shadowDraws;
-                    stats.shadowTriangles += subset.indexCount / 3;
                 }
             }
 
             for (uint32_t c = 0; c < kCascadeCount; ++c) {
-                std::copy(shadowLists[c].opaque.begin(), shadowLists[c].opaque.end(),
-                          shadowCommandStaging.begin() + mesh.subsets.size() * c);
-                stats.shadowCommands += static_cast<uint32_t>(shadowLists[c].opaque.size());
+                // The 16-bit list follows the 32-bit one in the cascade's region; between them
+                // they hold at most one command per subset or cluster, as the region assumes.
+                const ShadowList& list = shadowLists[c];
+                auto region = shadowCommandStaging.begin() + shadowCommandsPerCascade * c;
+                std::copy(list.opaque16.begin(), list.opaque16.end(),
+                          std::copy(list.opaque.begin(), list.opaque.end(), region));
+                stats.shadowCommands += static_cast<uint32_t>(list.opaque.size() + list.opaque16.size());
             }
             shadowCommands->update(shadowCommandStaging.data(),
                                    shadowCommandStaging.size() *
@@ -1408,22 +1964,34 @@ namespace dmrender
             auto bindShared = [&]() {
                 cmd->setVertexBuffer(0, vertexBuffer);
                 cmd->setStorageBuffer(kInstanceSlot, ShaderStage::Vertex, instanceBuffer);
+                if (vertexBlockBuffer) {
+                    cmd->setStorageBuffer(kVertexBlockSlot, ShaderStage::Vertex, vertexBlockBuffer);
+                }
                 cmd->setUniformBuffer(kFrameSlot, ShaderStage::Vertex, shadowUniforms,
                                       uniformOffset);
                 cmd->setUniformBuffer(kFrameSlot, ShaderStage::Fragment, shadowUniforms,
                                       uniformOffset);
             };
 
-            // Everything without a mask, as a single call. The GPU reads the per-draw arguments
-            // out of the buffer; the CPU never touches them again.
-            if (!list.opaque.empty()) {
+            // Everything without a mask, as one call per index buffer. The GPU reads the per-draw
+            // arguments out of the buffer; the CPU never touches them again.
+            if (!list.opaque.empty() || !list.opaque16.empty()) {
                 cmd->setRenderPipeline(pipelineFor({ MaterialBlendMode::Opaque, false, false, true }));
                 bindShared();
+            }
+            if (!list.opaque.empty()) {
                 cmd->drawIndexedIndirect(indexBuffer, IndexType::UInt32, shadowCommands,
                                          static_cast<uint32_t>(list.opaque.size()),
                                          shadowCommandStride * cascadeIndex);
                 ++stats.shadowIndirectCalls;
             }
+            if (!list.opaque16.empty()) {
+                cmd->drawIndexedIndirect(index16Buffer, IndexType::UInt16, shadowCommands,
+                                         static_cast<uint32_t>(list.opaque16.size()),
+                                         shadowCommandStride * cascadeIndex +
+                                             list.opaque.size() * sizeof(DrawIndexedIndirectCommand));
+                ++stats.shadowIndirectCalls;
+            }
 
             // Masked casters one at a time: each needs its own albedo bound, and an indirect
             // batch shares one binding across every command in it.
@@ -1447,11 +2015,50 @@ namespace dmrender
                                               sizeof(constants));
                     }
 
-                    cmd->drawIndexed(indexBuffer, IndexType::UInt32, subset.indexCount, 1,
-                                     subset.firstIndex * sizeof(uint32_t), 0, 0);
+                    const IndexRun run = indexRunOf(subset);
+                    cmd->drawIndexed(run.buffer, run.type, subset.indexCount, 1,
+                                     subset.firstIndex * run.indexSize,
+                                     static_cast<int32_t>(subset.baseVertex), 0);
                 }
             }
 
+            // Instanced casters, a draw per run of neighbouring copies. The masked ones need
+            // their albedo like any other masked caster.
+            int boundMasked = -1;
+            int32_t boundMaterial = -2;
+            for (size_t d = 0; d < list.instanced.size(); ++d) {
+                const MeshSubset& subset = mesh.subsets[list.instancedSubsets[d]];
+                const MeshMaterial* material =
+                    (subset.materialIndex >= 0 &&
+                     subset.materialIndex < static_cast<int32_t>(mesh.materials.size()))
+                        ? &mesh.materials[subset.materialIndex] : nullptr;
+                const bool masked = material && material->blendMode == MaterialBlendMode::Cutout;
+
+                if (static_cast<int>(masked) != boundMasked) {
+                    cmd->setRenderPipeline(pipelineFor({ masked ? MaterialBlendMode::Cutout
+                                                                : MaterialBlendMode::Opaque,
+                                                         false, false, true }));
+                    bindShared();
+                    boundMasked = masked;
+                    boundMaterial = -2;
+                }
+                if (masked && subset.materialIndex != boundMaterial) {
+                    cmd->setTexture(0, ShaderStage::Fragment,
+                                    textures.get(material->albedoTexture, true), sampler);
+                    boundMaterial = subset.materialIndex;
+
+                    DrawConstants constants{};
+                    constants.material[2] = alphaCutoff;
+                    cmd->setPushConstants(ShaderStage::Fragment, &constants, sizeof(constants));
+                }
+
+                const IndexRun run = indexRunOf(subset);
+                const DrawIndexedIndirectCommand& draw = list.instanced[d];
+                cmd->drawIndexed(run.buffer, run.type, draw.indexCount, draw.instanceCount,
+                                 draw.firstIndex * run.indexSize, draw.vertexOffset,
+                                 draw.firstInstance);
+            }
+
             cmd->endRenderPass();
         };
 
@@ -1478,7 +2085,10 @@ namespace dmrender
                 // defined layout. One clear-only round gives it that.
                 for (ShadowList& list : shadowLists) {
                     list.opaque.clear();
+                    list.opaque16.clear();
                     list.maskedSubsets.clear();
+                    list.instanced.clear();
+                    list.instancedSubsets.clear();
                 }
             } else {
                 return;
@@ -1606,7 +2216,8 @@ namespace dmrender
                                            sceneExtent * shadowDistanceFraction,
                                            currentSunDirection(), float(shadowResolution),
                                            sceneExtent * 0.5f);
-                buildDrawList(shotViewProjection, shotCamera.position);
+                buildDrawList(shotViewProjection, shotCamera.position, shotCamera.fovY,
+                              static_cast<float>(shotHeight));
 
                 // The per-frame uploads belong *inside* the repeat, not before it.
                 //
@@ -1709,14 +2320,19 @@ namespace dmrender
                                                    rgba.data(),
                                                    static_cast<int>(shotWidth) * 4);
                 std::fprintf(stderr,
-                             "Screenshot %s: %s | %u draws, %u/%u subsets, %.2f M tris",
+                             "Screenshot %s: %s | %u draws, %u/%u subsets, %.2f M tris (%.2f M culled)",
                              outPath.c_str(), written ? "ok" : "FAILED",
                              shotStats.drawCalls, shotStats.subsetsVisible,
                              shotStats.subsetsVisible + shotStats.subsetsCulled,
-                             shotStats.trianglesSubmitted / 1e6);
+                             shotStats.trianglesSubmitted / 1e6, shotStats.trianglesCulled / 1e6);
                 std::fprintf(stderr, " | shadow %u casters -> %u commands, %.2f M tris",
                              shotStats.shadowDraws, shotStats.shadowCommands,
                              shotStats.shadowTriangles / 1e6);
+                if (lodEnabled) {
+                    std::fprintf(stderr, " | LOD saved %.2f M + %.2f M shadow tris",
+                                 shotStats.trianglesSavedByLod / 1e6,
+                                 shotStats.shadowTrianglesSavedByLod / 1e6);
+                }
                 if (benchFrames > 0) {
                     std::fprintf(stderr, " | %.2f ms/frame (%.0f FPS)",
                                  frameMilliseconds, 1000.0 / std::max(frameMilliseconds, 1e-6));
@@ -1724,16 +2340,48 @@ namespace dmrender
                 std::fprintf(stderr, "\n");
             }
 
-            helper::shutdownImgui();
-            ImGui_ImplGlfw_Shutdown();
-            ImGui::DestroyContext();
-            glfwDestroyWindow(window);
-            glfwTerminate();
+            closeWindow();
             return;
         }
 
+        /**
+         * @brief Replaces the preview with the mesh the load passes finished, between frames.
+         *
+         * The bounds are the same — the passes regroup and re-encode the geometry but never move
+         * it — so the camera, the clip planes and the textures all carry over. What follows the
+         * mesh is rebuilt: its buffers, and its vertex shaders and pipelines if the passes chose
+         * the compact layout. If the passes failed, the preview stays up.
+         */
+        auto swapInLoadedMesh = [&]() {
+            loader.join();
+            if (loadedMesh.empty()) {
+                std::fprintf(stderr, "Load passes failed (%s); keeping the preview\n", loadError.c_str());
+                return;
+            }
+            mesh = std::move(loadedMesh);
+            mesh.loadStats.add("textures", textureSeconds);
+            promoteMaskedMaterials();
+
+            const bool wasCompact = compactVertices;
+            if (!uploadGeometry() || !sizeCommandBuffers() ||
+                (compactVertices != wasCompact && !loadVertexFunctions())) {
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+                return;
+            }
+            if (compactVertices != wasCompact) pipelines.clear();
+            buildPipelines();
+            clusterCullingEnabled = !mesh.clusters.empty();
+            lodEnabled = !mesh.lods.empty();
+
+            reportScene();
+            std::fprintf(stderr, "Optimised scene in place %.2f s after start\n", secondsSinceStart());
+        };
+
         double lastTime = glfwGetTime();
         float smoothedDelta = 1.0f / 60.0f;
+        // Time to the first frame with the scene in it, preview or not; windowUpSeconds is the
+        // loading screen's.
+        double sceneFrameSeconds = 0.0;
 
         // DMRENDER_FRAMES=N closes the window after N frames. Killing the process instead skips
         // shutdown entirely, which is exactly where a validation layer tends to have something
@@ -1754,6 +2402,11 @@ namespace dmrender
         {
             glfwPollEvents();
 
+            if (provisional && loadDone) {
+                provisional = false;
+                swapInLoadedMesh();
+            }
+
             if (framesRemaining > 0 && --framesRemaining == 0) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
@@ -1798,7 +2451,7 @@ namespace dmrender
                                        sceneExtent * shadowDistanceFraction,
                                        currentSunDirection(), float(shadowResolution),
                                        sceneExtent * 0.5f);
-            buildDrawList(viewProjection, camera.position);
+            buildDrawList(viewProjection, camera.position, camera.fovY, static_cast<float>(fbHeight));
 
             // ── Per-pass uniforms ──
             fillFrameUniforms(viewProjection, camera.position, camera.forward());
@@ -1817,8 +2470,12 @@ namespace dmrender
                 ImGui::Begin("Scene");
 
                 ImGui::Text("%s", modelPath.filename().string().c_str());
+                if (provisional) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.85f, 0.4f, 1.0f), "Preview: %s, %.0f%%",
+                                       loadProgress.phase.load(), loadProgress.fraction.load() * 100.0f);
+                }
                 ImGui::Text("%s | %.2f M tris | %zu subsets",
-                            mesh.sourceFormat.c_str(), mesh.indices.size() / 3.0 / 1e6,
+                            mesh.sourceFormat.c_str(), mesh.triangleCount() / 1e6,
                             mesh.subsets.size());
                 ImGui::Text("%zu materials | %zu textures",
                             mesh.materials.size(), textures.count());
@@ -1826,18 +2483,41 @@ namespace dmrender
                     ImGui::TextColored(ImVec4(1.0f, 0.4f, 1.0f, 1.0f), "%zu textures missing",
                                        textures.missingCount());
                 }
+                if (ImGui::TreeNode("LoadStats", "Loaded in %.2f s%s", mesh.loadStats.seconds,
+                                    mesh.loadStats.fromCache ? " from cache" : "")) {
+                    const LoadStats& load = mesh.loadStats;
+                    for (const LoadStats::Phase& phase : load.phases) {
+                        ImGui::Text("%-10s %8.3f s", phase.name.c_str(), phase.seconds);
+                    }
+                    ImGui::Text("Read %.1f MiB", load.bytesRead / 1048576.0);
+                    if (load.cornersRead > 0) {
+                        ImGui::Text("%.2f M corners -> %.2f M vertices",
+                                    load.cornersRead / 1e6, load.verticesAfterDedup / 1e6);
+                    }
+                    ImGui::Text("Resident %.0f MiB, peak %.0f MiB",
+                                load.residentBytes / 1048576.0, load.peakResidentBytes / 1048576.0);
+                    ImGui::Text("Window up %.2f s, scene drawn %.2f s",
+                                windowUpSeconds, sceneFrameSeconds);
+                    ImGui::TreePop();
+                }
 
                 ImGui::Separator();
                 ImGui::Text("%.1f FPS (%.2f ms)", ImGui::GetIO().Framerate,
                             1000.0f / std::max(ImGui::GetIO().Framerate, 1e-3f));
                 ImGui::Text("Draws %u | pipeline changes %u | material changes %u",
                             stats.drawCalls, stats.pipelineChanges, stats.materialChanges);
-                ImGui::Text("Subsets %u drawn / %u culled",
-                            stats.subsetsVisible, stats.subsetsCulled);
-                ImGui::Text("Triangles submitted %.2f M", stats.trianglesSubmitted / 1e6);
-                ImGui::Text("Shadow %u casters (%u too small), %.2f M tris",
+                ImGui::Text("Subsets %u drawn / %u culled, %u clusters culled (%.2f M tris)",
+                            stats.subsetsVisible, stats.subsetsCulled, stats.clustersCulled,
+                            stats.trianglesCulled / 1e6);
+                if (!mesh.instances.empty()) {
+                    ImGui::Text("  %zu instances, %u culled", mesh.instances.size(),
+                                stats.instancesCulled);
+                }
+                ImGui::Text("Triangles submitted %.2f M (%.2f M saved by LOD)",
+                            stats.trianglesSubmitted / 1e6, stats.trianglesSavedByLod / 1e6);
+                ImGui::Text("Shadow %u casters (%u too small), %.2f M tris (%.2f M saved by LOD)",
                             stats.shadowDraws, stats.shadowSkipped,
-                            stats.shadowTriangles / 1e6);
+                            stats.shadowTriangles / 1e6, stats.shadowTrianglesSavedByLod / 1e6);
                 // What a command costs depends on the backend: with multi-draw-indirect the GPU
                 // walks the list itself, without it each command is a separate draw call.
                 ImGui::Text("  %u cascades, %u indirect calls, %u casters merged to %u commands",
@@ -1893,6 +2573,15 @@ namespace dmrender
                 ImGui::Checkbox("Frustum culling", &cullingEnabled);
                 ImGui::SameLine();
                 ImGui::Checkbox("Sorting", &sortingEnabled);
+                if (!mesh.clusters.empty()) {
+                    ImGui::Checkbox("Cluster culling (frustum + normal cones)", &clusterCullingEnabled);
+                }
+                if (!mesh.lods.empty()) {
+                    ImGui::Checkbox("LOD", &lodEnabled);
+                    ImGui::SameLine();
+                    ImGui::SliderFloat("Max error (px)", &lodPixelError, 0.25f, 8.0f, "%.2f",
+                                       ImGuiSliderFlags_Logarithmic);
+                }
                 ImGui::SliderFloat("Alpha cutoff", &alphaCutoff, 0.05f, 0.95f);
 
                 ImGui::Separator();
@@ -1943,12 +2632,14 @@ namespace dmrender
 
             cmd->present(target);
             cmd->commit();
+
+            if (sceneFrameSeconds == 0.0) {
+                sceneFrameSeconds = secondsSinceStart();
+                std::fprintf(stderr, "Scene drawn %.2f s after start%s (window up at %.2f s)\n",
+                             sceneFrameSeconds, provisional ? ", as a preview" : "", windowUpSeconds);
+            }
         }
 
-        helper::shutdownImgui();
-        ImGui_ImplGlfw_Shutdown();
-        ImGui::DestroyContext();
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        closeWindow();
     }
 }
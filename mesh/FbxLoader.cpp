@@ -21,13 +21,17 @@
 //
 
 #include "Mesh.hpp"
+#include "LoadSupport.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -42,28 +46,129 @@ namespace dmrender {
         // ─────────────────────────────────────────────────────────────────────
 
         /**
-         * @brief One property of a record, normalised to three storage shapes.
+         * @class FbxArena
+         * @brief Storage for one file's tree, handed out in order and released all at once.
+         *
+         * A parsed FBX is tens of thousands of small objects — a record, its properties, its list
+         * of children — that are made during one walk and all dropped when loadFbx() returns.
+         * From the heap each costs an allocation and a free; carved out of large blocks each
+         * costs a pointer bump, and dropping the blocks frees the lot. Nothing in here is ever
+         * destroyed on its own, so only trivially destructible types may be placed in it.
+         */
+        class FbxArena {
+        public:
+            template <typename T>
+            T* allocate(size_t count)
+            {
+                static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+                if (count == 0) return nullptr;
+                const size_t bytes = count * sizeof(T);
+                size_t padding = (alignof(T) - reinterpret_cast<uintptr_t>(m_next) % alignof(T)) % alignof(T);
+                if (padding + bytes > m_left) {
+                    // An oversized request gets a block of its own rather than wasting the rest
+                    // of a fresh standard one.
+                    const size_t blockBytes = std::max(kBlockBytes, bytes + alignof(T));
+                    m_blocks.emplace_back(new uint8_t[blockBytes]);
+                    m_next = m_blocks.back().get();
+                    m_left = blockBytes;
+                    padding = (alignof(T) - reinterpret_cast<uintptr_t>(m_next) % alignof(T)) % alignof(T);
+                }
+                T* items = reinterpret_cast<T*>(m_next + padding);
+                m_next += padding + bytes;
+                m_left -= padding + bytes;
+                for (size_t i = 0; i < count; ++i) new (items + i) T();
+                return items;
+            }
+
+        private:
+            static constexpr size_t kBlockBytes = size_t(1) << 18;
+            std::vector<std::unique_ptr<uint8_t[]>> m_blocks;
+            uint8_t* m_next = nullptr;
+            size_t m_left = 0;
+        };
+
+        /// @brief A run of objects in an FbxArena: a vector's reading half, without the ownership.
+        template <typename T>
+        struct FbxSpan {
+            T* items = nullptr;
+            size_t count = 0;
+
+            T* begin() const { return items; }
+            T* end() const { return items + count; }
+            size_t size() const { return count; }
+            bool empty() const { return count == 0; }
+            T& operator[](size_t index) const { return items[index]; }
+        };
+
+        size_t arrayElementSize(char type)
+        {
+            return (type == 'd' || type == 'l') ? 8 : (type == 'b') ? 1 : 4;
+        }
+
+        /**
+         * @brief One property of a record.
          *
          * FBX has thirteen property types; a reader that kept them apart would spend its whole
-         * length in switch statements. Every integer type is widened to int64, every real to
-         * double, and arrays to vectors of those — the precision is never lost, and callers can
-         * ask for what they want without knowing what the exporter wrote.
+         * length in switch statements. Every scalar integer is widened to int64 and every scalar
+         * real to double — the precision is never lost, and callers can ask for what they want
+         * without knowing what the exporter wrote. Strings are views into the file mapping.
+         *
+         * Arrays keep the type the exporter wrote, f, d, i, l or b, and are read through typed
+         * accessors: element<T>() as the stored type itself, realAt() and integerAt() widened one
+         * element at a time to whichever the caller wants. Widened storage would hold positions,
+         * normals, texture coordinates and PolygonVertexIndex at twice their size for nothing.
+         * The tree walk does not expand arrays at all. An uncompressed one is left where it lies
+         * in the file mapping; a compressed one is only located, and reads as empty until
+         * inflateArrays() has decoded it into a buffer of its own. Expanding them all
+         * during the walk would touch every byte of every array — animation curves, discarded
+         * LODs — for the few the conversion actually reads.
          */
         struct FbxProperty {
             char type = '\0';
             int64_t integer = 0;
             double  real = 0.0;
-            std::string text;
-            std::vector<double>  reals;
-            std::vector<int64_t> integers;
+            std::string_view text;
+            const uint8_t* elements = nullptr;   ///< An array as stored: in the mapping, or inflated.
+            const uint8_t* deflated = nullptr;   ///< A compressed array not yet inflated, in the mapping.
+            uint32_t deflatedSize = 0;
+            uint32_t elementCount = 0;
+
+            bool isArray() const { return elements || deflated; }
+
+            /// @brief Zero while still deflated, so a caller that forgot to inflate reads nothing.
+            size_t arraySize() const { return elements ? elementCount : 0; }
 
-            bool isArray() const { return !reals.empty() || !integers.empty(); }
+            /// @brief Element @p index as stored; @p T must be the type @c type names.
+            template <typename T> T element(size_t index) const {
+                T value;
+                std::memcpy(&value, elements + index * sizeof(T), sizeof(T));
+                return value;
+            }
+            double realAt(size_t index) const {
+                switch (type) {
+                    case 'f': return element<float>(index);
+                    case 'd': return element<double>(index);
+                    case 'i': return element<int32_t>(index);
+                    case 'l': return static_cast<double>(element<int64_t>(index));
+                    default:  return element<uint8_t>(index);
+                }
+            }
+            int64_t integerAt(size_t index) const {
+                switch (type) {
+                    case 'i': return element<int32_t>(index);
+                    case 'l': return element<int64_t>(index);
+                    case 'f': return static_cast<int64_t>(element<float>(index));
+                    case 'd': return static_cast<int64_t>(element<double>(index));
+                    default:  return element<uint8_t>(index);
+                }
+            }
         };
 
+        /// @brief One record. Everything it refers to lives in the mapping or in an FbxArena.
         struct FbxNode {
-            std::string name;
-            std::vector<FbxProperty> properties;
-            std::vector<FbxNode> children;
+            std::string_view name;
+            FbxSpan<FbxProperty> properties;
+            FbxSpan<FbxNode> children;
 
             const FbxNode* child(const char* wanted) const {
                 for (const FbxNode& node : children) {
@@ -71,20 +176,61 @@ namespace dmrender {
                 }
                 return nullptr;
             }
+            FbxNode* child(const char* wanted) {
+                return const_cast<FbxNode*>(static_cast<const FbxNode&>(*this).child(wanted));
+            }
 
             /// @brief First property as a string, or empty. Names and enums live in property 0..2.
-            std::string stringAt(size_t index) const {
-                return index < properties.size() ? properties[index].text : std::string();
+            std::string_view stringAt(size_t index) const {
+                return index < properties.size() ? properties[index].text : std::string_view();
             }
             int64_t integerAt(size_t index, int64_t fallback = 0) const {
                 return index < properties.size() ? properties[index].integer : fallback;
             }
         };
 
+        /**
+         * @brief A record to read, by its path of names from the top of the file.
+         *
+         * With @c whole set the record is read with everything under it; without, only the
+         * record itself and those of its children that have a path of their own.
+         */
+        struct FbxRecordPath {
+            const char* path;
+            bool whole;
+        };
+
+        /**
+         * @brief Everything loadFbx() reads, and so everything it has parsed.
+         *
+         * A rigged or animated asset is mostly AnimationCurve, Deformer and Pose records under
+         * Objects, and a Takes section beside it, none of which a static renderer draws. A record
+         * states where it ends before its name, so a subtree not listed here costs one seek.
+         */
+        constexpr FbxRecordPath kConvertedRecords[] = {
+            { "GlobalSettings",   true  },
+            { "Objects",          false },
+            { "Objects/Geometry", true  },
+            { "Objects/Model",    true  },
+            { "Connections",      true  },
+        };
+
         /// @brief Reads the binary encoding described at the top of the file.
         class FbxReader {
         public:
-            FbxReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+            /// @param arena Where the tree is built; it must outlive the tree, as the mapping must.
+            FbxReader(const uint8_t* data, size_t size, FbxArena& arena)
+                : m_data(data), m_size(size), m_arena(arena) {}
+
+            /// @brief Reads only @p records; every other record is skipped with its subtree and
+            ///        never enters the tree. The overload without reads everything.
+            template <size_t N>
+            bool parse(FbxNode& root, std::string& error, const FbxRecordPath (&records)[N])
+            {
+                m_records = records;
+                m_recordCount = N;
+                return parse(root, error);
+            }
 
             bool parse(FbxNode& root, std::string& error)
             {
@@ -98,20 +244,14 @@ namespace dmrender {
                 // The width of a record's three offsets changes here and nowhere else.
                 m_wideOffsets = m_version >= 7500;
 
-                while (m_position + recordHeaderSize() <= m_size) {
-                    FbxNode node;
-                    const Status status = readNode(node, error);
-                    if (status == Status::Error) return false;
-                    if (status == Status::End)   break;
-                    root.children.push_back(std::move(node));
-                }
-                return true;
+                m_path.clear();
+                return readChildren(root, m_size, m_records != nullptr, 0, error);
             }
 
             uint32_t version() const { return m_version; }
 
         private:
-            enum class Status { Ok, End, Error };
+            enum class Status { Ok, Skipped, End, Error };
 
             size_t recordHeaderSize() const { return m_wideOffsets ? 25 : 13; }
 
@@ -130,7 +270,37 @@ namespace dmrender {
                                      : static_cast<uint64_t>(readScalar<uint32_t>());
             }
 
-            Status readNode(FbxNode& node, std::string& error)
+            /**
+             * @brief Reads records until the terminator or @p endOffset into @p parent's children.
+             *
+             * They are gathered in a scratch list kept per depth, which stops growing once the
+             * deepest branch has been seen, and only then copied into the arena at their final
+             * size.
+             * @param choosing Whether records are still being picked by path: false inside a
+             *        record read whole, and throughout when everything is read.
+             */
+            bool readChildren(FbxNode& parent, uint64_t endOffset, bool choosing, size_t depth, std::string& error)
+            {
+                if (m_scratch.size() <= depth) m_scratch.emplace_back();
+                m_scratch[depth].clear();
+
+                while (m_position + recordHeaderSize() <= endOffset) {
+                    FbxNode child;
+                    const Status status = readNode(child, choosing, depth, error);
+                    if (status == Status::Error) return false;
+                    if (status == Status::End)   break;
+                    if (status == Status::Skipped) continue;
+                    m_scratch[depth].push_back(child);
+                }
+
+                const std::vector<FbxNode>& read = m_scratch[depth];
+                parent.children.items = m_arena.allocate<FbxNode>(read.size());
+                parent.children.count = read.size();
+                std::copy(read.begin(), read.end(), parent.children.items);
+                return true;
+            }
+
+            Status readNode(FbxNode& node, bool choosing, size_t depth, std::string& error)
             {
                 const uint64_t endOffset    = readOffset();
                 const uint64_t propertyCount = readOffset();
@@ -142,104 +312,75 @@ namespace dmrender {
                 if (endOffset > m_size) { error = "record extends past end of file"; return Status::Error; }
 
                 if (m_position + nameLength > m_size) { error = "truncated record name"; return Status::Error; }
-                node.name.assign(reinterpret_cast<const char*>(m_data + m_position), nameLength);
+                node.name = std::string_view(reinterpret_cast<const char*>(m_data + m_position), nameLength);
                 m_position += nameLength;
 
-                node.properties.reserve(static_cast<size_t>(propertyCount));
-                for (uint64_t i = 0; i < propertyCount; ++i) {
-                    FbxProperty property;
+                // m_path holds the names down to this record while choosing, and is put back
+                // the way it was on the way out.
+                const size_t parentPathLength = m_path.size();
+                if (choosing) {
+                    if (!m_path.empty()) m_path += '/';
+                    m_path += node.name;
+                    const FbxRecordPath* wanted = nullptr;
+                    for (size_t i = 0; i < m_recordCount; ++i) {
+                        if (m_path == m_records[i].path) wanted = &m_records[i];
+                    }
+                    if (!wanted) {
+                        m_path.resize(parentPathLength);
+                        if (endOffset < m_position) { error = "record ends before it starts"; return Status::Error; }
+                        m_position = static_cast<size_t>(endOffset);
+                        return Status::Skipped;
+                    }
+                    if (wanted->whole) choosing = false;
+                }
+
+                // Every property takes at least its type byte, which bounds a corrupt count
+                // before it becomes an allocation.
+                if (propertyCount > m_size - m_position) { error = "implausible property count"; return Status::Error; }
+                node.properties.items = m_arena.allocate<FbxProperty>(static_cast<size_t>(propertyCount));
+                node.properties.count = static_cast<size_t>(propertyCount);
+                for (FbxProperty& property : node.properties) {
                     if (!readProperty(property, error)) return Status::Error;
-                    node.properties.push_back(std::move(property));
                 }
 
                 // Anything left before endOffset is nested records. A record with no children
-                // still writes the terminator, so the loop below reads it and stops.
-                while (m_position + recordHeaderSize() <= endOffset) {
-                    FbxNode child;
-                    const Status status = readNode(child, error);
-                    if (status == Status::Error) return Status::Error;
-                    if (status == Status::End)   break;
-                    node.children.push_back(std::move(child));
-                }
+                // still writes the terminator, so reading them stops there.
+                if (!readChildren(node, endOffset, choosing, depth + 1, error)) return Status::Error;
 
+                m_path.resize(parentPathLength);
                 m_position = static_cast<size_t>(endOffset);
                 return Status::Ok;
             }
 
-            /// @brief Expands one array property, inflating it first when it is deflated.
+            /// @brief Locates one array property; see FbxProperty for why it is not expanded here.
             bool readArray(FbxProperty& property, char type, std::string& error)
             {
                 const uint32_t count      = readScalar<uint32_t>();
                 const uint32_t encoding   = readScalar<uint32_t>();
                 const uint32_t storedSize = readScalar<uint32_t>();
 
-                const size_t elementSize = (type == 'd' || type == 'l') ? 8
-                                         : (type == 'b')               ? 1
-                                                                       : 4;
-                const size_t plainSize = static_cast<size_t>(count) * elementSize;
-
+                if (type != 'f' && type != 'd' && type != 'i' && type != 'l' && type != 'b') {
+                    error = "unknown array type";
+                    return false;
+                }
                 if (m_position + storedSize > m_size) { error = "truncated array property"; return false; }
                 const uint8_t* source = m_data + m_position;
                 m_position += storedSize;
 
-                std::vector<uint8_t> inflated;
-                if (encoding == 1) {
-                    // Deflate, zlib-wrapped. stb's decoder is already linked for image loading
-                    // and handles exactly this, which saves taking a dependency on zlib itself.
-                    inflated.resize(plainSize);
-                    const int written = stbi_zlib_decode_buffer(
-                            reinterpret_cast<char*>(inflated.data()), static_cast<int>(plainSize),
-                            reinterpret_cast<const char*>(source), static_cast<int>(storedSize));
-                    if (written < 0 || static_cast<size_t>(written) != plainSize) {
-                        error = "failed to inflate a compressed array";
+                property.elementCount = count;
+                if (encoding == 0) {
+                    if (static_cast<size_t>(count) * arrayElementSize(type) > storedSize) {
+                        error = "array claims more elements than it stores";
                         return false;
                     }
-                    source = inflated.data();
-                } else if (plainSize > storedSize) {
-                    error = "array claims more elements than it stores";
+                    property.elements = source;
+                } else if (encoding == 1) {
+                    property.deflated = source;
+                    property.deflatedSize = storedSize;
+                } else {
+                    error = "unknown array encoding";
                     return false;
                 }
-
-                switch (type) {
-                    case 'f': {
-                        property.reals.resize(count);
-                        for (uint32_t i = 0; i < count; ++i) {
-                            float value; std::memcpy(&value, source + i * 4, 4);
-                            property.reals[i] = value;
-                        }
-                        break;
-                    }
-                    case 'd': {
-                        property.reals.resize(count);
-                        for (uint32_t i = 0; i < count; ++i) {
-                            double value; std::memcpy(&value, source + i * 8, 8);
-                            property.reals[i] = value;
-                        }
-                        break;
-                    }
-                    case 'i': {
-                        property.integers.resize(count);
-                        for (uint32_t i = 0; i < count; ++i) {
-                            int32_t value; std::memcpy(&value, source + i * 4, 4);
-                            property.integers[i] = value;
-                        }
-                        break;
-                    }
-                    case 'l': {
-                        property.integers.resize(count);
-                        for (uint32_t i = 0; i < count; ++i) {
-                            int64_t value; std::memcpy(&value, source + i * 8, 8);
-                            property.integers[i] = value;
-                        }
-                        break;
-                    }
-                    case 'b': {
-                        property.integers.resize(count);
-                        for (uint32_t i = 0; i < count; ++i) property.integers[i] = source[i];
-                        break;
-                    }
-                    default: error = "unknown array type"; return false;
-                }
                 return true;
             }
 
@@ -260,7 +401,7 @@ namespace dmrender {
                     case 'R': {
                         const uint32_t length = readScalar<uint32_t>();
                         if (m_position + length > m_size) { error = "truncated string property"; return false; }
-                        property.text.assign(reinterpret_cast<const char*>(m_data + m_position), length);
+                        property.text = std::string_view(reinterpret_cast<const char*>(m_data + m_position), length);
                         m_position += length;
                         return true;
                     }
@@ -277,8 +418,57 @@ namespace dmrender {
             size_t m_position = 0;
             uint32_t m_version = 0;
             bool m_wideOffsets = false;
+            const FbxRecordPath* m_records = nullptr;
+            size_t m_recordCount = 0;
+            FbxArena& m_arena;
+            std::string m_path;
+            std::deque<std::vector<FbxNode>> m_scratch;   ///< By depth; a deque, so growing moves none of them.
         };
 
+        /**
+         * @brief Expands compressed arrays, spread over the worker threads.
+         *
+         * Deflate streams are serial inside but independent of each other, so the arrays a file
+         * actually needs inflate side by side rather than one after another on the walk's thread.
+         * A property that is not compressed, or already inflated, is left alone.
+         *
+         * @param buffers Receives the inflated bytes, which the properties point into from then on.
+         * @param read Advanced by the compressed size of every array inflated.
+         */
+        bool inflateArrays(const std::vector<FbxProperty*>& arrays,
+                           std::vector<std::vector<uint8_t>>& buffers, std::string& error,
+                           ReadProgress& read)
+        {
+            buffers.resize(arrays.size());
+            std::vector<uint8_t> failed(arrays.size(), 0);
+            parallelFor(arrays.size(), [&](size_t a) {
+                FbxProperty& property = *arrays[a];
+                if (!property.deflated) return;
+
+                // Deflate, zlib-wrapped. stb's decoder is already linked for image loading and
+                // handles exactly this, which saves taking a dependency on zlib itself.
+                const size_t plainSize = static_cast<size_t>(property.elementCount) * arrayElementSize(property.type);
+                std::vector<uint8_t>& inflated = buffers[a];
+                inflated.resize(plainSize);
+                const int written = stbi_zlib_decode_buffer(
+                        reinterpret_cast<char*>(inflated.data()), static_cast<int>(plainSize),
+                        reinterpret_cast<const char*>(property.deflated), static_cast<int>(property.deflatedSize));
+                if (written < 0 || static_cast<size_t>(written) != plainSize) {
+                    inflated = {};
+                    failed[a] = 1;
+                    return;
+                }
+                property.deflated = nullptr;
+                property.elements = inflated.data();
+                read.advance(property.deflatedSize);
+            });
+            if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+                error = "failed to inflate a compressed array";
+                return false;
+            }
+            return true;
+        }
+
         // ─────────────────────────────────────────────────────────────────────
         // Interpreting the tree
         // ─────────────────────────────────────────────────────────────────────
@@ -411,8 +601,8 @@ namespace dmrender {
             enum class Mapping { ByPolygonVertex, ByControlPoint, ByPolygon, AllSame, Unknown };
             Mapping mapping = Mapping::Unknown;
             bool indexed = false;
-            const std::vector<double>* values = nullptr;
-            const std::vector<int64_t>* indices = nullptr;
+            const FbxProperty* values = nullptr;
+            const FbxProperty* indices = nullptr;
 
             /// @brief Index into @c values for a given polygon-vertex, or -1 if unavailable.
             int64_t resolve(int64_t polygonVertex, int64_t controlPoint, int64_t polygon) const
@@ -426,8 +616,8 @@ namespace dmrender {
                     default: return -1;
                 }
                 if (indexed) {
-                    if (!indices || slot < 0 || slot >= static_cast<int64_t>(indices->size())) return -1;
-                    slot = (*indices)[static_cast<size_t>(slot)];
+                    if (!indices || slot < 0 || slot >= static_cast<int64_t>(indices->arraySize())) return -1;
+                    slot = indices->integerAt(static_cast<size_t>(slot));
                 }
                 return slot;
             }
@@ -438,27 +628,195 @@ namespace dmrender {
         {
             LayerAccess access;
             if (const FbxNode* mapping = layer.child("MappingInformationType")) {
-                const std::string text = mapping->stringAt(0);
+                const std::string_view text = mapping->stringAt(0);
                 if      (text == "ByPolygonVertex")                          access.mapping = LayerAccess::Mapping::ByPolygonVertex;
                 else if (text == "ByVertex" || text == "ByControlPoint")     access.mapping = LayerAccess::Mapping::ByControlPoint;
                 else if (text == "ByPolygon")                                access.mapping = LayerAccess::Mapping::ByPolygon;
                 else if (text == "AllSame")                                  access.mapping = LayerAccess::Mapping::AllSame;
             }
             if (const FbxNode* reference = layer.child("ReferenceInformationType")) {
-                const std::string text = reference->stringAt(0);
+                const std::string_view text = reference->stringAt(0);
                 access.indexed = (text == "IndexToDirect" || text == "Index");
             }
             if (const FbxNode* values = layer.child(valuesName)) {
-                if (!values->properties.empty()) access.values = &values->properties[0].reals;
+                if (!values->properties.empty()) access.values = &values->properties[0];
             }
             if (indicesName) {
                 if (const FbxNode* indices = layer.child(indicesName)) {
-                    if (!indices->properties.empty()) access.indices = &indices->properties[0].integers;
+                    if (!indices->properties.empty()) access.indices = &indices->properties[0];
                 }
             }
             return access;
         }
 
+        /// @brief One Geometry record converted on its own, its vertices numbered from zero.
+        struct FbxGeometryBlock {
+            std::vector<MeshVertex> vertices;
+            std::vector<uint32_t> indices;
+            size_t corners = 0;   ///< Polygon-vertices read, for LoadStats.
+        };
+
+        /**
+         * @brief Converts one Geometry record into @p block, placed by @p transform.
+         *
+         * Reads nothing but the record and writes nothing but the block, so geometries convert
+         * on as many threads as there are.
+         * @param read Advanced by the polygon-vertices converted, every so many.
+         * @return False for a record without the positions and polygons to convert.
+         */
+        bool convertGeometry(const FbxNode& node, const Matrix4& transform, double toMetres, bool zUp,
+                             FbxGeometryBlock& block, ReadProgress& read)
+        {
+            const FbxNode* verticesNode = node.child("Vertices");
+            const FbxNode* polygonNode  = node.child("PolygonVertexIndex");
+            if (!verticesNode || !polygonNode) return false;
+            if (verticesNode->properties.empty() || polygonNode->properties.empty()) return false;
+
+            const FbxProperty& positions = verticesNode->properties[0];
+            const size_t positionCount = positions.arraySize();
+            const FbxProperty& polygons = polygonNode->properties[0];
+            const size_t polygonVertexCount = polygons.arraySize();
+            if (positionCount == 0 || polygonVertexCount == 0) return false;
+
+            LayerAccess normals;
+            if (const FbxNode* layer = node.child("LayerElementNormal")) {
+                normals = readLayerElement(*layer, "Normals", "NormalsIndex");
+            }
+            LayerAccess uvs;
+            if (const FbxNode* layer = node.child("LayerElementUV")) {
+                uvs = readLayerElement(*layer, "UV", "UVIndex");
+            }
+
+            // Polygon-vertices that share a position, a normal and a texture coordinate are the
+            // same vertex; ones that differ in any of them are not, which is what makes a hard
+            // edge hard. Each control point chains the few vertices made from it, and the packed
+            // normal and the UV are what a chain is searched on.
+            struct FbxCornerAttributes {
+                uint32_t normal;
+                float u, v;
+                bool operator==(const FbxCornerAttributes& other) const {
+                    return normal == other.normal && u == other.u && v == other.v;
+                }
+            };
+            VertexDeduplicator<FbxCornerAttributes> unique(positionCount / 3);
+            // Most control points yield one vertex; seams and hard edges add a few more.
+            unique.reserve(positionCount / 3 + positionCount / 6);
+            block.vertices.reserve(positionCount / 3 + positionCount / 6);
+
+            // The packed normal is part of the key, so every polygon-vertex needs one before it
+            // can be looked up. They are worked out a chunk ahead of the lookups, so packNormals()
+            // takes them in batches while what is held stays the same few kilobytes however
+            // large the geometry.
+            constexpr size_t kNormalChunk = 4096;
+            std::vector<float> worldNormals(kNormalChunk * 3);
+            std::vector<uint32_t> packedNormals(kNormalChunk);
+            /// Packs the normals of the polygon-vertices from @p first, which is in @p polygon.
+            auto packNormalChunk = [&](size_t first, int64_t polygon) {
+                const size_t count = std::min(kNormalChunk, polygonVertexCount - first);
+                for (size_t k = 0; k < count; ++k) {
+                    const size_t i = first + k;
+                    const int64_t entry = polygons.integerAt(i);
+                    const int64_t controlPoint = entry < 0 ? ~entry : entry;
+
+                    double normal[3] = { 0, 1, 0 };
+                    if (normals.values) {
+                        const int64_t slot = normals.resolve(static_cast<int64_t>(i), controlPoint, polygon);
+                        const size_t offset = static_cast<size_t>(slot) * 3;
+                        if (slot >= 0 && offset + 2 < normals.values->arraySize()) {
+                            normal[0] = normals.values->realAt(offset + 0);
+                            normal[1] = normals.values->realAt(offset + 1);
+                            normal[2] = normals.values->realAt(offset + 2);
+                            if (zUp) {
+                                const double y = normal[1];
+                                normal[1] = normal[2];
+                                normal[2] = -y;
+                            }
+                        }
+                    }
+                    transformDirection(transform, normal, &worldNormals[k * 3]);
+                    if (entry < 0) ++polygon;
+                }
+                packNormals(worldNormals.data(), packedNormals.data(), count);
+            };
+
+            /// Appends one polygon-vertex, reusing an identical one when it exists.
+            auto emit = [&](int64_t polygonVertex, int64_t controlPoint, int64_t polygon,
+                            uint32_t packedNormal) -> uint32_t {
+                float u = 0.0f, v = 0.0f;
+                if (uvs.values) {
+                    const int64_t slot = uvs.resolve(polygonVertex, controlPoint, polygon);
+                    const size_t offset = static_cast<size_t>(slot) * 2;
+                    if (slot >= 0 && offset + 1 < uvs.values->arraySize()) {
+                        u = static_cast<float>(uvs.values->realAt(offset + 0));
+                        // FBX texture coordinates have V increasing upwards; the renderer samples
+                        // with V down, the same flip the OBJ path applies.
+                        v = 1.0f - static_cast<float>(uvs.values->realAt(offset + 1));
+                    }
+                }
+                const FbxCornerAttributes attributes{ packedNormal, u, v };
+
+                return unique.resolve(controlPoint, attributes, [&]() -> uint32_t {
+                    double position[3] = { 0, 0, 0 };
+                    const size_t base = static_cast<size_t>(controlPoint) * 3;
+                    if (base + 2 < positionCount) {
+                        position[0] = positions.realAt(base + 0);
+                        position[1] = positions.realAt(base + 1);
+                        position[2] = positions.realAt(base + 2);
+                    }
+                    if (zUp) {
+                        // Z-up to Y-up, preserving handedness: (x, y, z) becomes (x, z, -y).
+                        const double y = position[1];
+                        position[1] = position[2];
+                        position[2] = -y;
+                    }
+                    position[0] *= toMetres;
+                    position[1] *= toMetres;
+                    position[2] *= toMetres;
+
+                    MeshVertex vertex{};
+                    transformPoint(transform, position, vertex.position);
+                    vertex.packedNormal = attributes.normal;
+                    vertex.uv[0] = u;
+                    vertex.uv[1] = v;
+
+                    block.vertices.push_back(vertex);
+                    return static_cast<uint32_t>(block.vertices.size() - 1);
+                });
+            };
+
+            // A polygon runs until an index arrives negative; that last one is stored as ~i.
+            // Polygons are fanned, which is correct for the convex quads and triangles these
+            // exports contain and is what every other reader does with the general case.
+            std::vector<uint32_t> corners;
+            corners.reserve(4);
+            int64_t polygonIndex = 0;
+            constexpr size_t kCornersPerStep = size_t(1) << 16;
+            for (size_t i = 0; i < polygonVertexCount; ++i) {
+                if (i % kCornersPerStep == kCornersPerStep - 1) read.advance(kCornersPerStep);
+                if (i % kNormalChunk == 0) packNormalChunk(i, polygonIndex);
+                int64_t controlPoint = polygons.integerAt(i);
+                const bool lastOfPolygon = controlPoint < 0;
+                if (lastOfPolygon) controlPoint = ~controlPoint;
+
+                corners.push_back(emit(static_cast<int64_t>(i), controlPoint, polygonIndex,
+                                       packedNormals[i % kNormalChunk]));
+
+                if (lastOfPolygon) {
+                    for (size_t corner = 2; corner < corners.size(); ++corner) {
+                        block.indices.push_back(corners[0]);
+                        block.indices.push_back(corners[corner - 1]);
+                        block.indices.push_back(corners[corner]);
+                    }
+                    corners.clear();
+                    ++polygonIndex;
+                }
+            }
+
+            read.advance(polygonVertexCount % kCornersPerStep);
+            block.corners = polygonVertexCount;
+            return true;
+        }
+
         // ─────────────────────────────────────────────────────────────────────
         // Textures by convention
         // ─────────────────────────────────────────────────────────────────────
@@ -549,22 +907,28 @@ namespace dmrender {
      * into triangles, layer elements are resolved through whichever mapping they declare, and
      * units are converted to metres so a scene assembled from several files agrees with itself.
      */
-    bool loadFbx(const std::filesystem::path& path, Mesh& mesh, std::string& error)
+    bool loadFbx(const std::filesystem::path& path, Mesh& mesh, std::string& error, LoadProgress* progress)
     {
-        std::ifstream file(path, std::ios::binary | std::ios::ate);
-        if (!file) { error = "cannot open " + path.string(); return false; }
-
-        const std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-        std::vector<uint8_t> bytes(static_cast<size_t>(size));
-        if (!file.read(reinterpret_cast<char*>(bytes.data()), size)) {
-            error = "cannot read " + path.string();
-            return false;
-        }
-
+        ReadProgress read(progress);
+        read.stage("reading", 0.0f, 0.1f, 1);
+        // Mapped rather than read: the tree keeps pointers into it for every uncompressed array,
+        // so it stays open until the conversion below is done.
+        LoadPhaseTimer readPhase(mesh.loadStats, "read");
+        MappedFile file;
+        if (!file.open(path, error)) return false;
+        readPhase.finish();
+        mesh.loadStats.bytesRead += file.size();
+
+        // The tree, and the inflated arrays it points into, are released together on return.
+        FbxArena arena;
+        std::vector<std::vector<uint8_t>> inflatedArrays;
         FbxNode root;
-        FbxReader reader(bytes.data(), bytes.size());
-        if (!reader.parse(root, error)) return false;
+        FbxReader reader(file.data(), file.size(), arena);
+        {
+            LoadPhaseTimer parsePhase(mesh.loadStats, "parse");
+            if (!reader.parse(root, error, kConvertedRecords)) return false;
+        }
+        LoadPhaseTimer convertPhase(mesh.loadStats, "convert");
 
         // ── Units and axes ──
         //
@@ -584,15 +948,14 @@ namespace dmrender {
         if (unitScale <= 0.0) unitScale = 1.0;
         const double toMetres = unitScale / 100.0;
 
-        const FbxNode* objects = root.child("Objects");
+        FbxNode* objects = root.child("Objects");
         if (!objects) { error = "FBX has no Objects section"; return false; }
 
         // ── Object identities ──
         //
         // Names are stored as "Name\0\1ClassName"; only the part before the separator is the name.
-        auto cleanName = [](const std::string& raw) {
-            const size_t end = raw.find('\0');
-            return end == std::string::npos ? raw : raw.substr(0, end);
+        auto cleanName = [](std::string_view raw) {
+            return std::string(raw.substr(0, raw.find('\0')));
         };
 
         std::unordered_set<int64_t> geometryIds;
@@ -729,178 +1092,104 @@ namespace dmrender {
         material.metallic  = 0.0f;
         mesh.materials.push_back(material);
 
-        // ── Geometry ──
-        size_t geometryCount = 0;
+        // ── Which geometries to convert ──
+        //
+        // Skip collision bodies always, and every LOD but the finest when the file has them. A
+        // file with no LOD naming keeps all its parts: a bottle with a separate cork is one asset
+        // in two meshes, and dropping one of them is not a saving.
+        std::vector<FbxNode*> keptGeometries;
         size_t skippedCount = 0;
-        for (const FbxNode& node : objects->children) {
+        for (FbxNode& node : objects->children) {
             if (node.name != "Geometry") continue;
 
-            // Skip collision bodies always, and every LOD but the finest when the file has them.
-            // A file with no LOD naming keeps all its parts: a bottle with a separate cork is one
-            // asset in two meshes, and dropping one of them is not a saving.
-            {
-                std::string ownerName;
-                if (const auto link = geometryToModel.find(node.integerAt(0));
-                    link != geometryToModel.end()) {
-                    ownerName = modelNames[link->second];
-                }
-                if (ownerName.empty()) ownerName = cleanName(node.stringAt(1));
-
-                if (isCollisionName(ownerName)) { ++skippedCount; continue; }
-                if (anyLodMarker && lodLevelOf(ownerName) != 0) { ++skippedCount; continue; }
+            std::string ownerName;
+            if (const auto link = geometryToModel.find(node.integerAt(0));
+                link != geometryToModel.end()) {
+                ownerName = modelNames[link->second];
             }
+            if (ownerName.empty()) ownerName = cleanName(node.stringAt(1));
 
-            const FbxNode* verticesNode = node.child("Vertices");
-            const FbxNode* polygonNode  = node.child("PolygonVertexIndex");
-            if (!verticesNode || !polygonNode) continue;
-            if (verticesNode->properties.empty() || polygonNode->properties.empty()) continue;
-
-            const std::vector<double>& positions = verticesNode->properties[0].reals;
-            const std::vector<int64_t>& polygons = polygonNode->properties[0].integers;
-            if (positions.empty() || polygons.empty()) continue;
+            if (isCollisionName(ownerName)) { ++skippedCount; continue; }
+            if (anyLodMarker && lodLevelOf(ownerName) != 0) { ++skippedCount; continue; }
+            keptGeometries.push_back(&node);
+        }
 
-            LayerAccess normals;
-            if (const FbxNode* layer = node.child("LayerElementNormal")) {
-                normals = readLayerElement(*layer, "Normals", "NormalsIndex");
-            }
-            LayerAccess uvs;
-            if (const FbxNode* layer = node.child("LayerElementUV")) {
-                uvs = readLayerElement(*layer, "UV", "UVIndex");
+        // ── Their compressed arrays, inflated together; the skipped ones never are ──
+        size_t cornerTotal = 0;
+        {
+            std::vector<FbxProperty*> arrays;
+            uint64_t deflatedTotal = 0;
+            auto collect = [&](FbxNode* node) {
+                if (!node || node->properties.empty()) return;
+                arrays.push_back(&node->properties[0]);
+                if (node->properties[0].deflated) deflatedTotal += node->properties[0].deflatedSize;
+            };
+            for (FbxNode* geometry : keptGeometries) {
+                collect(geometry->child("Vertices"));
+                collect(geometry->child("PolygonVertexIndex"));
+                if (const FbxNode* polygons = geometry->child("PolygonVertexIndex");
+                    polygons && !polygons->properties.empty()) {
+                    cornerTotal += polygons->properties[0].elementCount;
+                }
+                if (FbxNode* layer = geometry->child("LayerElementNormal")) {
+                    collect(layer->child("Normals"));
+                    collect(layer->child("NormalsIndex"));
+                }
+                if (FbxNode* layer = geometry->child("LayerElementUV")) {
+                    collect(layer->child("UV"));
+                    collect(layer->child("UVIndex"));
+                }
             }
+            convertPhase.finish();
+            LoadPhaseTimer inflatePhase(mesh.loadStats, "inflate");
+            read.stage("inflate", 0.1f, 0.4f, deflatedTotal);
+            if (!inflateArrays(arrays, inflatedArrays, error, read)) return false;
+        }
+        LoadPhaseTimer geometryPhase(mesh.loadStats, "convert");
 
-            // The transform of the model this geometry hangs off, in metres.
-            Matrix4 transform;
-            if (const auto link = geometryToModel.find(node.integerAt(0));
+        // ── Geometry ──
+        //
+        // Each geometry is converted into a block of its own on a worker thread, then the blocks
+        // are joined in file order, so the result does not depend on which thread finished
+        // first. The transforms are resolved beforehand: modelWorld() memoises as it goes.
+        std::vector<Matrix4> transforms(keptGeometries.size());
+        for (size_t g = 0; g < keptGeometries.size(); ++g) {
+            // The transform of the model the geometry hangs off, in metres.
+            Matrix4& transform = transforms[g];
+            if (const auto link = geometryToModel.find(keptGeometries[g]->integerAt(0));
                 link != geometryToModel.end()) {
                 transform = modelWorld(link->second, 0);
             }
             transform.m[12] = static_cast<float>(transform.m[12] * toMetres);
             transform.m[13] = static_cast<float>(transform.m[13] * toMetres);
             transform.m[14] = static_cast<float>(transform.m[14] * toMetres);
+        }
 
-            const uint32_t firstIndex = static_cast<uint32_t>(mesh.indices.size());
-
-            // Polygon-vertices that share a position, a normal and a texture coordinate are the
-            // same vertex; ones that differ in any of them are not, which is what makes a hard
-            // edge hard. Keying on all three is the whole of the deduplication.
-            struct VertexKey {
-                int64_t position;
-                uint32_t normal;
-                float u, v;
-                bool operator==(const VertexKey& other) const {
-                    return position == other.position && normal == other.normal &&
-                           u == other.u && v == other.v;
-                }
-            };
-            struct VertexKeyHash {
-                size_t operator()(const VertexKey& key) const {
-                    size_t hash = std::hash<int64_t>()(key.position);
-                    auto mix = [&hash](size_t value) {
-                        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
-                    };
-                    mix(key.normal);
-                    mix(std::hash<float>()(key.u));
-                    mix(std::hash<float>()(key.v));
-                    return hash;
-                }
-            };
-            std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
-            unique.reserve(polygons.size());
-
-            /// Appends one polygon-vertex, reusing an identical one when it exists.
-            auto emit = [&](int64_t polygonVertex, int64_t controlPoint, int64_t polygon) -> uint32_t {
-                double position[3] = { 0, 0, 0 };
-                const size_t base = static_cast<size_t>(controlPoint) * 3;
-                if (base + 2 < positions.size()) {
-                    position[0] = positions[base + 0];
-                    position[1] = positions[base + 1];
-                    position[2] = positions[base + 2];
-                }
-                if (zUp) {
-                    // Z-up to Y-up, preserving handedness: (x, y, z) becomes (x, z, -y).
-                    const double y = position[1];
-                    position[1] = position[2];
-                    position[2] = -y;
-                }
-                position[0] *= toMetres;
-                position[1] *= toMetres;
-                position[2] *= toMetres;
-
-                double normal[3] = { 0, 1, 0 };
-                if (normals.values) {
-                    const int64_t slot = normals.resolve(polygonVertex, controlPoint, polygon);
-                    const size_t offset = static_cast<size_t>(slot) * 3;
-                    if (slot >= 0 && offset + 2 < normals.values->size()) {
-                        normal[0] = (*normals.values)[offset + 0];
-                        normal[1] = (*normals.values)[offset + 1];
-                        normal[2] = (*normals.values)[offset + 2];
-                        if (zUp) {
-                            const double y = normal[1];
-                            normal[1] = normal[2];
-                            normal[2] = -y;
-                        }
-                    }
-                }
-
-                float u = 0.0f, v = 0.0f;
-                if (uvs.values) {
-                    const int64_t slot = uvs.resolve(polygonVertex, controlPoint, polygon);
-                    const size_t offset = static_cast<size_t>(slot) * 2;
-                    if (slot >= 0 && offset + 1 < uvs.values->size()) {
-                        u = static_cast<float>((*uvs.values)[offset + 0]);
-                        // FBX texture coordinates have V increasing upwards; the renderer samples
-                        // with V down, the same flip the OBJ path applies.
-                        v = 1.0f - static_cast<float>((*uvs.values)[offset + 1]);
-                    }
-                }
-
-                float worldPosition[3], worldNormal[3];
-                transformPoint(transform, position, worldPosition);
-                transformDirection(transform, normal, worldNormal);
-
-                const VertexKey key{ controlPoint,
-                                     packNormal(worldNormal[0], worldNormal[1], worldNormal[2]),
-                                     u, v };
-                const auto found = unique.find(key);
-                if (found != unique.end()) return found->second;
-
-                MeshVertex vertex{};
-                vertex.position[0] = worldPosition[0];
-                vertex.position[1] = worldPosition[1];
-                vertex.position[2] = worldPosition[2];
-                vertex.packedNormal = key.normal;
-                vertex.uv[0] = u;
-                vertex.uv[1] = v;
-
-                const uint32_t index = static_cast<uint32_t>(mesh.vertices.size());
-                mesh.vertices.push_back(vertex);
-                unique.emplace(key, index);
-                return index;
-            };
-
-            // A polygon runs until an index arrives negative; that last one is stored as ~i.
-            // Polygons are fanned, which is correct for the convex quads and triangles these
-            // exports contain and is what every other reader does with the general case.
-            std::vector<uint32_t> corners;
-            corners.reserve(4);
-            int64_t polygonIndex = 0;
-            for (size_t i = 0; i < polygons.size(); ++i) {
-                int64_t controlPoint = polygons[i];
-                const bool lastOfPolygon = controlPoint < 0;
-                if (lastOfPolygon) controlPoint = ~controlPoint;
-
-                corners.push_back(emit(static_cast<int64_t>(i), controlPoint, polygonIndex));
+        std::vector<FbxGeometryBlock> blocks(keptGeometries.size());
+        std::vector<uint8_t> converted(keptGeometries.size(), 0);
+        read.stage("convert", 0.4f, 1.0f, cornerTotal);
+        parallelFor(keptGeometries.size(), [&](size_t g) {
+            converted[g] = convertGeometry(*keptGeometries[g], transforms[g], toMetres, zUp, blocks[g], read) ? 1 : 0;
+        });
+
+        size_t vertexTotal = mesh.vertices.size(), indexTotal = mesh.indices.size();
+        for (const FbxGeometryBlock& block : blocks) {
+            vertexTotal += block.vertices.size();
+            indexTotal += block.indices.size();
+        }
+        mesh.vertices.reserve(vertexTotal);
+        mesh.indices.reserve(indexTotal);
 
-                if (lastOfPolygon) {
-                    for (size_t corner = 2; corner < corners.size(); ++corner) {
-                        mesh.indices.push_back(corners[0]);
-                        mesh.indices.push_back(corners[corner - 1]);
-                        mesh.indices.push_back(corners[corner]);
-                    }
-                    corners.clear();
-                    ++polygonIndex;
-                }
-            }
+        size_t geometryCount = 0;
+        for (size_t g = 0; g < blocks.size(); ++g) {
+            if (!converted[g]) continue;
+            FbxGeometryBlock& block = blocks[g];
+            const uint32_t vertexBase = static_cast<uint32_t>(mesh.vertices.size());
+            const uint32_t firstIndex = static_cast<uint32_t>(mesh.indices.size());
+            mesh.vertices.insert(mesh.vertices.end(), block.vertices.begin(), block.vertices.end());
+            for (const uint32_t index : block.indices) mesh.indices.push_back(vertexBase + index);
+            mesh.loadStats.cornersRead += block.corners;
+            block = {};   // released as it is joined, so the mesh is never held twice over
 
             const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size()) - firstIndex;
             if (indexCount == 0) continue;
@@ -918,6 +1207,7 @@ namespace dmrender {
             return false;
         }
 
+        mesh.loadStats.verticesAfterDedup += mesh.vertices.size();
         mesh.hadNormals   = true;
         mesh.hadTexCoords = true;
         mesh.sourceFormat = "FBX " + std::to_string(reader.version());
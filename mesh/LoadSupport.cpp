@@ -0,0 +1,219 @@
+#include "LoadSupport.hpp"
+#include "Mesh.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #ifdef __APPLE__
+        #include <mach/mach.h>
+    #endif
+#endif
+
+namespace dmrender {
+
+#ifdef _WIN32
+
+    bool MappedFile::open(const std::filesystem::path& path, std::string& error)
+    {
+        close();
+        HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) { error = "cannot open " + path.string(); return false; }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            error = "cannot stat " + path.string();
+            return false;
+        }
+        m_file = file;
+        m_size = static_cast<size_t>(size.QuadPart);
+        if (m_size == 0) return true;   // nothing to map, and mapping zero bytes is an error
+
+        m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping) {
+            m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!m_data) {
+            close();
+            error = "cannot map " + path.string();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file) CloseHandle(m_file);
+        m_data = nullptr;
+        m_mapping = nullptr;
+        m_file = nullptr;
+        m_size = 0;
+    }
+
+    void MappedFile::release(const uint8_t* begin, size_t size)
+    {
+        // Unlocking pages that were never locked is documented to remove them from the working
+        // set, which is exactly the effect wanted. The call reports that "failure"; ignore it.
+        if (m_data && size > 0) VirtualUnlock(const_cast<uint8_t*>(begin), size);
+    }
+
+    size_t peakResidentBytes()
+    {
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+        return static_cast<size_t>(counters.PeakWorkingSetSize);
+    }
+
+    size_t currentResidentBytes()
+    {
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+        return static_cast<size_t>(counters.WorkingSetSize);
+    }
+
+#else
+
+    bool MappedFile::open(const std::filesystem::path& path, std::string& error)
+    {
+        close();
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) { error = "cannot open " + path.string(); return false; }
+
+        struct stat info{};
+        if (fstat(descriptor, &info) != 0) {
+            ::close(descriptor);
+            error = "cannot stat " + path.string();
+            return false;
+        }
+        m_size = static_cast<size_t>(info.st_size);
+        if (m_size == 0) { ::close(descriptor); return true; }
+
+        void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // The mapping holds its own reference to the file; the descriptor is no longer needed.
+        ::close(descriptor);
+        if (mapped == MAP_FAILED) {
+            m_size = 0;
+            error = "cannot map " + path.string();
+            return false;
+        }
+        // Readers walk the file front to back, so ask for aggressive read-ahead. A hint only.
+        madvise(mapped, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const uint8_t*>(mapped);
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    void MappedFile::release(const uint8_t* begin, size_t size)
+    {
+        if (!m_data || size == 0) return;
+        const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) & ~(page - 1);
+        const uintptr_t last = (reinterpret_cast<uintptr_t>(begin) + size) & ~(page - 1);
+        if (last > first) madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+
+    size_t peakResidentBytes()
+    {
+        struct rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);           // bytes on Darwin
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;    // kilobytes on Linux
+#endif
+    }
+
+    size_t currentResidentBytes()
+    {
+#ifdef __APPLE__
+        mach_task_basic_info_data_t info{};
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                      reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) return 0;
+        return static_cast<size_t>(info.resident_size);
+#else
+        // The second field of statm is the resident set, in pages.
+        FILE* statm = std::fopen("/proc/self/statm", "r");
+        if (!statm) return 0;
+        unsigned long totalPages = 0, residentPages = 0;
+        const bool read = std::fscanf(statm, "%lu %lu", &totalPages, &residentPages) == 2;
+        std::fclose(statm);
+        return read ? static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+    }
+
+#endif
+
+    void LoadStats::add(const std::string& name, double phaseSeconds)
+    {
+        for (Phase& phase : phases) {
+            if (phase.name == name) { phase.seconds += phaseSeconds; return; }
+        }
+        phases.push_back({ name, phaseSeconds });
+    }
+
+    void LoadStats::merge(const LoadStats& other)
+    {
+        for (const Phase& phase : other.phases) add(phase.name, phase.seconds);
+        bytesRead += other.bytesRead;
+        cornersRead += other.cornersRead;
+        verticesAfterDedup += other.verticesAfterDedup;
+    }
+
+    void ReadProgress::stage(const char* phase, float from, float to, uint64_t total)
+    {
+        if (!m_progress) return;
+        m_from = from;
+        m_to = to;
+        m_total = total;
+        m_done = 0;
+        m_progress->phase = phase;
+        raise(from);
+    }
+
+    void ReadProgress::advance(uint64_t units)
+    {
+        if (!m_progress || m_total == 0) return;
+        const uint64_t done = std::min(m_done += units, m_total);
+        raise(m_from + (m_to - m_from) * static_cast<float>(static_cast<double>(done) / static_cast<double>(m_total)));
+    }
+
+    void ReadProgress::raise(float fraction)
+    {
+        // The reader has the first half of the bar; loadMesh() gives the passes the second.
+        const float target = 0.5f * std::clamp(fraction, 0.0f, 1.0f);
+        float current = m_progress->fraction.load();
+        while (current < target && !m_progress->fraction.compare_exchange_weak(current, target)) {}
+    }
+
+    double LoadPhaseTimer::finish()
+    {
+        if (!m_finished) {
+            m_finished = true;
+            m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+            m_stats->add(m_name, m_seconds);
+        }
+        return m_seconds;
+    }
+
+} // namespace dmrender
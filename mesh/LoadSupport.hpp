@@ -0,0 +1,258 @@
+//
+// Infrastructure shared by the format readers in mesh/: memory-mapped input, a parallel loop, a
+// phase timer and vertex deduplication.
+//
+// None is specific to a format, and each is needed by more than one reader, which is the only
+// reason they live in a header of their own rather than in an anonymous namespace beside their
+// first user.
+//
+
+#ifndef RENDERING_LOADSUPPORT_HPP
+#define RENDERING_LOADSUPPORT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace dmrender {
+
+    struct LoadStats;
+    struct LoadProgress;
+
+    /**
+     * @class MappedFile
+     * @brief A whole file mapped read-only into the address space.
+     *
+     * Reading a gigabyte of OBJ into a vector costs a gigabyte of memory and a full copy before
+     * parsing can begin. A mapping costs neither: pages arrive on first touch, straight from the
+     * page cache, and several threads can read disjoint parts of it at once.
+     */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /// @return False with @p error set when the file cannot be opened or mapped.
+        bool open(const std::filesystem::path& path, std::string& error);
+        void close();
+
+        /**
+         * @brief Drops the pages of a range that has been read from the process's resident set.
+         *
+         * They stay in the page cache; only this process stops paying for them. Without it a
+         * gigabyte of parsed text stays counted against the load's peak until the file is closed.
+         * A hint: the range is shrunk to whole pages, and failure is ignored.
+         */
+        void release(const uint8_t* begin, size_t size);
+
+        /// @brief First byte of the file, or null for an empty one.
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#endif
+    };
+
+    /// @brief Size of a file for LoadStats::bytesRead; 0 rather than an exception if it is gone.
+    inline uint64_t fileBytes(const std::filesystem::path& path)
+    {
+        std::error_code ec;
+        const uintmax_t size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : static_cast<uint64_t>(size);
+    }
+
+    /// @brief Threads worth starting for load-time work: every core, and never zero.
+    inline unsigned workerCount()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * @brief Calls @p task(i) for every i in [0, count), spread over the worker threads.
+     *
+     * Items are handed out one at a time from a shared counter — the same scheme
+     * TextureCache::preload() uses — so one slow item holds up only the thread that drew it.
+     * Callers size their items accordingly: a few per thread, not one per element.
+     *
+     * An exception thrown by a task, which in practice means std::bad_alloc, is carried back and
+     * rethrown here. Letting it escape a std::thread would terminate the process instead.
+     */
+    template <typename Task>
+    void parallelFor(size_t count, Task&& task)
+    {
+        const size_t threadCount = std::min<size_t>(workerCount(), count);
+        if (threadCount <= 1) {
+            for (size_t i = 0; i < count; ++i) task(i);
+            return;
+        }
+
+        std::atomic<size_t> next{0};
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+
+        auto work = [&] {
+            try {
+                for (size_t i = next++; i < count; i = next++) task(i);
+            } catch (...) {
+                const std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+                next = count;   // the others finish the item they hold and stop
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount - 1);
+        for (size_t t = 1; t < threadCount; ++t) workers.emplace_back(work);
+        work();   // the calling thread takes a share rather than waiting idle
+        for (std::thread& worker : workers) worker.join();
+
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    /**
+     * @class LoadPhaseTimer
+     * @brief Adds the wall time from construction to finish(), or to destruction, to one phase.
+     *
+     * A scope rather than paired calls, so that an early return on a malformed file still closes
+     * the phase it was in.
+     */
+    class LoadPhaseTimer {
+    public:
+        LoadPhaseTimer(LoadStats& stats, const char* name)
+            : m_stats(&stats), m_name(name), m_start(std::chrono::steady_clock::now()) {}
+        ~LoadPhaseTimer() { finish(); }
+
+        LoadPhaseTimer(const LoadPhaseTimer&) = delete;
+        LoadPhaseTimer& operator=(const LoadPhaseTimer&) = delete;
+
+        /// @return The phase's seconds; only the first call records them.
+        double finish();
+
+    private:
+        LoadStats* m_stats;
+        const char* m_name;
+        std::chrono::steady_clock::time_point m_start;
+        bool m_finished = false;
+        double m_seconds = 0.0;
+    };
+
+    /**
+     * @class ReadProgress
+     * @brief Moves a LoadProgress through the reader's half of the bar while the reader works.
+     *
+     * loadMesh() reports the passes itself but cannot see inside a reader, and for a large scene
+     * the reader is most of the wait. A reader cuts its half into stages by what dominates each —
+     * bytes parsed, arrays inflated, corners converted — and advances the stage as it goes, in
+     * steps coarse enough that the atomics cost nothing: a chunk, an array, tens of thousands of
+     * corners. advance() may be called from several threads at once; the bar never moves back.
+     * Without a LoadProgress every call returns at once.
+     */
+    class ReadProgress {
+    public:
+        explicit ReadProgress(LoadProgress* progress) : m_progress(progress) {}
+
+        ReadProgress(const ReadProgress&) = delete;
+        ReadProgress& operator=(const ReadProgress&) = delete;
+
+        /**
+         * @brief Starts the stage that runs from @p from to @p to of the reader's half, and
+         *        will be @p total units long. Call between, never during, parallel work.
+         * @param phase A string literal, as LoadProgress::phase requires.
+         */
+        void stage(const char* phase, float from, float to, uint64_t total);
+
+        /// @brief Counts @p units more of the current stage as done.
+        void advance(uint64_t units);
+
+    private:
+        void raise(float fraction);
+
+        LoadProgress* m_progress;
+        float m_from = 0.0f;
+        float m_to = 0.0f;
+        uint64_t m_total = 0;
+        std::atomic<uint64_t> m_done{ 0 };
+    };
+
+    /**
+     * @class VertexDeduplicator
+     * @brief Collapses the corners of a mesh that describe the same vertex into one.
+     *
+     * OBJ addresses position, normal and texture coordinate with independent indices, and FBX
+     * gives every polygon-vertex a normal and a UV of its own; a GPU wants one index per vertex.
+     * Corners that agree on the position and on @p Attributes — everything else the vertex is
+     * made of — become one vertex.
+     *
+     * A hash map keyed on the whole combination is the obvious implementation and the wrong one
+     * at this scale: San Miguel has around thirty million face-vertices, and a table sized for
+     * that costs a gigabyte before storing a single vertex. Instead each *position* owns a short
+     * chain of the vertices created from it, which is where the combinations actually cluster —
+     * a position typically has one to six distinct normal/uv pairs. Memory is four bytes per
+     * position plus eight, and the attributes, per emitted vertex; lookups stay O(chain length).
+     *
+     * @tparam Attributes Trivially copyable and equality-comparable; kept small, since a lookup
+     *                    compares it once per chain entry.
+     */
+    template <typename Attributes>
+    class VertexDeduplicator {
+    public:
+        explicit VertexDeduplicator(size_t positionCount)
+            : m_head(positionCount, -1) {}
+
+        void reserve(size_t expectedVertices)
+        {
+            m_next.reserve(expectedVertices);
+            m_attributes.reserve(expectedVertices);
+            m_vertex.reserve(expectedVertices);
+        }
+
+        /// @return Index of the vertex for this position and these attributes, calling
+        ///         @p emit to create it if new.
+        template <typename EmitFn>
+        uint32_t resolve(int64_t position, const Attributes& attributes, EmitFn&& emit)
+        {
+            if (position < 0 || static_cast<uint64_t>(position) >= m_head.size()) {
+                // Malformed index. Emit an unshared vertex rather than reject the file.
+                return emit();
+            }
+
+            const size_t slot = static_cast<size_t>(position);
+            for (int32_t entry = m_head[slot]; entry >= 0; entry = m_next[entry]) {
+                if (m_attributes[entry] == attributes) return m_vertex[entry];
+            }
+
+            const uint32_t created = emit();
+            m_next.push_back(m_head[slot]);
+            m_attributes.push_back(attributes);
+            m_vertex.push_back(created);
+            m_head[slot] = static_cast<int32_t>(m_next.size()) - 1;
+            return created;
+        }
+
+    private:
+        std::vector<int32_t>    m_head;        ///< First chain entry per position index.
+        std::vector<int32_t>    m_next;        ///< Next entry in the chain, or -1.
+        std::vector<Attributes> m_attributes;
+        std::vector<uint32_t>   m_vertex;      ///< Index of the vertex created for them.
+    };
+
+} // namespace dmrender
+
+#endif //RENDERING_LOADSUPPORT_HPP
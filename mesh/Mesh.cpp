@@ -1,9 +1,17 @@
 #include "Mesh.hpp"
+#include "LoadSupport.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
 #include <unordered_map>
 
 // tinyobjloader refuses streams above 256 MiB by default — a sane guard against a corrupt file
@@ -19,128 +27,16 @@
 
 namespace dmrender {
 
-    // ─────────────────────────────────────────────────────────────────────────
-    // Normal packing
-    // ─────────────────────────────────────────────────────────────────────────
-
-    uint32_t packNormal(float x, float y, float z)
-    {
-        const float length = std::sqrt(x * x + y * y + z * z);
-        if (length < 1e-20f) { x = 0.0f; y = 1.0f; z = 0.0f; }
-        else                 { x /= length; y /= length; z /= length; }
-
-        // Octahedron mapping: project the unit sphere onto the |x|+|y|+|z| = 1 octahedron, then
-        // unfold its lower half outwards into the corners of the square, so the whole sphere
-        // covers [-1,1]^2 exactly once.
-        const float invL1 = 1.0f / (std::abs(x) + std::abs(y) + std::abs(z));
-        float px = x * invL1;
-        float py = y * invL1;
-
-        if (z < 0.0f) {
-            const float fx = (1.0f - std::abs(py)) * (px >= 0.0f ? 1.0f : -1.0f);
-            const float fy = (1.0f - std::abs(px)) * (py >= 0.0f ? 1.0f : -1.0f);
-            px = fx; py = fy;
-        }
-
-        // Signed 16-bit normalised, matching GLSL's unpackSnorm2x16 exactly.
-        auto quantise = [](float value) -> uint32_t {
-            const float clamped = std::max(-1.0f, std::min(1.0f, value));
-            const int32_t q = static_cast<int32_t>(std::lround(clamped * 32767.0f));
-            return static_cast<uint32_t>(static_cast<uint16_t>(static_cast<int16_t>(q)));
-        };
-        return quantise(px) | (quantise(py) << 16);
-    }
-
-    void unpackNormal(uint32_t packed, float out[3])
-    {
-        // Exactly the inverse of the mapping above, and the same arithmetic the shaders do.
-        auto dequantise = [](uint32_t bits) -> float {
-            const int16_t signedValue = static_cast<int16_t>(static_cast<uint16_t>(bits));
-            return std::max(-1.0f, static_cast<float>(signedValue) / 32767.0f);
-        };
-        float x = dequantise(packed & 0xFFFFu);
-        float y = dequantise((packed >> 16) & 0xFFFFu);
-        float z = 1.0f - (std::abs(x) + std::abs(y));
-
-        // Below the fold, the square's corners hold the lower hemisphere; fold them back.
-        if (z < 0.0f) {
-            const float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
-            const float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
-            x = fx; y = fy;
-        }
-
-        const float length = std::sqrt(x * x + y * y + z * z);
-        if (length < 1e-20f) { out[0] = 0.0f; out[1] = 1.0f; out[2] = 0.0f; return; }
-        out[0] = x / length;
-        out[1] = y / length;
-        out[2] = z / length;
-    }
-
     namespace {
 
-        // ─────────────────────────────────────────────────────────────────────
-        // Vertex deduplication
-        //
-        // An OBJ addresses position, normal and texture coordinate with independent indices,
-        // which no GPU can do — it wants one index per vertex. Collapsing each unique
-        // combination into a single vertex bridges the two models.
-        //
-        // A hash map keyed on the triple is the obvious implementation and the wrong one at this
-        // scale: San Miguel has around thirty million face-vertices, and a table sized for that
-        // costs a gigabyte before storing a single vertex. Instead each *position* owns a short
-        // chain of the vertices created from it, which is where the combinations actually cluster
-        // — a position typically has one to six distinct normal/uv pairs. Memory is four bytes
-        // per position plus sixteen per emitted vertex, and lookups stay O(chain length).
-        // ─────────────────────────────────────────────────────────────────────
-        class VertexDeduplicator {
-        public:
-            explicit VertexDeduplicator(size_t positionCount)
-                : m_head(positionCount, -1) {}
-
-            void reserve(size_t expectedVertices)
-            {
-                m_next.reserve(expectedVertices);
-                m_normal.reserve(expectedVertices);
-                m_texCoord.reserve(expectedVertices);
-                m_vertex.reserve(expectedVertices);
-            }
-
-            /// @return Index of the vertex for this attribute triple, creating it if new.
-            template <typename EmitFn>
-            uint32_t resolve(int position, int normal, int texCoord, EmitFn&& emit)
-            {
-                if (position < 0 || static_cast<size_t>(position) >= m_head.size()) {
-                    // Malformed index. Emit an unshared vertex rather than reject the file.
-                    return emit();
-                }
-
-                for (int32_t entry = m_head[position]; entry >= 0; entry = m_next[entry]) {
-                    if (m_normal[entry] == normal && m_texCoord[entry] == texCoord) {
-                        return m_vertex[entry];
-                    }
-                }
-
-                const uint32_t created = emit();
-                m_next.push_back(m_head[position]);
-                m_normal.push_back(normal);
-                m_texCoord.push_back(texCoord);
-                m_vertex.push_back(created);
-                m_head[position] = static_cast<int32_t>(m_next.size()) - 1;
-                return created;
-            }
-
-        private:
-            std::vector<int32_t>  m_head;      ///< First chain entry per position index.
-            std::vector<int32_t>  m_next;      ///< Next entry in the chain, or -1.
-            std::vector<int32_t>  m_normal;
-            std::vector<int32_t>  m_texCoord;
-            std::vector<uint32_t> m_vertex;    ///< Index into Mesh::vertices.
-        };
-
         // ─────────────────────────────────────────────────────────────────────
         // Shared post-processing
         // ─────────────────────────────────────────────────────────────────────
 
+        /// Below this many triangles the partitioning passes of the parallel path cost more
+        /// than the threads win back.
+        constexpr size_t kParallelNormalTriangles = size_t(1) << 18;
+
         /**
          * @brief Generates smooth normals by area-weighted averaging of face normals.
          *
@@ -148,16 +44,25 @@ namespace dmrender {
          * triangle's area, so *not* normalising it before accumulation weights each face by its
          * area automatically. That is what stops a dense cluster of tiny triangles from
          * outvoting one large neighbouring face and denting the shading.
+         *
+         * The serial form scatters every face normal into its three vertices, which cannot be
+         * split across threads without two of them adding into the same vertex. The parallel
+         * form partitions instead: vertices are cut into ranges, every corner is bucketed by the
+         * range its vertex falls in — keeping file order within a bucket — and each range then
+         * accumulates only into vertices it owns. No two threads touch one vertex, no atomics
+         * are needed, and since every vertex still receives its faces in index order, the float
+         * sums, and so the normals, are bit-identical to the serial ones.
          */
         void generateSmoothNormals(std::vector<MeshVertex>& vertices,
                                    const std::vector<uint32_t>& indices)
         {
+            const size_t triangleCount = indices.size() / 3;
             std::vector<float> accumulated(vertices.size() * 3, 0.0f);
 
-            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
-                const MeshVertex& a = vertices[indices[i + 0]];
-                const MeshVertex& b = vertices[indices[i + 1]];
-                const MeshVertex& c = vertices[indices[i + 2]];
+            auto faceNormal = [&](size_t triangle, float out[3]) {
+                const MeshVertex& a = vertices[indices[triangle * 3 + 0]];
+                const MeshVertex& b = vertices[indices[triangle * 3 + 1]];
+                const MeshVertex& c = vertices[indices[triangle * 3 + 2]];
 
                 const float e1[3] = { b.position[0] - a.position[0],
                                       b.position[1] - a.position[1],
@@ -166,32 +71,98 @@ namespace dmrender {
                                       c.position[1] - a.position[1],
                                       c.position[2] - a.position[2] };
 
-                const float faceNormal[3] = {
-                    e1[1] * e2[2] - e1[2] * e2[1],
-                    e1[2] * e2[0] - e1[0] * e2[2],
-                    e1[0] * e2[1] - e1[1] * e2[0]
-                };
+                out[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                out[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                out[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            };
 
-                for (int corner = 0; corner < 3; ++corner) {
-                    const size_t base = static_cast<size_t>(indices[i + corner]) * 3;
-                    accumulated[base + 0] += faceNormal[0];
-                    accumulated[base + 1] += faceNormal[1];
-                    accumulated[base + 2] += faceNormal[2];
+            if (workerCount() == 1 || triangleCount < kParallelNormalTriangles) {
+                for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+                    float normal[3];
+                    faceNormal(triangle, normal);
+                    for (int corner = 0; corner < 3; ++corner) {
+                        const size_t base = static_cast<size_t>(indices[triangle * 3 + corner]) * 3;
+                        accumulated[base + 0] += normal[0];
+                        accumulated[base + 1] += normal[1];
+                        accumulated[base + 2] += normal[2];
+                    }
+                }
+            } else {
+                constexpr size_t kPieceTriangles = size_t(1) << 16;
+                const size_t pieceCount = (triangleCount + kPieceTriangles - 1) / kPieceTriangles;
+                const size_t cornerCount = triangleCount * 3;
+
+                std::vector<float> faceNormals(triangleCount * 3);
+                parallelFor(pieceCount, [&](size_t p) {
+                    const size_t end = std::min(triangleCount, (p + 1) * kPieceTriangles);
+                    for (size_t triangle = p * kPieceTriangles; triangle < end; ++triangle) {
+                        faceNormal(triangle, &faceNormals[triangle * 3]);
+                    }
+                });
+
+                // ── Bucket corners by the vertex range they write to, in index order ──
+                const size_t rangeCount = std::min<size_t>(workerCount() * 4, std::max<size_t>(1, vertices.size()));
+                const size_t rangeWidth = (vertices.size() + rangeCount - 1) / rangeCount;
+
+                std::vector<uint32_t> bucketCounts(pieceCount * rangeCount, 0);
+                parallelFor(pieceCount, [&](size_t p) {
+                    uint32_t* counts = &bucketCounts[p * rangeCount];
+                    const size_t end = std::min(cornerCount, (p + 1) * kPieceTriangles * 3);
+                    for (size_t corner = p * kPieceTriangles * 3; corner < end; ++corner) {
+                        ++counts[indices[corner] / rangeWidth];
+                    }
+                });
+                std::vector<size_t> bucketOffsets(pieceCount * rangeCount);
+                std::vector<size_t> rangeStarts(rangeCount + 1, 0);
+                size_t running = 0;
+                for (size_t r = 0; r < rangeCount; ++r) {
+                    rangeStarts[r] = running;
+                    for (size_t p = 0; p < pieceCount; ++p) {
+                        bucketOffsets[p * rangeCount + r] = running;
+                        running += bucketCounts[p * rangeCount + r];
+                    }
                 }
+                rangeStarts[rangeCount] = running;
+
+                std::vector<uint32_t> buckets(cornerCount);
+                parallelFor(pieceCount, [&](size_t p) {
+                    size_t* cursor = &bucketOffsets[p * rangeCount];
+                    const size_t end = std::min(cornerCount, (p + 1) * kPieceTriangles * 3);
+                    for (size_t corner = p * kPieceTriangles * 3; corner < end; ++corner) {
+                        buckets[cursor[indices[corner] / rangeWidth]++] = static_cast<uint32_t>(corner);
+                    }
+                });
+
+                // ── Each range accumulates into the vertices it owns ──
+                parallelFor(rangeCount, [&](size_t r) {
+                    for (size_t b = rangeStarts[r]; b < rangeStarts[r + 1]; ++b) {
+                        const uint32_t corner = buckets[b];
+                        const float* normal = &faceNormals[(corner / 3) * 3];
+                        const size_t base = static_cast<size_t>(indices[corner]) * 3;
+                        accumulated[base + 0] += normal[0];
+                        accumulated[base + 1] += normal[1];
+                        accumulated[base + 2] += normal[2];
+                    }
+                });
             }
 
-            for (size_t v = 0; v < vertices.size(); ++v) {
-                const float x = accumulated[v * 3 + 0];
-                const float y = accumulated[v * 3 + 1];
-                const float z = accumulated[v * 3 + 2];
-                if (x * x + y * y + z * z > 1e-24f) {
-                    vertices[v].packedNormal = packNormal(x, y, z);
-                } else {
-                    // Degenerate or unreferenced vertex. Any unit vector beats a zero normal,
-                    // which would light the surface black.
-                    vertices[v].packedNormal = packNormal(0.0f, 1.0f, 0.0f);
+            constexpr size_t kPieceVertices = size_t(1) << 16;
+            parallelFor((vertices.size() + kPieceVertices - 1) / kPieceVertices, [&](size_t p) {
+                const size_t first = p * kPieceVertices;
+                const size_t count = std::min(vertices.size(), first + kPieceVertices) - first;
+                float* sums = &accumulated[first * 3];
+                for (size_t v = 0; v < count; ++v) {
+                    float* sum = sums + v * 3;
+                    if (sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2] <= 1e-24f) {
+                        // Degenerate or unreferenced vertex. Any unit vector beats a zero normal,
+                        // which would light the surface black.
+                        sum[0] = 0.0f; sum[1] = 1.0f; sum[2] = 0.0f;
+                    }
                 }
-            }
+                std::vector<uint32_t> packed(count);
+                packNormals(sums, packed.data(), count);
+                for (size_t v = 0; v < count; ++v) vertices[first + v].packedNormal = packed[v];
+            });
         }
 
         void computeBounds(Mesh& mesh)
@@ -205,9 +176,32 @@ namespace dmrender {
                     }
                 }
                 if (subset.indexCount == 0) continue;
-                for (int axis = 0; axis < 3; ++axis) {
-                    mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], subset.boundsMin[axis]);
-                    mesh.boundsMax[axis] = std::max(mesh.boundsMax[axis], subset.boundsMax[axis]);
+                if (subset.instanceCount == 0) {
+                    for (int axis = 0; axis < 3; ++axis) {
+                        mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], subset.boundsMin[axis]);
+                        mesh.boundsMax[axis] = std::max(mesh.boundsMax[axis], subset.boundsMax[axis]);
+                    }
+                    continue;
+                }
+
+                // An instanced subset's bounds are those of its shape, and the scene holds each
+                // placed copy of it instead.
+                const std::array<float, 3> center = subset.center();
+                for (uint32_t k = 0; k < subset.instanceCount; ++k) {
+                    MeshInstance& instance = mesh.instances[subset.firstInstance + k];
+                    instance.apply(center.data(), instance.center);
+                    instance.radius = subset.radius() * instance.scale;
+                    for (int corner = 0; corner < 8; ++corner) {
+                        float point[3], placed[3];
+                        for (int axis = 0; axis < 3; ++axis) {
+                            point[axis] = (corner >> axis) & 1 ? subset.boundsMax[axis] : subset.boundsMin[axis];
+                        }
+                        instance.apply(point, placed);
+                        for (int axis = 0; axis < 3; ++axis) {
+                            mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], placed[axis]);
+                            mesh.boundsMax[axis] = std::max(mesh.boundsMax[axis], placed[axis]);
+                        }
+                    }
                 }
             }
         }
@@ -229,30 +223,664 @@ namespace dmrender {
 
         // ─────────────────────────────────────────────────────────────────────
         // OBJ
+        //
+        // Two readers feed one converter. The native reader maps the file and parses it in
+        // parallel chunks; tinyobjloader reads it serially through a stream. Both produce ObjData
+        // — the arrays tinyobjloader's attrib_t and shape_t hold — so the conversion below, and
+        // with it the mesh, does not depend on which one ran.
+        //
+        // The native reader covers what exporters actually write: triangles and quads with
+        // absolute or relative indices. Anything else (larger polygons, broken indices, malformed
+        // numbers) makes it decline, and tinyobjloader reads the file instead — either handling
+        // the construct or failing with the message the viewer has always reported.
         // ─────────────────────────────────────────────────────────────────────
 
-        bool loadObj(const std::filesystem::path& path, Mesh& mesh, std::string& error)
+        /// @brief Triangles in file order, laid out as tinyobjloader's shape_t stores them.
+        struct ObjFaceBlock {
+            std::vector<tinyobj::index_t> indices;       ///< Three per triangle.
+            std::vector<int>              materialIds;   ///< One per triangle; -1 for none.
+            std::vector<uint32_t>         groupStarts;   ///< Triangles that open a `g`/`o` group.
+            bool startsGroup = true;                     ///< Whether the first triangle does.
+        };
+
+        struct ObjData {
+            std::vector<float> positions;   ///< Three per `v`.
+            std::vector<float> normals;     ///< Three per `vn`.
+            /// `vn`, packed once each by buildObjMesh() before any vertex is made from them.
+            std::vector<uint32_t> packedNormals;
+            std::vector<float> texCoords;   ///< Two per `vt`.
+            std::vector<ObjFaceBlock> blocks;
+            std::vector<tinyobj::material_t> materials;
+        };
+
+        bool readObjTinyobj(const std::filesystem::path& path, ObjData& data, std::string& error)
         {
-            tinyobj::ObjReaderConfig config;
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::string warnings;
+            std::string errors;
             // Materials are referenced by a bare filename inside the .obj, so the search path is
             // the model's own directory rather than the working directory.
-            config.mtl_search_path = path.parent_path().string();
-            config.triangulate = true;
-
-            tinyobj::ObjReader reader;
-            if (!reader.ParseFromFile(path.string(), config)) {
-                error = reader.Error().empty() ? "failed to parse OBJ" : reader.Error();
+            const std::string materialDirectory = path.parent_path().string();
+            if (!tinyobj::LoadObj(&attrib, &shapes, &data.materials, &warnings, &errors,
+                                  path.string().c_str(), materialDirectory.c_str(),
+                                  /*triangulate=*/true, /*default_vcols_fallback=*/true)) {
+                error = errors.empty() ? "failed to parse OBJ" : errors;
                 return false;
             }
 
-            const tinyobj::attrib_t& attrib = reader.GetAttrib();
-            const std::vector<tinyobj::shape_t>& shapes = reader.GetShapes();
-            const std::vector<tinyobj::material_t>& objMaterials = reader.GetMaterials();
+            data.positions = std::move(attrib.vertices);
+            data.normals   = std::move(attrib.normals);
+            data.texCoords = std::move(attrib.texcoords);
+
+            // Each shape ends at a `g` or `o` line, so each one opens a group. What the blocks do
+            // not take — per-face corner counts and smoothing groups — goes with the shape.
+            data.blocks.reserve(shapes.size());
+            for (tinyobj::shape_t& shape : shapes) {
+                ObjFaceBlock block;
+                block.indices     = std::move(shape.mesh.indices);
+                block.materialIds = std::move(shape.mesh.material_ids);
+                data.blocks.push_back(std::move(block));
+                shape = tinyobj::shape_t{};
+            }
+            return true;
+        }
+
+        /// @brief A `usemtl` name or the rest of an `mtllib` line, kept until all chunks are in.
+        struct ObjDirective {
+            bool        library = false;
+            std::string text;
+        };
+
+        /**
+         * @brief One newline-aligned slice of the file and everything parsed out of it.
+         *
+         * A chunk cannot know how many elements precede it, so indices are stored relative to
+         * its own start wherever that matters and fixed up once every chunk has been counted.
+         * The same goes for materials — a chunk sees `usemtl` names but not the libraries earlier
+         * chunks loaded — and for the diagonal of a quad, which needs positions from anywhere
+         * in the file.
+         */
+        struct ObjChunk {
+            const char* begin = nullptr;
+            const char* end   = nullptr;
+
+            std::vector<float> positions;
+            std::vector<float> normals;
+            std::vector<float> texCoords;
+            /// materialIds hold this chunk's `usemtl` ordinal, or -1 for whatever was active before.
+            ObjFaceBlock block;
+
+            std::vector<ObjDirective> directives;
+            int lastMaterialSlot = -1;          ///< Ordinal of the last `usemtl`, if any.
+            std::vector<size_t> relative;       ///< index * 3 + field of every relative index.
+            std::vector<size_t> quads;          ///< First of the six indices of every quad.
+            bool groupPending = false;          ///< A `g`/`o` line follows the last triangle.
+
+            size_t positionBase = 0;            ///< Floats before this chunk, per attribute.
+            size_t normalBase   = 0;
+            size_t texCoordBase = 0;
+            size_t materialBase = 0;            ///< `usemtl` lines before this chunk.
+
+            const char* declined = nullptr;     ///< Why the native reader cannot take this file.
+        };
+
+        /// @brief Field 0, 1 or 2 of an index — the encoding ObjChunk::relative uses.
+        int& objIndexField(tinyobj::index_t& index, size_t field)
+        {
+            if (field == 0) return index.vertex_index;
+            if (field == 1) return index.normal_index;
+            return index.texcoord_index;
+        }
+
+        bool isObjSpace(char c) { return c == ' ' || c == '\t'; }
+
+        /// @brief One number, parsed exactly as tinyobjloader does so both readers agree to the bit.
+        bool parseObjReal(const char*& p, const char* lineEnd, float& out)
+        {
+            while (p < lineEnd && isObjSpace(*p)) ++p;
+            const char* start = p;
+            while (p < lineEnd && !isObjSpace(*p)) ++p;
+            double value = 0.0;   // a missing component reads as zero
+            if (p != start && !tinyobj::tryParseDouble(start, p, &value)) return false;
+            out = static_cast<float>(value);
+            return true;
+        }
+
+        /// @brief One index of a face corner. As in tinyobjloader, anything unreadable is 0.
+        int parseObjIndex(const char*& p, const char* lineEnd)
+        {
+            const char* start = p;
+            bool negative = false;
+            if (p < lineEnd && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+            int64_t value = 0;
+            while (p < lineEnd && *p >= '0' && *p <= '9') {
+                if (value <= (int64_t(1) << 32)) value = value * 10 + (*p - '0');
+                ++p;
+            }
+            if (p - start > 63) value = 0;   // longer than tinyobjloader's token buffer
+            if (negative) value = -value;
+            if (value > INT32_MAX || value < INT32_MIN) value = 0;
+
+            // Skip whatever trails the digits, up to the next separator.
+            while (p < lineEnd && *p != '/' && !isObjSpace(*p)) ++p;
+            return static_cast<int>(value);
+        }
+
+        void parseObjChunk(ObjChunk& chunk, bool atFileStart)
+        {
+            struct Corner {
+                tinyobj::index_t index;
+                bool relative[3];
+            };
+            std::vector<Corner> corners;
+            int materialSlot = -1;
+
+            // Resolves one raw index against this chunk's element count. Zero means "absent" for
+            // normals and texture coordinates and is an error for positions, as in the spec.
+            auto resolve = [](int raw, size_t localCount, Corner& corner, size_t field) {
+                int& value = objIndexField(corner.index, field);
+                corner.relative[field] = raw < 0;
+                value = raw > 0 ? raw - 1 : raw < 0 ? static_cast<int>(localCount) + raw : -1;
+            };
+
+            auto emitTriangle = [&](const Corner& a, const Corner& b, const Corner& c) {
+                ObjFaceBlock& block = chunk.block;
+                if (chunk.groupPending) {
+                    block.groupStarts.push_back(static_cast<uint32_t>(block.materialIds.size()));
+                    chunk.groupPending = false;
+                }
+                block.materialIds.push_back(materialSlot);
+                for (const Corner* corner : { &a, &b, &c }) {
+                    const size_t slot = block.indices.size();
+                    for (size_t field = 0; field < 3; ++field) {
+                        if (corner->relative[field]) chunk.relative.push_back(slot * 3 + field);
+                    }
+                    block.indices.push_back(corner->index);
+                }
+            };
+
+            const char* p = chunk.begin;
+            if (atFileStart && chunk.end - p >= 3 && static_cast<unsigned char>(p[0]) == 0xEF &&
+                static_cast<unsigned char>(p[1]) == 0xBB && static_cast<unsigned char>(p[2]) == 0xBF) {
+                p += 3;   // UTF-8 byte order mark
+            }
+
+            while (p < chunk.end) {
+                // A line ends at \n, \r or \r\n, like tinyobjloader's; a stray NUL ends its content.
+                const char* lineEnd = p;
+                while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r' && *lineEnd != '\0') {
+                    ++lineEnd;
+                }
+                const char* next = lineEnd;
+                while (next < chunk.end && *next != '\n' && *next != '\r') ++next;
+                if (next < chunk.end) next += (*next == '\r' && next + 1 < chunk.end && next[1] == '\n') ? 2 : 1;
+
+                while (p < lineEnd && isObjSpace(*p)) ++p;
+                const size_t length = static_cast<size_t>(lineEnd - p);
+                if (length < 2 || *p == '#') { p = next; continue; }
+
+                if (p[0] == 'v' && isObjSpace(p[1])) {
+                    p += 2;
+                    float xyz[3];
+                    if (!parseObjReal(p, lineEnd, xyz[0]) || !parseObjReal(p, lineEnd, xyz[1]) ||
+                        !parseObjReal(p, lineEnd, xyz[2])) {
+                        chunk.declined = "malformed number";
+                        return;
+                    }
+                    chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+                } else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && isObjSpace(p[2])) {
+                    p += 3;
+                    float xyz[3];
+                    if (!parseObjReal(p, lineEnd, xyz[0]) || !parseObjReal(p, lineEnd, xyz[1]) ||
+                        !parseObjReal(p, lineEnd, xyz[2])) {
+                        chunk.declined = "malformed number";
+                        return;
+                    }
+                    chunk.normals.insert(chunk.normals.end(), xyz, xyz + 3);
+                } else if (length >= 3 && p[0] == 'v' && p[1] == 't' && isObjSpace(p[2])) {
+                    p += 3;
+                    float uv[2];
+                    if (!parseObjReal(p, lineEnd, uv[0]) || !parseObjReal(p, lineEnd, uv[1])) {
+                        chunk.declined = "malformed number";
+                        return;
+                    }
+                    chunk.texCoords.insert(chunk.texCoords.end(), uv, uv + 2);
+                } else if (p[0] == 'f' && isObjSpace(p[1])) {
+                    p += 2;
+                    corners.clear();
+                    for (;;) {
+                        while (p < lineEnd && isObjSpace(*p)) ++p;
+                        if (p >= lineEnd || *p == '#') break;
+
+                        Corner corner{};
+                        const int position = parseObjIndex(p, lineEnd);
+                        if (position == 0) { chunk.declined = "zero vertex index"; return; }
+                        resolve(position, chunk.positions.size() / 3, corner, 0);
+                        corner.index.normal_index = -1;
+                        corner.index.texcoord_index = -1;
+
+                        if (p < lineEnd && *p == '/') {
+                            ++p;
+                            if (p < lineEnd && *p == '/') {
+                                ++p;
+                                resolve(parseObjIndex(p, lineEnd), chunk.normals.size() / 3, corner, 1);
+                            } else {
+                                resolve(parseObjIndex(p, lineEnd), chunk.texCoords.size() / 2, corner, 2);
+                                if (p < lineEnd && *p == '/') {
+                                    ++p;
+                                    resolve(parseObjIndex(p, lineEnd), chunk.normals.size() / 3, corner, 1);
+                                }
+                            }
+                        }
+                        corners.push_back(corner);
+                    }
+
+                    if (corners.size() == 3) {
+                        emitTriangle(corners[0], corners[1], corners[2]);
+                    } else if (corners.size() == 4) {
+                        // Split along 0-2 for now; the stitch pass picks the shorter diagonal.
+                        chunk.quads.push_back(chunk.block.indices.size());
+                        emitTriangle(corners[0], corners[1], corners[2]);
+                        emitTriangle(corners[0], corners[2], corners[3]);
+                    } else if (corners.size() > 4) {
+                        chunk.declined = "polygon with more than four corners";
+                        return;
+                    }
+                    // Fewer than three corners: degenerate, dropped like tinyobjloader does.
+                } else if (length >= 7 && std::memcmp(p, "usemtl", 6) == 0 && isObjSpace(p[6])) {
+                    p += 6;
+                    while (p < lineEnd && isObjSpace(*p)) ++p;
+                    const char* nameEnd = p;
+                    while (nameEnd < lineEnd && !isObjSpace(*nameEnd)) ++nameEnd;
+                    chunk.directives.push_back({ false, std::string(p, nameEnd) });
+                    materialSlot = ++chunk.lastMaterialSlot;
+                } else if (length >= 7 && std::memcmp(p, "mtllib", 6) == 0 && isObjSpace(p[6])) {
+                    chunk.directives.push_back({ true, std::string(p + 7, lineEnd) });
+                } else if ((p[0] == 'g' || p[0] == 'o') && isObjSpace(p[1])) {
+                    chunk.groupPending = true;
+                }
+                // Everything else — smoothing groups, lines, points, tags — carries nothing the
+                // renderer uses.
+                p = next;
+            }
+        }
+
+        /**
+         * @brief Parses @p path in parallel chunks straight out of a file mapping.
+         * @param[out] reason Why the file was not read, when false is returned.
+         * @param read Advanced by the bytes of every chunk parsed.
+         */
+        bool readObjNative(const std::filesystem::path& path, ObjData& data, std::string& reason,
+                           ReadProgress& read)
+        {
+            MappedFile file;
+            if (!file.open(path, reason)) return false;
+            const char* text = reinterpret_cast<const char*>(file.data());
+            const char* textEnd = text + file.size();
+
+            // Chunks end just past a newline so that no line is split. Eight megabytes makes the
+            // per-chunk overhead vanish and still cuts San Miguel into well over a hundred pieces,
+            // enough to keep every core busy until the end.
+            constexpr size_t kChunkBytes = size_t(8) << 20;
+            std::vector<ObjChunk> chunks;
+            for (const char* begin = text; begin < textEnd;) {
+                const char* end = textEnd;
+                if (static_cast<size_t>(textEnd - begin) > kChunkBytes) {
+                    const char* probe = begin + kChunkBytes;
+                    const void* newline = std::memchr(probe, '\n', static_cast<size_t>(textEnd - probe));
+                    if (newline) end = static_cast<const char*>(newline) + 1;
+                }
+                chunks.emplace_back();
+                chunks.back().begin = begin;
+                chunks.back().end = end;
+                begin = end;
+            }
+
+            read.stage("reading", 0.0f, 0.7f, file.size());
+            parallelFor(chunks.size(), [&](size_t i) {
+                parseObjChunk(chunks[i], i == 0);
+                read.advance(static_cast<uint64_t>(chunks[i].end - chunks[i].begin));
+                // Everything the chunk needs has been copied out; its text need not stay resident.
+                file.release(reinterpret_cast<const uint8_t*>(chunks[i].begin),
+                             static_cast<size_t>(chunks[i].end - chunks[i].begin));
+            });
+            for (const ObjChunk& chunk : chunks) {
+                if (chunk.declined) { reason = chunk.declined; return false; }
+            }
+
+            // ── Stitch: attributes concatenate in chunk order ──
+            size_t positionFloats = 0, normalFloats = 0, texCoordFloats = 0;
+            for (ObjChunk& chunk : chunks) {
+                chunk.positionBase = positionFloats;
+                chunk.normalBase   = normalFloats;
+                chunk.texCoordBase = texCoordFloats;
+                positionFloats += chunk.positions.size();
+                normalFloats   += chunk.normals.size();
+                texCoordFloats += chunk.texCoords.size();
+            }
+            data.positions.resize(positionFloats);
+            data.normals.resize(normalFloats);
+            data.texCoords.resize(texCoordFloats);
+
+            parallelFor(chunks.size(), [&](size_t i) {
+                ObjChunk& chunk = chunks[i];
+                std::copy(chunk.positions.begin(), chunk.positions.end(),
+                          data.positions.begin() + static_cast<std::ptrdiff_t>(chunk.positionBase));
+                std::copy(chunk.normals.begin(), chunk.normals.end(),
+                          data.normals.begin() + static_cast<std::ptrdiff_t>(chunk.normalBase));
+                std::copy(chunk.texCoords.begin(), chunk.texCoords.end(),
+                          data.texCoords.begin() + static_cast<std::ptrdiff_t>(chunk.texCoordBase));
+                chunk.positions = {};
+                chunk.normals   = {};
+                chunk.texCoords = {};
+            });
+
+            // ── Relative indices, bounds and quad diagonals, now that every element is in place ──
+            const size_t positionCount = data.positions.size() / 3;
+            const size_t normalCount   = data.normals.size() / 3;
+            const size_t texCoordCount = data.texCoords.size() / 2;
+            parallelFor(chunks.size(), [&](size_t i) {
+                ObjChunk& chunk = chunks[i];
+                const int base[3] = { static_cast<int>(chunk.positionBase / 3),
+                                      static_cast<int>(chunk.normalBase / 3),
+                                      static_cast<int>(chunk.texCoordBase / 2) };
+                for (size_t slot : chunk.relative) {
+                    int& value = objIndexField(chunk.block.indices[slot / 3], slot % 3);
+                    value += base[slot % 3];
+                    if (value < 0) { chunk.declined = "relative index before the first element"; return; }
+                }
+
+                // Every corner names a position; normals and texture coordinates are optional
+                // (-1). Anything past the end of its array is broken, and tinyobjloader decides.
+                for (const tinyobj::index_t& corner : chunk.block.indices) {
+                    if (corner.vertex_index < 0 || static_cast<size_t>(corner.vertex_index) >= positionCount ||
+                        (corner.normal_index >= 0 && static_cast<size_t>(corner.normal_index) >= normalCount) ||
+                        (corner.texcoord_index >= 0 && static_cast<size_t>(corner.texcoord_index) >= texCoordCount)) {
+                        chunk.declined = "face with an invalid index";
+                        return;
+                    }
+                }
+
+                for (size_t first : chunk.quads) {
+                    tinyobj::index_t* quad = &chunk.block.indices[first];
+                    const tinyobj::index_t c0 = quad[0], c1 = quad[1], c2 = quad[2], c3 = quad[5];
+                    // The diagonal tinyobjloader picks — the shorter one — in the same float
+                    // arithmetic, so both readers triangulate identically.
+                    const float* v0 = &data.positions[static_cast<size_t>(c0.vertex_index) * 3];
+                    const float* v1 = &data.positions[static_cast<size_t>(c1.vertex_index) * 3];
+                    const float* v2 = &data.positions[static_cast<size_t>(c2.vertex_index) * 3];
+                    const float* v3 = &data.positions[static_cast<size_t>(c3.vertex_index) * 3];
+                    const float e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+                    const float e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+                    const float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+                    const float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+                    if (!(sqr02 < sqr13)) {
+                        quad[0] = c0; quad[1] = c1; quad[2] = c3;
+                        quad[3] = c1; quad[4] = c2; quad[5] = c3;
+                    }
+                }
+                chunk.relative = {};
+                chunk.quads = {};
+            });
+            for (const ObjChunk& chunk : chunks) {
+                if (chunk.declined) { reason = chunk.declined; return false; }
+            }
+
+            // ── Materials, serially: a `usemtl` sees only the libraries loaded before it ──
+            std::string materialDirectory = path.parent_path().string();
+            if (!materialDirectory.empty()) {
+                const char separator = static_cast<char>(std::filesystem::path::preferred_separator);
+                if (materialDirectory.back() != separator) materialDirectory += separator;
+            }
+            tinyobj::MaterialFileReader materialReader(materialDirectory);
+            std::map<std::string, int> materialMap;
+            std::set<std::string> loadedLibraries;
+            std::vector<int> slotMaterials;
+
+            for (ObjChunk& chunk : chunks) {
+                chunk.materialBase = slotMaterials.size();
+                for (const ObjDirective& directive : chunk.directives) {
+                    if (!directive.library) {
+                        const auto found = materialMap.find(directive.text);
+                        slotMaterials.push_back(found != materialMap.end() ? found->second : -1);
+                        continue;
+                    }
+                    // Several names may follow `mtllib`; the first one that loads wins.
+                    std::vector<std::string> names;
+                    tinyobj::SplitString(tinyobj::trimTrailingWhitespace(directive.text), ' ', '\\', names);
+                    tinyobj::RemoveEmptyTokens(&names);
+                    for (const std::string& name : names) {
+                        if (loadedLibraries.count(name) > 0) continue;
+                        std::string warnings, errors;
+                        if (materialReader(name, &data.materials, &materialMap, &warnings, &errors)) {
+                            loadedLibraries.insert(name);
+                            break;
+                        }
+                    }
+                }
+                chunk.directives = {};
+            }
+
+            std::vector<int> entryMaterials(chunks.size(), -1);
+            for (size_t i = 1; i < chunks.size(); ++i) {
+                const ObjChunk& previous = chunks[i - 1];
+                entryMaterials[i] = previous.lastMaterialSlot >= 0
+                    ? slotMaterials[previous.materialBase + static_cast<size_t>(previous.lastMaterialSlot)]
+                    : entryMaterials[i - 1];
+            }
+            parallelFor(chunks.size(), [&](size_t i) {
+                ObjChunk& chunk = chunks[i];
+                for (int& id : chunk.block.materialIds) {
+                    id = id < 0 ? entryMaterials[i] : slotMaterials[chunk.materialBase + static_cast<size_t>(id)];
+                }
+            });
+
+            // ── Blocks. A chunk boundary is not a group boundary; a `g` line just before one is ──
+            bool groupPending = true;   // the first triangle always opens a group
+            for (ObjChunk& chunk : chunks) {
+                if (chunk.block.materialIds.empty()) {
+                    groupPending = groupPending || chunk.groupPending;
+                    continue;
+                }
+                chunk.block.startsGroup = groupPending;
+                groupPending = chunk.groupPending;
+                data.blocks.push_back(std::move(chunk.block));
+            }
+            return true;
+        }
+
+        /// @brief What, besides its position, an OBJ face corner is deduplicated on.
+        struct ObjCornerAttributes {
+            int normal;
+            int texCoord;
+            bool operator==(const ObjCornerAttributes& other) const {
+                return normal == other.normal && texCoord == other.texCoord;
+            }
+        };
+
+        /// @brief The vertex one OBJ face corner describes.
+        MeshVertex makeObjVertex(const ObjData& data, const tinyobj::index_t& source)
+        {
+            MeshVertex vertex{};
+            if (source.vertex_index >= 0) {
+                const size_t base = static_cast<size_t>(source.vertex_index) * 3;
+                vertex.position[0] = data.positions[base + 0];
+                vertex.position[1] = data.positions[base + 1];
+                vertex.position[2] = data.positions[base + 2];
+            }
+            if (source.normal_index >= 0) {
+                vertex.packedNormal = data.packedNormals[static_cast<size_t>(source.normal_index)];
+            }
+            if (source.texcoord_index >= 0) {
+                const size_t base = static_cast<size_t>(source.texcoord_index) * 2;
+                vertex.uv[0] = data.texCoords[base + 0];
+                // OBJ's V axis points up, texture space points down.
+                vertex.uv[1] = 1.0f - data.texCoords[base + 1];
+            }
+            return vertex;
+        }
+
+        /// Below this many face corners the parallel deduplication's extra passes cost more
+        /// than the threads win back.
+        constexpr size_t kParallelDedupCorners = size_t(1) << 20;
+
+        /**
+         * @brief VertexDeduplicator's work spread over threads, with exactly the serial result.
+         *
+         * Chains never cross positions, so the positions can be cut into ranges — shards — and
+         * each shard deduplicated on its own, with its own chains. A shard walks its corners in
+         * file order and so discovers its vertices in the order the serial pass would; what it
+         * cannot know is how its discoveries interleave with those of other shards. Flagging
+         * every corner that created a vertex and taking a prefix sum over the flags, in corner
+         * order, recovers exactly that: the serial index of every vertex.
+         *
+         * Five passes, each parallel: bucket corners by shard, deduplicate each shard, count
+         * vertices per piece of the corner stream, place vertices at their final index, and
+         * rewrite the shard-local indices. Memory on top of the mesh is five bytes per corner.
+         */
+        void deduplicateObjParallel(const ObjData& data, Mesh& mesh)
+        {
+            // A piece is a run of consecutive corners within one block, the unit of every pass
+            // that walks the corner stream.
+            struct Piece {
+                const tinyobj::index_t* corners;
+                size_t first;   ///< Index of the first corner in the whole stream.
+                size_t count;
+            };
+            constexpr size_t kPieceCorners = size_t(1) << 18;
+            std::vector<Piece> pieces;
+            size_t cornerCount = 0;
+            for (const ObjFaceBlock& block : data.blocks) {
+                for (size_t begin = 0; begin < block.indices.size(); begin += kPieceCorners) {
+                    const size_t count = std::min(kPieceCorners, block.indices.size() - begin);
+                    pieces.push_back({ block.indices.data() + begin, cornerCount + begin, count });
+                }
+                cornerCount += block.indices.size();
+            }
+
+            // More shards than threads, so that an unlucky shard with many corners does not
+            // leave the others idle at the end.
+            const size_t positionCount = data.positions.size() / 3;
+            const size_t shardCount = std::max<size_t>(1, std::min<size_t>(workerCount() * 4, positionCount));
+            const size_t shardWidth = (positionCount + shardCount - 1) / shardCount;
+            // Malformed position indices never share, so any shard can take them; the first does.
+            auto shardOf = [&](int position) -> size_t {
+                return (position >= 0 && static_cast<size_t>(position) < positionCount)
+                    ? static_cast<size_t>(position) / shardWidth : 0;
+            };
+
+            // ── Bucket: every shard's corners, as offsets within their piece, in file order ──
+            std::vector<uint32_t> bucketCounts(pieces.size() * shardCount, 0);
+            parallelFor(pieces.size(), [&](size_t p) {
+                uint32_t* counts = &bucketCounts[p * shardCount];
+                for (size_t c = 0; c < pieces[p].count; ++c) ++counts[shardOf(pieces[p].corners[c].vertex_index)];
+            });
+            std::vector<size_t> bucketOffsets(pieces.size() * shardCount);
+            std::vector<size_t> shardStarts(shardCount + 1, 0);
+            size_t running = 0;
+            for (size_t s = 0; s < shardCount; ++s) {
+                shardStarts[s] = running;
+                for (size_t p = 0; p < pieces.size(); ++p) {
+                    bucketOffsets[p * shardCount + s] = running;
+                    running += bucketCounts[p * shardCount + s];
+                }
+            }
+            shardStarts[shardCount] = running;
+
+            std::vector<uint32_t> buckets(cornerCount);
+            parallelFor(pieces.size(), [&](size_t p) {
+                std::vector<size_t> cursor(bucketOffsets.begin() + static_cast<std::ptrdiff_t>(p * shardCount),
+                                           bucketOffsets.begin() + static_cast<std::ptrdiff_t>((p + 1) * shardCount));
+                for (size_t c = 0; c < pieces[p].count; ++c) {
+                    buckets[cursor[shardOf(pieces[p].corners[c].vertex_index)]++] = static_cast<uint32_t>(c);
+                }
+            });
+
+            // ── Deduplicate each shard; indices hold shard-local vertex numbers for now ──
+            mesh.indices.resize(cornerCount);
+            std::vector<uint8_t> createsVertex(cornerCount, 0);
+            std::vector<uint32_t> shardVertexCounts(shardCount, 0);
+            parallelFor(shardCount, [&](size_t s) {
+                const size_t first = s * shardWidth;
+                const size_t width = std::min(shardWidth, positionCount - std::min(first, positionCount));
+                VertexDeduplicator<ObjCornerAttributes> dedup(width);
+                uint32_t created = 0;
+
+                size_t bucket = shardStarts[s];
+                for (size_t p = 0; p < pieces.size(); ++p) {
+                    const Piece& piece = pieces[p];
+                    const size_t end = bucket + bucketCounts[p * shardCount + s];
+                    for (; bucket < end; ++bucket) {
+                        const size_t local = buckets[bucket];
+                        const tinyobj::index_t& source = piece.corners[local];
+                        const size_t corner = piece.first + local;
+                        const bool valid = source.vertex_index >= 0
+                            && static_cast<size_t>(source.vertex_index) < positionCount;
+                        mesh.indices[corner] = dedup.resolve(
+                            valid ? static_cast<int64_t>(static_cast<size_t>(source.vertex_index) - first) : -1,
+                            { source.normal_index, source.texcoord_index },
+                            [&]() -> uint32_t {
+                                createsVertex[corner] = 1;
+                                return created++;
+                            });
+                    }
+                }
+                shardVertexCounts[s] = created;
+            });
+            buckets = {};
+
+            // ── Number the vertices in the order the serial pass would have created them ──
+            std::vector<size_t> pieceVertexBases(pieces.size() + 1, 0);
+            parallelFor(pieces.size(), [&](size_t p) {
+                size_t count = 0;
+                for (size_t c = 0; c < pieces[p].count; ++c) count += createsVertex[pieces[p].first + c];
+                pieceVertexBases[p + 1] = count;
+            });
+            for (size_t p = 0; p < pieces.size(); ++p) pieceVertexBases[p + 1] += pieceVertexBases[p];
+
+            mesh.vertices.resize(pieceVertexBases.back());
+            std::vector<std::vector<uint32_t>> shardToMesh(shardCount);
+            for (size_t s = 0; s < shardCount; ++s) shardToMesh[s].resize(shardVertexCounts[s]);
+
+            parallelFor(pieces.size(), [&](size_t p) {
+                const Piece& piece = pieces[p];
+                size_t next = pieceVertexBases[p];
+                for (size_t c = 0; c < piece.count; ++c) {
+                    if (!createsVertex[piece.first + c]) continue;
+                    const tinyobj::index_t& source = piece.corners[c];
+                    mesh.vertices[next] = makeObjVertex(data, source);
+                    shardToMesh[shardOf(source.vertex_index)][mesh.indices[piece.first + c]] =
+                        static_cast<uint32_t>(next);
+                    ++next;
+                }
+            });
+            createsVertex = {};
+
+            parallelFor(pieces.size(), [&](size_t p) {
+                const Piece& piece = pieces[p];
+                for (size_t c = 0; c < piece.count; ++c) {
+                    uint32_t& index = mesh.indices[piece.first + c];
+                    index = shardToMesh[shardOf(piece.corners[c].vertex_index)][index];
+                }
+            });
+        }
 
-            mesh.hadNormals = !attrib.normals.empty();
-            mesh.hadTexCoords = !attrib.texcoords.empty();
+        /**
+         * @brief Turns parsed OBJ data, from either reader, into the renderer's mesh.
+         *
+         * Consumes @p data: each part is freed as soon as nothing further reads it, because the
+         * parsed form of a large scene is several times the size of the mesh made from it and
+         * the two overlap for the whole conversion. With @p streaming the serial deduplication
+         * is used even on many cores, so that every block's indices can go the moment they are
+         * emitted — the parallel pass needs all of them at once.
+         */
+        void buildObjMesh(ObjData& data, Mesh& mesh, bool streaming, ReadProgress& read)
+        {
+            mesh.hadNormals = !data.normals.empty();
+            mesh.hadTexCoords = !data.texCoords.empty();
 
-            for (const tinyobj::material_t& source : objMaterials) {
+            for (const tinyobj::material_t& source : data.materials) {
                 MeshMaterial material;
                 material.name = source.name;
 
@@ -298,76 +926,127 @@ namespace dmrender {
 
                 mesh.materials.push_back(std::move(material));
             }
-
-            const size_t positionCount = attrib.vertices.size() / 3;
-            VertexDeduplicator dedup(positionCount);
-            // Most positions yield one vertex; seams and hard edges add a few more.
-            dedup.reserve(positionCount + positionCount / 2);
-            mesh.vertices.reserve(positionCount + positionCount / 2);
-
+            data.materials = {};
+
+            // A `vn` is usually shared by several vertices, and packing them all up front lets
+            // packNormals() take them four or eight at a time.
+            constexpr size_t kPieceNormals = size_t(1) << 16;
+            const size_t normalCount = data.normals.size() / 3;
+            data.packedNormals.resize(normalCount);
+            parallelFor((normalCount + kPieceNormals - 1) / kPieceNormals, [&](size_t p) {
+                const size_t first = p * kPieceNormals;
+                packNormals(&data.normals[first * 3], &data.packedNormals[first],
+                            std::min(kPieceNormals, normalCount - first));
+            });
+            data.normals = {};
+
+            // Faces sharing a material become one subset. Sorting by material would produce
+            // fewer subsets; preserving file order keeps each subset spatially coherent, which
+            // matters more once they are culled individually. A `g` or `o` line ends a subset
+            // too: exporters put one there between objects.
             size_t totalIndices = 0;
-            for (const tinyobj::shape_t& shape : shapes) totalIndices += shape.mesh.indices.size();
-            mesh.indices.reserve(totalIndices);
-
-            for (const tinyobj::shape_t& shape : shapes) {
-                // Faces sharing a material become one subset. Sorting by material would produce
-                // fewer subsets; preserving file order keeps each subset spatially coherent,
-                // which matters more once they are culled individually.
-                int currentMaterial = -2;
-                MeshSubset subset;
+            int currentMaterial = -2;
+            MeshSubset subset;
+
+            for (ObjFaceBlock& block : data.blocks) {
+                if (block.startsGroup) currentMaterial = -2;
+                size_t nextGroup = 0;
 
-                const size_t faceCount = shape.mesh.indices.size() / 3;
+                const size_t faceCount = block.indices.size() / 3;
                 for (size_t face = 0; face < faceCount; ++face) {
-                    const int faceMaterial = face < shape.mesh.material_ids.size()
-                        ? shape.mesh.material_ids[face] : -1;
+                    if (nextGroup < block.groupStarts.size() && block.groupStarts[nextGroup] == face) {
+                        currentMaterial = -2;
+                        ++nextGroup;
+                    }
+                    const int faceMaterial = face < block.materialIds.size() ? block.materialIds[face] : -1;
 
                     if (faceMaterial != currentMaterial) {
                         if (subset.indexCount > 0) mesh.subsets.push_back(subset);
                         subset = MeshSubset{};
-                        subset.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+                        subset.firstIndex = static_cast<uint32_t>(totalIndices);
                         subset.materialIndex = faceMaterial;
                         currentMaterial = faceMaterial;
                     }
-
-                    for (int corner = 0; corner < 3; ++corner) {
-                        const tinyobj::index_t& source = shape.mesh.indices[face * 3 + corner];
-
-                        const uint32_t index = dedup.resolve(
-                            source.vertex_index, source.normal_index, source.texcoord_index,
+                    subset.indexCount += 3;
+                    totalIndices += 3;
+                }
+                block.materialIds = {};
+                block.groupStarts = {};
+            }
+            if (subset.indexCount > 0) mesh.subsets.push_back(subset);
+
+            LoadPhaseTimer dedupPhase(mesh.loadStats, "dedup");
+            read.stage("dedup", 0.7f, 0.9f, totalIndices);
+            if (!streaming && workerCount() > 1 && totalIndices >= kParallelDedupCorners) {
+                deduplicateObjParallel(data, mesh);
+            } else {
+                const size_t positionCount = data.positions.size() / 3;
+                VertexDeduplicator<ObjCornerAttributes> dedup(positionCount);
+                // Most positions yield one vertex; seams and hard edges add a few more.
+                dedup.reserve(positionCount + positionCount / 2);
+                mesh.vertices.reserve(positionCount + positionCount / 2);
+                mesh.indices.reserve(totalIndices);
+
+                for (ObjFaceBlock& block : data.blocks) {
+                    for (const tinyobj::index_t& source : block.indices) {
+                        mesh.indices.push_back(dedup.resolve(
+                            source.vertex_index, { source.normal_index, source.texcoord_index },
                             [&]() -> uint32_t {
-                                MeshVertex vertex{};
-                                if (source.vertex_index >= 0) {
-                                    const size_t base = static_cast<size_t>(source.vertex_index) * 3;
-                                    vertex.position[0] = attrib.vertices[base + 0];
-                                    vertex.position[1] = attrib.vertices[base + 1];
-                                    vertex.position[2] = attrib.vertices[base + 2];
-                                }
-                                if (source.normal_index >= 0) {
-                                    const size_t base = static_cast<size_t>(source.normal_index) * 3;
-                                    vertex.packedNormal = packNormal(attrib.normals[base + 0],
-                                                                     attrib.normals[base + 1],
-                                                                     attrib.normals[base + 2]);
-                                }
-                                if (source.texcoord_index >= 0) {
-                                    const size_t base = static_cast<size_t>(source.texcoord_index) * 2;
-                                    vertex.uv[0] = attrib.texcoords[base + 0];
-                                    // OBJ's V axis points up, texture space points down.
-                                    vertex.uv[1] = 1.0f - attrib.texcoords[base + 1];
-                                }
-                                mesh.vertices.push_back(vertex);
+                                mesh.vertices.push_back(makeObjVertex(data, source));
                                 return static_cast<uint32_t>(mesh.vertices.size() - 1);
-                            });
-
-                        mesh.indices.push_back(index);
-                        ++subset.indexCount;
+                            }));
                     }
+                    read.advance(block.indices.size());
+                    block.indices = {};
                 }
-                if (subset.indexCount > 0) mesh.subsets.push_back(subset);
             }
-
-            if (!mesh.hadNormals) generateSmoothNormals(mesh.vertices, mesh.indices);
+            // The attributes are referenced by nothing from here on. Normal generation below
+            // allocates its own accumulator, so let it have their memory.
+            data = ObjData{};
+            dedupPhase.finish();
+            mesh.loadStats.cornersRead += totalIndices;
+            mesh.loadStats.verticesAfterDedup += mesh.vertices.size();
+
+            if (!mesh.hadNormals) {
+                read.stage("normals", 0.9f, 1.0f, 1);
+                LoadPhaseTimer normalsPhase(mesh.loadStats, "normals");
+                generateSmoothNormals(mesh.vertices, mesh.indices);
+            }
 
             mesh.sourceFormat = "OBJ";
+        }
+
+        bool loadObj(const std::filesystem::path& path, Mesh& mesh, std::string& error,
+                     LoadProgress* progress)
+        {
+            ReadProgress read(progress);
+            // DMRENDER_OBJ_STREAM trades the parallel deduplication for the lowest peak memory.
+            const bool streaming = std::getenv("DMRENDER_OBJ_STREAM") != nullptr;
+            // DMRENDER_OBJ_READER=tinyobj forces the reference reader, for comparing wall time
+            // and peak memory against the native one on the same file.
+            const char* readerChoice = std::getenv("DMRENDER_OBJ_READER");
+            const bool forceTinyobj = readerChoice && std::strcmp(readerChoice, "tinyobj") == 0;
+
+            LoadPhaseTimer parsePhase(mesh.loadStats, "parse");
+            ObjData data;
+            bool parsed = false;
+            if (!forceTinyobj) {
+                std::string reason;
+                parsed = readObjNative(path, data, reason, read);
+                if (!parsed) {
+                    std::fprintf(stderr, "  obj: native reader declined (%s), using tinyobjloader\n",
+                                 reason.c_str());
+                    data = ObjData{};
+                }
+            }
+            const bool native = parsed;
+            if (!parsed && !readObjTinyobj(path, data, error)) return false;
+
+            std::fprintf(stderr, "  obj: parsed by %s in %.2f s\n",
+                         native ? "native reader" : "tinyobjloader", parsePhase.finish());
+            mesh.loadStats.bytesRead += fileBytes(path);
+
+            buildObjMesh(data, mesh, streaming, read);
             return true;
         }
 
@@ -375,58 +1054,230 @@ namespace dmrender {
         // STL
         // ─────────────────────────────────────────────────────────────────────
 
-        bool loadStl(const std::filesystem::path& path, Mesh& mesh, std::string& error)
-        {
-            microstl::MeshReaderHandler handler;
-            const microstl::Result result = microstl::Reader::readStlFile(path.string(), handler);
-            if (result != microstl::Result::Success) {
-                error = "failed to read STL: " + std::string(microstl::getResultString(result));
-                return false;
-            }
+        /**
+         * @class StlCornerHandler
+         * @brief Takes microstl's facets as they are parsed: three positions each, and nothing else.
+         *
+         * microstl::MeshReaderHandler keeps whole facets, normals and all, for a second walk
+         * afterwards. The facet normals are never used — smooth ones are generated once the
+         * corners are welded — so they are neither kept nor recomputed.
+         */
+        class StlCornerHandler : public microstl::Reader::Handler {
+        public:
+            explicit StlCornerHandler(ReadProgress& read) : m_read(read) {}
 
-            const microstl::Mesh& source = handler.mesh;
-            mesh.vertices.reserve(source.facets.size() * 3);
-            mesh.indices.reserve(source.facets.size() * 3);
+            std::vector<float> positions;   ///< Three corners of three floats per facet.
 
-            // STL repeats every vertex per facet. Welding by exact position bytes recovers the
-            // sharing, which is what makes the post-transform cache useful at all.
-            std::unordered_map<uint64_t, uint32_t> welded;
-            welded.reserve(source.facets.size() * 2);
+            /// Binary files only: an ASCII one says nothing up front, and its bar waits for the weld.
+            void onFacetCount(uint32_t triangles) override
+            {
+                positions.reserve(static_cast<size_t>(triangles) * 9);
+                m_read.stage("reading", 0.0f, 0.6f, triangles);
+            }
+            bool disableRecalculateNormals() override { return true; }
+            void onFacet(const float v1[3], const float v2[3], const float v3[3], const float[3]) override
+            {
+                positions.insert(positions.end(), v1, v1 + 3);
+                positions.insert(positions.end(), v2, v2 + 3);
+                positions.insert(positions.end(), v3, v3 + 3);
+                if (++m_facets % kFacetsPerStep == 0) m_read.advance(kFacetsPerStep);
+            }
 
-            auto positionKey = [](const microstl::Vertex& v) {
-                uint64_t hash = 1469598103934665603ull;
-                const float components[3] = { v.x, v.y, v.z };
-                for (float component : components) {
-                    uint32_t bits;
-                    std::memcpy(&bits, &component, sizeof(bits));
-                    hash ^= bits;
-                    hash *= 1099511628211ull;
+        private:
+            static constexpr uint32_t kFacetsPerStep = 1u << 16;
+            ReadProgress& m_read;
+            uint32_t m_facets = 0;
+        };
+
+        /**
+         * @brief Gives corners that share a position one vertex, numbered in order of first use.
+         *
+         * Every corner becomes a record of a 32-bit hash of its position key and its own index,
+         * and the records are radix-sorted on the hash: three stable passes of eleven bits, each
+         * split over the threads by pieces the way the OBJ deduplication buckets its corners.
+         * Corners of one position then sit together, in corner order. A run of equal hashes is
+         * split by the key itself, so a collision costs a comparison but never merges two
+         * positions; each position's first corner owns its vertex. Numbering the owners by a
+         * prefix sum in corner order gives the vertex order a serial walk would.
+         *
+         * The key is the position's bits, with -0 folded into 0; or, when @p weldDistance is
+         * positive, the cell of a grid of that spacing the position falls in. A grid merges
+         * everything in a cell — at most the diagonal apart — but not two corners a hair apart
+         * on either side of a cell wall, so it closes most cracks rather than all of them.
+         * The welded vertex is where its first corner was.
+         */
+        void weldStlCorners(const std::vector<float>& positions, float weldDistance, Mesh& mesh)
+        {
+            struct Record {
+                uint32_t hash;
+                uint32_t corner;
+            };
+            using Key = std::array<uint32_t, 3>;
+            const float cellScale = weldDistance > 0.0f ? 1.0f / weldDistance : 0.0f;
+            auto keyOf = [&](size_t corner) {
+                Key key;
+                for (int axis = 0; axis < 3; ++axis) {
+                    const float value = positions[corner * 3 + axis];
+                    if (cellScale > 0.0f) {
+                        const float cell = std::floor(value * cellScale);
+                        key[axis] = static_cast<uint32_t>(static_cast<int32_t>(
+                            std::max(-2147483648.0f, std::min(cell, 2147483520.0f))));
+                    } else {
+                        const float folded = value + 0.0f;   // -0 + 0 is +0
+                        std::memcpy(&key[axis], &folded, sizeof(float));
+                    }
                 }
-                return hash;
+                return key;
             };
 
-            for (const microstl::Facet& facet : source.facets) {
-                const microstl::Vertex* corners[3] = { &facet.v1, &facet.v2, &facet.v3 };
-                for (const microstl::Vertex* corner : corners) {
-                    const uint64_t hashKey = positionKey(*corner);
-                    auto it = welded.find(hashKey);
-                    if (it == welded.end()) {
-                        MeshVertex vertex{};
-                        vertex.position[0] = corner->x;
-                        vertex.position[1] = corner->y;
-                        vertex.position[2] = corner->z;
-                        mesh.vertices.push_back(vertex);
-                        it = welded.emplace(hashKey,
-                                            static_cast<uint32_t>(mesh.vertices.size() - 1)).first;
+            const size_t cornerCount = positions.size() / 3;
+            constexpr size_t kPieceCorners = size_t(1) << 16;
+            const size_t pieceCount = (cornerCount + kPieceCorners - 1) / kPieceCorners;
+            auto pieceEnd = [&](size_t p) { return std::min(cornerCount, (p + 1) * kPieceCorners); };
+
+            std::vector<Record> records(cornerCount);
+            parallelFor(pieceCount, [&](size_t p) {
+                for (size_t c = p * kPieceCorners; c < pieceEnd(p); ++c) {
+                    uint64_t hash = 1469598103934665603ull;
+                    for (uint32_t word : keyOf(c)) {
+                        hash ^= word;
+                        hash *= 1099511628211ull;
+                    }
+                    records[c] = { static_cast<uint32_t>(hash ^ (hash >> 32)), static_cast<uint32_t>(c) };
+                }
+            });
+
+            // ── Radix sort on the hash: stable, so corners stay in order within a hash ──
+            constexpr uint32_t kDigitBits = 11;
+            constexpr size_t kDigits = size_t(1) << kDigitBits;
+            std::vector<Record> sorted(cornerCount);
+            std::vector<uint32_t> digitCounts(pieceCount * kDigits);
+            std::vector<size_t> digitOffsets(pieceCount * kDigits);
+            for (uint32_t shift = 0; shift < 32; shift += kDigitBits) {
+                auto digitOf = [shift](const Record& record) { return (record.hash >> shift) & (kDigits - 1); };
+                parallelFor(pieceCount, [&](size_t p) {
+                    uint32_t* counts = &digitCounts[p * kDigits];
+                    std::fill(counts, counts + kDigits, 0u);
+                    for (size_t i = p * kPieceCorners; i < pieceEnd(p); ++i) ++counts[digitOf(records[i])];
+                });
+                size_t running = 0;
+                for (size_t d = 0; d < kDigits; ++d) {
+                    for (size_t p = 0; p < pieceCount; ++p) {
+                        digitOffsets[p * kDigits + d] = running;
+                        running += digitCounts[p * kDigits + d];
                     }
-                    mesh.indices.push_back(it->second);
                 }
+                parallelFor(pieceCount, [&](size_t p) {
+                    size_t* cursor = &digitOffsets[p * kDigits];
+                    for (size_t i = p * kPieceCorners; i < pieceEnd(p); ++i) sorted[cursor[digitOf(records[i])]++] = records[i];
+                });
+                records.swap(sorted);
+            }
+            sorted = {};
+            digitOffsets = {};
+            digitCounts = {};
+
+            // ── Every corner points at the first corner of its position ──
+            //
+            // A piece takes the runs of equal hashes that begin inside it, finishing the last
+            // one past its end, so no run is split between two threads.
+            std::vector<uint32_t> owner(cornerCount);
+            parallelFor(pieceCount, [&](size_t p) {
+                size_t run = p * kPieceCorners;
+                while (run > 0 && run < cornerCount && records[run].hash == records[run - 1].hash) ++run;
+                std::vector<uint32_t> pending;
+                while (run < pieceEnd(p)) {
+                    size_t runEnd = run + 1;
+                    while (runEnd < cornerCount && records[runEnd].hash == records[run].hash) ++runEnd;
+                    if (runEnd - run == 1) {
+                        owner[records[run].corner] = records[run].corner;
+                    } else {
+                        // Nearly always one position; on a collision, one sweep per position.
+                        pending.clear();
+                        for (size_t i = run; i < runEnd; ++i) pending.push_back(records[i].corner);
+                        while (!pending.empty()) {
+                            const uint32_t first = pending.front();
+                            const Key key = keyOf(first);
+                            size_t kept = 0;
+                            for (const uint32_t corner : pending) {
+                                if (keyOf(corner) == key) owner[corner] = first;
+                                else pending[kept++] = corner;
+                            }
+                            pending.resize(kept);
+                        }
+                    }
+                    run = runEnd;
+                }
+            });
+            records = {};
+
+            // ── Number the owners in corner order, then point every corner at its owner's vertex ──
+            std::vector<size_t> pieceVertexBases(pieceCount + 1, 0);
+            parallelFor(pieceCount, [&](size_t p) {
+                size_t count = 0;
+                for (size_t c = p * kPieceCorners; c < pieceEnd(p); ++c) count += owner[c] == c;
+                pieceVertexBases[p + 1] = count;
+            });
+            for (size_t p = 0; p < pieceCount; ++p) pieceVertexBases[p + 1] += pieceVertexBases[p];
+
+            mesh.vertices.resize(pieceVertexBases.back());
+            mesh.indices.resize(cornerCount);
+            parallelFor(pieceCount, [&](size_t p) {
+                size_t next = pieceVertexBases[p];
+                for (size_t c = p * kPieceCorners; c < pieceEnd(p); ++c) {
+                    if (owner[c] != c) continue;
+                    MeshVertex& vertex = mesh.vertices[next];
+                    vertex = MeshVertex{};
+                    std::memcpy(vertex.position, &positions[c * 3], sizeof(vertex.position));
+                    mesh.indices[c] = static_cast<uint32_t>(next++);
+                }
+            });
+            // An owner is never after its corners, and every owner's index is written by now.
+            parallelFor(pieceCount, [&](size_t p) {
+                for (size_t c = p * kPieceCorners; c < pieceEnd(p); ++c) {
+                    if (owner[c] != c) mesh.indices[c] = mesh.indices[owner[c]];
+                }
+            });
+        }
+
+        bool loadStl(const std::filesystem::path& path, Mesh& mesh, std::string& error,
+                     LoadProgress* progress)
+        {
+            ReadProgress read(progress);
+            LoadPhaseTimer parsePhase(mesh.loadStats, "parse");
+            StlCornerHandler handler(read);
+            const microstl::Result result = microstl::Reader::readStlFile(path.string(), handler);
+            if (result != microstl::Result::Success) {
+                error = "failed to read STL: " + std::string(microstl::getResultString(result));
+                return false;
             }
+            parsePhase.finish();
+            mesh.loadStats.bytesRead += fileBytes(path);
+            if (handler.positions.size() / 3 > std::numeric_limits<uint32_t>::max()) {
+                error = "STL has more corners than 32-bit indices address";
+                return false;
+            }
+
+            // STL repeats every vertex per facet. Welding recovers the sharing, which is what
+            // makes the post-transform cache useful at all.
+            read.stage("weld", 0.6f, 0.9f, 1);
+            LoadPhaseTimer weldPhase(mesh.loadStats, "weld");
+            const float weldDistance = stlWeldDistance();
+            if (weldDistance > 0.0f) std::fprintf(stderr, "  stl: welding corners within %g\n", weldDistance);
+            weldStlCorners(handler.positions, weldDistance, mesh);
+            handler.positions = {};
+            weldPhase.finish();
+            mesh.loadStats.cornersRead += mesh.indices.size();
+            mesh.loadStats.verticesAfterDedup += mesh.vertices.size();
 
             // STL stores a normal per facet, not per vertex. Smoothing across the welded mesh
             // gives a better result than replicating the facet normal, and matches what every
             // other viewer does with these files.
-            generateSmoothNormals(mesh.vertices, mesh.indices);
+            {
+                read.stage("normals", 0.9f, 1.0f, 1);
+                LoadPhaseTimer normalsPhase(mesh.loadStats, "normals");
+                generateSmoothNormals(mesh.vertices, mesh.indices);
+            }
 
             MeshSubset subset;
             subset.firstIndex = 0;
@@ -441,14 +1292,461 @@ namespace dmrender {
         // PLY
         // ─────────────────────────────────────────────────────────────────────
 
-        bool loadPly(const std::filesystem::path& path, Mesh& mesh, std::string& error)
+        // A binary PLY is a text header followed by fixed-layout records, and happly reads it as
+        // generally as the format allows: positions as doubles, every face as its own vector.
+        // For a scan of a few hundred million triangles that is gigabytes of short-lived
+        // allocations before the first vertex is built. The reader below maps the file and
+        // decodes records straight into MeshVertex and the index buffer, in parallel pieces. It
+        // handles binary files of either byte order whose vertices are plain records; anything
+        // else — ASCII, lists among the vertex properties — goes to happly as before.
+
+        /// A PLY scalar type: its size, and how to read it.
+        enum class PlyType : uint8_t { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+        PlyType plyTypeOf(const std::string& name)
         {
+            if (name == "char"   || name == "int8")    return PlyType::Int8;
+            if (name == "uchar"  || name == "uint8")   return PlyType::UInt8;
+            if (name == "short"  || name == "int16")   return PlyType::Int16;
+            if (name == "ushort" || name == "uint16")  return PlyType::UInt16;
+            if (name == "int"    || name == "int32")   return PlyType::Int32;
+            if (name == "uint"   || name == "uint32")  return PlyType::UInt32;
+            if (name == "float"  || name == "float32") return PlyType::Float32;
+            if (name == "double" || name == "float64") return PlyType::Float64;
+            return PlyType::Invalid;
+        }
+
+        size_t plyTypeSize(PlyType type)
+        {
+            switch (type) {
+                case PlyType::Int8:  case PlyType::UInt8:  return 1;
+                case PlyType::Int16: case PlyType::UInt16: return 2;
+                case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+                case PlyType::Float64: return 8;
+                default: return 0;
+            }
+        }
+
+        /// @brief One value of @p type at @p at, swapped from big-endian first when @p swap.
+        template <typename T>
+        T readPlyValue(const uint8_t* at, PlyType type, bool swap)
+        {
+            uint8_t bytes[8];
+            const size_t size = plyTypeSize(type);
+            if (swap) {
+                for (size_t i = 0; i < size; ++i) bytes[i] = at[size - 1 - i];
+            } else {
+                std::memcpy(bytes, at, size);
+            }
+            switch (type) {
+                case PlyType::Int8:    { int8_t v;   std::memcpy(&v, bytes, 1); return static_cast<T>(v); }
+                case PlyType::UInt8:   { uint8_t v;  std::memcpy(&v, bytes, 1); return static_cast<T>(v); }
+                case PlyType::Int16:   { int16_t v;  std::memcpy(&v, bytes, 2); return static_cast<T>(v); }
+                case PlyType::UInt16:  { uint16_t v; std::memcpy(&v, bytes, 2); return static_cast<T>(v); }
+                case PlyType::Int32:   { int32_t v;  std::memcpy(&v, bytes, 4); return static_cast<T>(v); }
+                case PlyType::UInt32:  { uint32_t v; std::memcpy(&v, bytes, 4); return static_cast<T>(v); }
+                case PlyType::Float32: { float v;    std::memcpy(&v, bytes, 4); return static_cast<T>(v); }
+                case PlyType::Float64: { double v;   std::memcpy(&v, bytes, 8); return static_cast<T>(v); }
+                default: return T{};
+            }
+        }
+
+        struct PlyProperty {
+            std::string name;
+            PlyType type = PlyType::Invalid;        ///< Of the value, or of a list's items.
+            PlyType countType = PlyType::Invalid;   ///< Set only for a list.
+            size_t offset = 0;                      ///< In the record, while every earlier property is scalar.
+        };
+
+        struct PlyElement {
+            std::string name;
+            size_t count = 0;
+            std::vector<PlyProperty> properties;
+            size_t recordSize = 0;                  ///< For an element with no lists.
+            bool hasLists = false;
+
+            const PlyProperty* find(std::initializer_list<const char*> names) const {
+                for (const char* wanted : names) {
+                    for (const PlyProperty& property : properties) {
+                        if (property.name == wanted) return &property;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        /**
+         * @brief Reads the header of a binary PLY.
+         * @param[out] body Offset of the first record.
+         * @param[out] swap Whether the records are big-endian.
+         */
+        bool readPlyHeader(const uint8_t* data, size_t size, std::vector<PlyElement>& elements,
+                           size_t& body, bool& swap, std::string& reason)
+        {
+            const char* text = reinterpret_cast<const char*>(data);
+            // A header is a few hundred bytes; anything that runs this long without ending is not one.
+            const size_t limit = std::min<size_t>(size, 1 << 16);
+            size_t position = 0;
+            bool sawFormat = false;
+
+            while (position < limit) {
+                const void* newline = std::memchr(text + position, '\n', limit - position);
+                if (!newline) break;
+                const size_t end = static_cast<size_t>(static_cast<const char*>(newline) - text);
+                std::string line(text + position, end - position);
+                position = end + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+
+                std::istringstream words(line);
+                std::string keyword;
+                words >> keyword;
+                if (keyword == "ply" || keyword == "comment" || keyword == "obj_info" || keyword.empty()) continue;
+
+                if (keyword == "format") {
+                    std::string format;
+                    words >> format;
+                    if (format == "binary_little_endian") swap = false;
+                    else if (format == "binary_big_endian") swap = true;
+                    else { reason = "format " + format; return false; }
+                    sawFormat = true;
+                    // PLY is defined in little- or big-endian terms; a big-endian host would
+                    // have them the other way round.
+                    const uint16_t probe = 1;
+                    uint8_t firstByte;
+                    std::memcpy(&firstByte, &probe, 1);
+                    if (firstByte == 0) swap = !swap;
+                } else if (keyword == "element") {
+                    PlyElement element;
+                    words >> element.name >> element.count;
+                    if (!words) { reason = "malformed element line"; return false; }
+                    elements.push_back(std::move(element));
+                } else if (keyword == "property") {
+                    if (elements.empty()) { reason = "property before any element"; return false; }
+                    PlyElement& element = elements.back();
+                    PlyProperty property;
+                    std::string type;
+                    words >> type;
+                    if (type == "list") {
+                        std::string countType, itemType;
+                        words >> countType >> itemType;
+                        property.countType = plyTypeOf(countType);
+                        property.type = plyTypeOf(itemType);
+                        if (property.countType == PlyType::Invalid) { reason = "list count type " + countType; return false; }
+                        element.hasLists = true;
+                    } else {
+                        property.type = plyTypeOf(type);
+                        property.offset = element.recordSize;
+                        element.recordSize += plyTypeSize(property.type);
+                    }
+                    if (property.type == PlyType::Invalid) { reason = "property type " + type; return false; }
+                    words >> property.name;
+                    element.properties.push_back(std::move(property));
+                } else if (keyword == "end_header") {
+                    if (!sawFormat) { reason = "no format line"; return false; }
+                    body = position;
+                    return true;
+                } else {
+                    reason = "header keyword " + keyword;
+                    return false;
+                }
+            }
+            reason = "no end_header";
+            return false;
+        }
+
+        /**
+         * @brief Reads a binary PLY out of a file mapping, straight into @p mesh.
+         * @param[out] reason Why the file was not read, when false is returned; happly may still.
+         * @param[out] error Set instead when the file is binary but broken, which no reader fixes.
+         * @param read Advanced by the bytes of every piece of records decoded.
+         */
+        bool readPlyNative(const std::filesystem::path& path, Mesh& mesh,
+                           std::string& reason, std::string& error, ReadProgress& read)
+        {
+            MappedFile file;
+            if (!file.open(path, reason)) return false;
+            const uint8_t* data = file.data();
+            const size_t size = file.size();
+
+            std::vector<PlyElement> elements;
+            size_t cursor = 0;
+            bool swap = false;
+            if (!readPlyHeader(data, size, elements, cursor, swap, reason)) return false;
+
+            // Records are laid out element after element, so everything before the faces must
+            // have a size known without reading it, and the faces must come after the vertices.
+            const PlyElement* vertexElement = nullptr;
+            const PlyElement* faceElement = nullptr;
+            size_t vertexStart = 0, faceStart = 0;
+            for (const PlyElement& element : elements) {
+                if (element.name == "vertex") {
+                    if (element.hasLists) { reason = "lists among the vertex properties"; return false; }
+                    vertexElement = &element;
+                    vertexStart = cursor;
+                } else if (element.name == "face") {
+                    if (!vertexElement) { reason = "faces before vertices"; return false; }
+                    faceElement = &element;
+                    faceStart = cursor;
+                    break;   // whatever follows the faces is never read
+                } else if (element.hasLists) {
+                    reason = "element " + element.name + " with lists before the faces";
+                    return false;
+                }
+                if (element.recordSize != 0 && element.count > (size - cursor) / element.recordSize) {
+                    error = "PLY is truncated in element " + element.name;
+                    return false;
+                }
+                cursor += element.count * element.recordSize;
+            }
+            if (!vertexElement || !faceElement) { reason = "no vertex or no face element"; return false; }
+
+            const PlyProperty* x = vertexElement->find({ "x" });
+            const PlyProperty* y = vertexElement->find({ "y" });
+            const PlyProperty* z = vertexElement->find({ "z" });
+            if (!x || !y || !z) { reason = "vertices without x, y and z"; return false; }
+            const PlyProperty* nx = vertexElement->find({ "nx" });
+            const PlyProperty* ny = vertexElement->find({ "ny" });
+            const PlyProperty* nz = vertexElement->find({ "nz" });
+            const PlyProperty* u = vertexElement->find({ "u", "s", "texture_u", "texture_s" });
+            const PlyProperty* v = vertexElement->find({ "v", "t", "texture_v", "texture_t" });
+            const bool hasNormals = nx && ny && nz;
+            const bool hasTexCoords = u && v;
+
+            // The indices are the one list read; any other face property is skipped over.
+            const PlyProperty* indexList = nullptr;
+            for (const PlyProperty& property : faceElement->properties) {
+                if (property.countType == PlyType::Invalid) continue;
+                if (property.name == "vertex_indices" || property.name == "vertex_index") indexList = &property;
+                else { reason = "face list " + property.name; return false; }
+            }
+            if (!indexList) { reason = "faces without vertex_indices"; return false; }
+            if (indexList->countType == PlyType::Float32 || indexList->countType == PlyType::Float64) {
+                reason = "face list counted in floating point";
+                return false;
+            }
+            if (vertexElement->count > std::numeric_limits<uint32_t>::max()) {
+                error = "PLY has more vertices than 32-bit indices address";
+                return false;
+            }
+
+            // ── Vertices: fixed records, decoded in parallel pieces ──
+            constexpr size_t kPieceRecords = size_t(1) << 16;
+            const size_t vertexCount = vertexElement->count;
+            const size_t vertexStride = vertexElement->recordSize;
+            mesh.vertices.resize(vertexCount);
+            read.stage("reading", 0.0f, 0.9f, size - vertexStart);
+            parallelFor((vertexCount + kPieceRecords - 1) / kPieceRecords, [&](size_t p) {
+                const size_t first = p * kPieceRecords;
+                const size_t count = std::min(kPieceRecords, vertexCount - first);
+                read.advance(count * vertexStride);
+                std::vector<float> normals(hasNormals ? count * 3 : 0);
+                for (size_t i = 0; i < count; ++i) {
+                    const uint8_t* record = data + vertexStart + (first + i) * vertexStride;
+                    MeshVertex& vertex = mesh.vertices[first + i];
+                    vertex.position[0] = readPlyValue<float>(record + x->offset, x->type, swap);
+                    vertex.position[1] = readPlyValue<float>(record + y->offset, y->type, swap);
+                    vertex.position[2] = readPlyValue<float>(record + z->offset, z->type, swap);
+                    if (hasTexCoords) {
+                        vertex.uv[0] = readPlyValue<float>(record + u->offset, u->type, swap);
+                        // Texture space points down, as for OBJ and FBX.
+                        vertex.uv[1] = 1.0f - readPlyValue<float>(record + v->offset, v->type, swap);
+                    }
+                    if (hasNormals) {
+                        float* n = &normals[i * 3];
+                        n[0] = readPlyValue<float>(record + nx->offset, nx->type, swap);
+                        n[1] = readPlyValue<float>(record + ny->offset, ny->type, swap);
+                        n[2] = readPlyValue<float>(record + nz->offset, nz->type, swap);
+                        // A zero normal would light the surface black; any unit vector is better.
+                        if (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] <= 1e-24f) { n[0] = 0.0f; n[1] = 1.0f; n[2] = 0.0f; }
+                    }
+                }
+                if (hasNormals) {
+                    std::vector<uint32_t> packed(count);
+                    packNormals(normals.data(), packed.data(), count);
+                    for (size_t i = 0; i < count; ++i) mesh.vertices[first + i].packedNormal = packed[i];
+                }
+            });
+            file.release(data + vertexStart, vertexCount * vertexStride);
+
+            // ── Faces: where each piece starts, then the pieces in parallel ──
+            //
+            // A face is its scalar properties before the list, the list, and the ones after it.
+            // Where the pieces start is known only by walking the counts, unless every face has
+            // the count the first one has — a triangle or quad mesh, which is nearly every scan —
+            // and then it is arithmetic, checked in parallel rather than assumed.
+            size_t before = 0, after = 0;
+            {
+                bool seenList = false;
+                for (const PlyProperty& property : faceElement->properties) {
+                    if (&property == indexList) { seenList = true; continue; }
+                    (seenList ? after : before) += plyTypeSize(property.type);
+                }
+            }
+            const size_t countSize = plyTypeSize(indexList->countType);
+            const size_t indexSize = plyTypeSize(indexList->type);
+            const size_t faceCount = faceElement->count;
+            const size_t pieceCount = (faceCount + kPieceRecords - 1) / kPieceRecords;
+            std::vector<size_t> pieceOffsets(pieceCount + 1, faceStart);
+            std::vector<size_t> pieceTriangles(pieceCount + 1, 0);
+
+            // Counts are read signed, so that a negative one in a `list char int` is seen as such
+            // rather than as a huge size. Either way it is rejected before it sizes anything: a
+            // count is used only once it is at least zero and its items fit in the file.
+            auto countAt = [&](size_t offset) -> int64_t {
+                return readPlyValue<int64_t>(data + offset + before, indexList->countType, swap);
+            };
+            auto countFits = [&](size_t offset, int64_t corners) {
+                const size_t itemsStart = offset + before + countSize;
+                return corners >= 0 && itemsStart <= size
+                    && static_cast<uint64_t>(corners) <= (size - itemsStart) / indexSize;
+            };
+
+            size_t fixedCorners = 0;
+            if (faceCount > 0 && faceStart + before + countSize <= size) {
+                const int64_t corners = countAt(faceStart);
+                fixedCorners = countFits(faceStart, corners) ? static_cast<size_t>(corners) : 0;
+                const size_t faceSize = before + countSize + fixedCorners * indexSize + after;
+                if (fixedCorners < 3 || faceCount > (size - faceStart) / faceSize) {
+                    fixedCorners = 0;
+                } else {
+                    std::atomic<bool> uniform{ true };
+                    parallelFor(pieceCount, [&](size_t p) {
+                        const size_t end = std::min(faceCount, (p + 1) * kPieceRecords);
+                        for (size_t face = p * kPieceRecords; face < end; ++face) {
+                            if (countAt(faceStart + face * faceSize) != static_cast<int64_t>(fixedCorners)) {
+                                uniform = false;
+                                return;
+                            }
+                        }
+                    });
+                    if (!uniform) {
+                        fixedCorners = 0;
+                    } else {
+                        for (size_t p = 0; p <= pieceCount; ++p) {
+                            const size_t face = std::min(faceCount, p * kPieceRecords);
+                            pieceOffsets[p] = faceStart + face * faceSize;
+                            pieceTriangles[p] = face * (fixedCorners - 2);
+                        }
+                    }
+                }
+            }
+            if (fixedCorners == 0) {
+                size_t offset = faceStart, triangles = 0;
+                for (size_t face = 0; face < faceCount; ++face) {
+                    if (face % kPieceRecords == 0) {
+                        pieceOffsets[face / kPieceRecords] = offset;
+                        pieceTriangles[face / kPieceRecords] = triangles;
+                    }
+                    if (offset + before + countSize > size) { error = "PLY is truncated in its faces"; return false; }
+                    const int64_t count = countAt(offset);
+                    if (count < 0) { error = "PLY face has a negative vertex count"; return false; }
+                    if (!countFits(offset, count)) { error = "PLY is truncated in its faces"; return false; }
+                    const size_t corners = static_cast<size_t>(count);
+                    offset += before + countSize + corners * indexSize + after;
+                    if (corners >= 3) triangles += corners - 2;
+                }
+                if (offset > size) { error = "PLY is truncated in its faces"; return false; }
+                pieceOffsets[pieceCount] = offset;
+                pieceTriangles[pieceCount] = triangles;
+            }
+            if (pieceTriangles[pieceCount] * 3 > std::numeric_limits<uint32_t>::max()) {
+                error = "PLY has more triangles than one index buffer holds";
+                return false;
+            }
+
+            // Fanned, as happly's faces were: correct for the convex polygons scanners write.
+            mesh.indices.resize(pieceTriangles[pieceCount] * 3);
+            std::atomic<bool> outOfRange{ false };
+            const bool plainTriangles = fixedCorners == 3 && !swap && before == 0 && after == 0
+                                     && (indexList->type == PlyType::Int32 || indexList->type == PlyType::UInt32);
+            parallelFor(pieceCount, [&](size_t p) {
+                const size_t faceEnd = std::min(faceCount, (p + 1) * kPieceRecords);
+                const uint8_t* record = data + pieceOffsets[p];
+                read.advance(pieceOffsets[p + 1] - pieceOffsets[p]);
+                uint32_t* out = mesh.indices.data() + pieceTriangles[p] * 3;
+                uint32_t invalid = 0;
+
+                if (plainTriangles) {
+                    // The common case, `list uchar int` of three in native order: twelve bytes
+                    // of indices per thirteen-byte record, copied as they are.
+                    const size_t stride = countSize + 12;
+                    for (size_t face = p * kPieceRecords; face < faceEnd; ++face, record += stride, out += 3) {
+                        std::memcpy(out, record + countSize, 12);
+                        invalid |= static_cast<uint32_t>(out[0] >= vertexCount)
+                                 | static_cast<uint32_t>(out[1] >= vertexCount)
+                                 | static_cast<uint32_t>(out[2] >= vertexCount);
+                    }
+                } else {
+                    for (size_t face = p * kPieceRecords; face < faceEnd; ++face) {
+                        // Checked by one of the walks above, which read the same bytes.
+                        const size_t corners = static_cast<size_t>(countAt(static_cast<size_t>(record - data)));
+                        const uint8_t* items = record + before + countSize;
+                        auto index = [&](size_t corner) {
+                            const int64_t value = readPlyValue<int64_t>(items + corner * indexSize, indexList->type, swap);
+                            invalid |= static_cast<uint32_t>(value < 0 || static_cast<uint64_t>(value) >= vertexCount);
+                            return static_cast<uint32_t>(value);
+                        };
+                        for (size_t corner = 2; corner < corners; ++corner) {
+                            *out++ = index(0);
+                            *out++ = index(corner - 1);
+                            *out++ = index(corner);
+                        }
+                        record = items + corners * indexSize + after;
+                    }
+                }
+                if (invalid) outOfRange = true;
+            });
+            if (outOfRange) {
+                error = "PLY face refers to a vertex that does not exist";
+                return false;
+            }
+
+            mesh.hadNormals = hasNormals;
+            mesh.hadTexCoords = hasTexCoords;
+            mesh.loadStats.bytesRead += size;
+            return true;
+        }
+
+        bool loadPly(const std::filesystem::path& path, Mesh& mesh, std::string& error,
+                     LoadProgress* progress)
+        {
+            ReadProgress read(progress);
+            // DMRENDER_PLY_READER=happly forces the reference reader, as DMRENDER_OBJ_READER does for OBJ.
+            const char* readerChoice = std::getenv("DMRENDER_PLY_READER");
+            if (!readerChoice || std::strcmp(readerChoice, "happly") != 0) {
+                LoadPhaseTimer parsePhase(mesh.loadStats, "parse");
+                std::string reason;
+                if (readPlyNative(path, mesh, reason, error, read)) {
+                    parsePhase.finish();
+                    if (!mesh.hadNormals) {
+                        read.stage("normals", 0.9f, 1.0f, 1);
+                        LoadPhaseTimer normalsPhase(mesh.loadStats, "normals");
+                        generateSmoothNormals(mesh.vertices, mesh.indices);
+                    }
+                    MeshSubset subset;
+                    subset.firstIndex = 0;
+                    subset.indexCount = static_cast<uint32_t>(mesh.indices.size());
+                    mesh.subsets.push_back(subset);
+                    mesh.sourceFormat = "PLY";
+                    return true;
+                }
+                if (!error.empty()) return false;
+                std::fprintf(stderr, "  ply: native reader declined (%s), using happly\n", reason.c_str());
+                mesh.vertices.clear();
+                mesh.indices.clear();
+            }
+
             try {
+                LoadPhaseTimer parsePhase(mesh.loadStats, "parse");
                 happly::PLYData ply(path.string());
 
                 const std::vector<std::array<double, 3>> positions = ply.getVertexPositions();
                 const std::vector<std::vector<size_t>> faces = ply.getFaceIndices<size_t>();
+                parsePhase.finish();
+                mesh.loadStats.bytesRead += fileBytes(path);
 
+                read.stage("convert", 0.6f, 0.9f, 1);
+                LoadPhaseTimer convertPhase(mesh.loadStats, "convert");
                 mesh.vertices.reserve(positions.size());
                 for (const std::array<double, 3>& position : positions) {
                     MeshVertex vertex{};
@@ -468,7 +1766,13 @@ namespace dmrender {
                     }
                 }
 
-                generateSmoothNormals(mesh.vertices, mesh.indices);
+                convertPhase.finish();
+
+                {
+                    read.stage("normals", 0.9f, 1.0f, 1);
+                    LoadPhaseTimer normalsPhase(mesh.loadStats, "normals");
+                    generateSmoothNormals(mesh.vertices, mesh.indices);
+                }
 
                 MeshSubset subset;
                 subset.firstIndex = 0;
@@ -500,8 +1804,32 @@ namespace dmrender {
                           boundsMax[2] - boundsMin[2] });
     }
 
-    Mesh loadMesh(const std::filesystem::path& path, std::string& error)
+    size_t Mesh::triangleCount() const
     {
+        size_t triangles = 0;
+        for (const MeshSubset& subset : subsets) {
+            triangles += static_cast<size_t>(subset.indexCount / 3) * std::max<uint32_t>(subset.instanceCount, 1);
+        }
+        return triangles;
+    }
+
+    float stlWeldDistance()
+    {
+        const char* text = std::getenv("DMRENDER_STL_WELD");
+        if (!text) return 0.0f;
+        const float value = std::strtof(text, nullptr);
+        return value > 0.0f && std::isfinite(value) ? value : 0.0f;
+    }
+
+    Mesh loadMesh(const std::filesystem::path& path, std::string& error, LoadProgress* progress)
+    {
+        const auto loadStart = std::chrono::steady_clock::now();
+        auto report = [progress](float fraction, const char* phase) {
+            if (!progress) return;
+            progress->phase = phase;
+            progress->fraction = fraction;
+        };
+        report(0.0f, "reading");
         Mesh mesh;
 
         if (!std::filesystem::exists(path)) {
@@ -515,11 +1843,11 @@ namespace dmrender {
                        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
 
         bool ok = false;
-        if (extension == ".obj")      ok = loadObj(path, mesh, error);
-        else if (extension == ".stl") ok = loadStl(path, mesh, error);
-        else if (extension == ".ply") ok = loadPly(path, mesh, error);
-        else if (extension == ".fbx") ok = loadFbx(path, mesh, error);
-        else if (extension == ".dmscene") ok = loadScene(path, mesh, error);
+        if (extension == ".obj")      ok = loadObj(path, mesh, error, progress);
+        else if (extension == ".stl") ok = loadStl(path, mesh, error, progress);
+        else if (extension == ".ply") ok = loadPly(path, mesh, error, progress);
+        else if (extension == ".fbx") ok = loadFbx(path, mesh, error, progress);
+        else if (extension == ".dmscene") ok = loadScene(path, mesh, error, progress);
         else {
             error = "unsupported extension: " + extension
                   + " (expected .obj, .stl, .ply, .fbx or .dmscene)";
@@ -534,7 +1862,38 @@ namespace dmrender {
             return mesh;
         }
 
-        computeBounds(mesh);
+        // Each pass is its own phase: they are where a new scene most often turns out slow.
+        LoadStats& stats = mesh.loadStats;
+        const uint32_t passes = enabledLoadPasses();
+        int passTotal = 1;   // computeBounds() always runs
+        for (uint32_t bits = passes; bits != 0; bits &= bits - 1) ++passTotal;
+        int passesDone = 0;
+        if (progress && progress->preview && passes != 0) {
+            LoadPhaseTimer phase(stats, "preview");
+            Mesh preview = mesh;
+            computeBounds(preview);
+            progress->preview(std::move(preview));
+        }
+        auto run = [&](uint32_t pass, const char* name, void (*stage)(Mesh&)) {
+            if (pass != 0 && !(passes & pass)) return;
+            report(0.5f + 0.5f * static_cast<float>(passesDone++) / static_cast<float>(passTotal), name);
+            LoadPhaseTimer phase(stats, name);
+            stage(mesh);
+        };
+        run(LoadPassInstances, "instances", findInstances);
+        run(LoadPassSplitSubsets, "split", splitLargeSubsets);
+        run(0, "bounds", computeBounds);
+        run(LoadPassMergeSubsets, "merge", mergeSmallSubsets);
+        run(LoadPassVertexOrder, "reorder", optimizeVertexOrder);
+        run(LoadPassClusters, "clusters", buildClusters);
+        run(LoadPassLods, "lods", buildLods);
+        run(LoadPassCompactVertices, "compact", buildCompactVertices);
+        run(LoadPassIndex16, "index16", narrowIndices);
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        stats.residentBytes = currentResidentBytes();
+        stats.peakResidentBytes = peakResidentBytes();
+        report(1.0f, "done");
         return mesh;
     }
 
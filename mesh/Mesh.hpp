@@ -6,8 +6,10 @@
 #define RENDERING_MESH_HPP
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -46,12 +48,74 @@ namespace dmrender {
     };
     static_assert(sizeof(MeshVertex) == 24, "MeshVertex must match the shader's array stride");
 
+    /// Consecutive vertices sharing one VertexBlock. A power of two, so the shader finds the
+    /// block with a shift.
+    constexpr uint32_t kVertexBlockShift = 8;
+    constexpr uint32_t kVertexBlockSize = 1u << kVertexBlockShift;
+
+    /**
+     * @struct CompactVertex
+     * @brief MeshVertex in 16 bytes, for scenes whose geometry allows it.
+     *
+     * Positions and texture coordinates are 16-bit integers on a grid set by the vertex's
+     * VertexBlock. Blocks are runs of consecutive vertices, not subsets: subsets share vertices,
+     * and merged indirect commands draw several subsets at once, so the only thing a vertex
+     * shader can reliably find its frame by is its own vertex id. After the vertex-order pass,
+     * consecutive vertices are neighbours on the surface, so a block spans little space.
+     */
+    struct CompactVertex {
+        uint16_t position[3];   ///< Grid steps from the block's origin.
+        uint16_t unused = 0;
+        uint32_t packedNormal;  ///< As in MeshVertex.
+        uint16_t uv[2];         ///< Grid steps from the block's UV origin.
+    };
+    static_assert(sizeof(CompactVertex) == 16, "CompactVertex must match the shader's array stride");
+
+    /**
+     * @struct VertexBlock
+     * @brief The grid kVertexBlockSize consecutive CompactVertex values are measured on.
+     *
+     * Steps are powers of two and origins are whole multiples of them, so a coarser block's grid
+     * is part of every finer one's. buildCompactVertices() puts a position that several blocks
+     * hold on the coarsest of their grids, and it then decodes to the same float in each,
+     * exactly: neighbouring subsets and texture charts meet without cracks.
+     */
+    struct VertexBlock {
+        float positionOrigin[3];
+        float positionStep;
+        float uvOrigin[2];
+        float uvStep;
+        float unused = 0.0f;
+    };
+    static_assert(sizeof(VertexBlock) == 32, "VertexBlock must match the shader's array stride");
+
+    // ─────────────────────────────────────────────────────────────────────────
+    // Normal packing
+    //
+    // Defined in NormalPacking.cpp. The batched forms produce exactly what the single-normal ones
+    // do, bit for bit, and are the ones loaders should reach for.
+    // ─────────────────────────────────────────────────────────────────────────
+
     /// @brief Packs a unit normal into two signed 16-bit values via the octahedron mapping.
     uint32_t packNormal(float x, float y, float z);
 
     /// @brief Recovers a unit normal from packNormal(), for transforming already-packed geometry.
     void unpackNormal(uint32_t packed, float out[3]);
 
+    /// @brief packNormal() over @p count normals stored as consecutive xyz triples.
+    void packNormals(const float* xyz, uint32_t* out, size_t count);
+
+    /// @brief unpackNormal() over @p count packed normals, written as consecutive xyz triples.
+    void unpackNormals(const uint32_t* packed, float* xyz, size_t count);
+
+    /**
+     * @brief Rotates the packed normals of @p count vertices in place.
+     *
+     * Equivalent to unpacking each, multiplying by @p matrix — column-major, `matrix[column][row]`
+     * — and packing the result, without the normals ever leaving registers in between.
+     */
+    void transformPackedNormals(MeshVertex* vertices, size_t count, const float matrix[3][3]);
+
     /**
      * @enum MaterialBlendMode
      * @brief How a material's coverage is resolved, which decides when it is drawn.
@@ -112,6 +176,30 @@ namespace dmrender {
         uint32_t indexCount = 0;
         int32_t  materialIndex = -1;   ///< Index into Mesh::materials, or -1 for the default.
 
+        /// Run of Mesh::clusters covering this subset's indices, in order. Empty when the
+        /// clusters pass did not run.
+        uint32_t firstCluster = 0;
+        uint32_t clusterCount = 0;
+
+        /// Run of Mesh::lods, finest first, each coarser than the one before. The subset's own
+        /// range is level zero and is not repeated there.
+        uint32_t firstLod = 0;
+        uint32_t lodCount = 0;
+
+        /// Which index array the subset, its clusters and its levels live in. In
+        /// Mesh::indices16 the indices are relative to baseVertex, which the draw passes as its
+        /// vertex offset; in Mesh::indices they are absolute and baseVertex is zero. index16 is
+        /// 0 or 1, a word rather than a bool: subsets are cached as they are in memory, and a
+        /// bool here would leave three bytes of padding whose contents nobody sets.
+        uint32_t baseVertex = 0;
+        uint32_t index16 = 0;
+
+        /// Run of Mesh::instances. Empty for an ordinary subset, drawn once where it stands.
+        /// Otherwise the subset's geometry is the first of several copies, and each copy — that
+        /// first one included — is drawn through its instance.
+        uint32_t firstInstance = 0;
+        uint32_t instanceCount = 0;
+
         float boundsMin[3] = {  1e30f,  1e30f,  1e30f };
         float boundsMax[3] = { -1e30f, -1e30f, -1e30f };
 
@@ -123,6 +211,104 @@ namespace dmrender {
         /// @brief Radius of a sphere enclosing the bounds.
         float radius() const;
     };
+    static_assert(sizeof(MeshSubset) == 68, "MeshSubset is cached as it is and must have no padding");
+
+    /**
+     * @struct MeshCluster
+     * @brief A run of at most 124 triangles over at most 64 vertices, culled on its own.
+     *
+     * A subset that survives culling still submits every triangle it has, including the ones
+     * facing away and the ones off screen. Clusters are small enough for their bounds to be
+     * tight and their normals to agree, so per frame the CPU can drop those that are outside the
+     * frustum or facing entirely away, and draw the survivors as a few index ranges.
+     */
+    struct MeshCluster {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+
+        float center[3] = { 0.0f, 0.0f, 0.0f };   ///< Bounding sphere.
+        float radius = 0.0f;
+
+        /**
+         * @brief Normal cone: every triangle's normal is within its half-angle of the axis.
+         *
+         * Stored as the sine of the half-angle, which is what the test wants: the cluster faces
+         * away from an eye at `e` when `dot(center - e, axis) >= coneCutoff * |center - e| +
+         * radius`. An axis of zero with a cutoff of 1 marks a cone too wide to ever cull.
+         */
+        float coneAxis[3] = { 0.0f, 0.0f, 0.0f };
+        float coneCutoff = 1.0f;
+    };
+
+    /**
+     * @struct MeshLod
+     * @brief A simplified version of one subset: its own run of indices over the same vertices.
+     *
+     * Simplification only removes vertices, never moves them, so a level needs no vertex data of
+     * its own and costs index memory alone. Levels live after every subset's range, in the same
+     * index array as their subset.
+     */
+    struct MeshLod {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        /// Distance, in world units, by which the level may stray from the full surface. The
+        /// renderer divides it by view distance to get the error on screen.
+        float error = 0.0f;
+    };
+
+    /**
+     * @struct MeshInstance
+     * @brief One placement of an instanced subset: where a copy of it stands in the scene.
+     *
+     * The transform is a rotation, a uniform scale and a translation, which is all findInstances()
+     * accepts. That restriction is what lets the vertex shader carry normals by the same matrix.
+     */
+    struct MeshInstance {
+        /// Rows of a 3x4 matrix taking the subset's vertices to this copy's.
+        float transform[12] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0 };
+        float center[3] = { 0.0f, 0.0f, 0.0f };   ///< Bounding sphere in the scene.
+        float radius = 0.0f;
+        float scale = 1.0f;   ///< Of the transform; LOD errors grow by it.
+
+        void apply(const float in[3], float out[3]) const {
+            for (int row = 0; row < 3; ++row) {
+                const float* m = transform + row * 4;
+                out[row] = m[0] * in[0] + m[1] * in[1] + m[2] * in[2] + m[3];
+            }
+        }
+    };
+
+    /**
+     * @struct LoadStats
+     * @brief Where one load spent its time and memory, for the startup log and the Scene panel.
+     *
+     * A slow start can be the text parse, deduplication, normal generation, FBX inflation, the
+     * assets of a `.dmscene` or any of the load passes, and the total alone does not say which.
+     * Filled by loadMesh(), by the readers it calls and by loadSceneCache(); never cached, since
+     * it describes the load rather than the scene. Allocation counts are not kept: measuring them
+     * means replacing the global operator new for the whole program. Resident memory is kept.
+     */
+    struct LoadStats {
+        struct Phase {
+            std::string name;
+            double seconds = 0.0;
+        };
+        /// In the order each phase first ran. Phases that run more than once — per asset, per
+        /// placement — are summed under one name.
+        std::vector<Phase> phases;
+
+        uint64_t bytesRead = 0;          ///< Model files, or the cache, as read from disk.
+        size_t cornersRead = 0;          ///< Polygon corners the readers deduplicated.
+        size_t verticesAfterDedup = 0;   ///< Vertices those corners collapsed into.
+        size_t residentBytes = 0;        ///< When the load finished.
+        size_t peakResidentBytes = 0;    ///< Of the process, up to the end of the load.
+        double seconds = 0.0;            ///< The whole load, wall clock.
+        bool fromCache = false;
+
+        void add(const std::string& name, double phaseSeconds);
+        /// @brief Folds in the phases and counts of a load that went into this one.
+        void merge(const LoadStats& other);
+    };
 
     /**
      * @struct Mesh
@@ -135,20 +321,40 @@ namespace dmrender {
     struct Mesh {
         std::vector<MeshVertex>   vertices;
         std::vector<uint32_t>     indices;
+        /// Indices of the subsets narrowIndices() found fit in 16 bits; see MeshSubset::index16.
+        std::vector<uint16_t>     indices16;
         std::vector<MeshSubset>   subsets;
         std::vector<MeshMaterial> materials;
+        std::vector<MeshCluster>  clusters;
+        std::vector<MeshLod>      lods;
+        std::vector<MeshInstance> instances;
+
+        /// What the GPU gets instead of `vertices` when the compact-vertex pass found the
+        /// scene's precision fits in 16 bytes; empty otherwise. `vertices` is kept either way
+        /// for everything on the CPU side.
+        std::vector<CompactVertex> compactVertices;
+        std::vector<VertexBlock>   vertexBlocks;
 
         float boundsMin[3] = {  1e30f,  1e30f,  1e30f };
         float boundsMax[3] = { -1e30f, -1e30f, -1e30f };
 
         bool hadNormals   = false;
         bool hadTexCoords = false;
+        /// @brief Which LoadPass stages have run; the cache records it.
+        uint32_t loadPasses = 0;
         std::string sourceFormat;
 
         /// @brief Directory the model was loaded from; texture paths resolve against it.
         std::filesystem::path baseDirectory;
 
-        bool empty() const { return vertices.empty() || indices.empty(); }
+        /// @brief How this mesh came to be; see LoadStats.
+        LoadStats loadStats;
+
+        bool empty() const { return vertices.empty() || (indices.empty() && indices16.empty()); }
+
+        /// @brief Triangles at full detail: what the subsets cover, each instance counted, not
+        /// counting the LODs.
+        size_t triangleCount() const;
 
         std::array<float, 3> center() const {
             return { (boundsMin[0] + boundsMax[0]) * 0.5f,
@@ -159,19 +365,169 @@ namespace dmrender {
         /// @brief Longest side of the bounding box. Used to scale camera speed and clip planes.
         float boundsExtent() const;
 
-        /// @brief Bytes the geometry occupies, for the memory report.
+        /// @brief Bytes the geometry occupies in video memory, for the memory report.
         size_t geometryBytes() const {
-            return vertices.size() * sizeof(MeshVertex) + indices.size() * sizeof(uint32_t);
+            const size_t vertexBytes = compactVertices.empty()
+                ? vertices.size() * sizeof(MeshVertex)
+                : compactVertices.size() * sizeof(CompactVertex) + vertexBlocks.size() * sizeof(VertexBlock);
+            return vertexBytes + indices.size() * sizeof(uint32_t) + indices16.size() * sizeof(uint16_t);
         }
     };
 
+    /**
+     * @struct LoadProgress
+     * @brief How far a load running on another thread has got, for a loading screen to show.
+     *
+     * Coarse on purpose: the reader has the first half, which it advances by its own measure —
+     * bytes parsed, arrays inflated, corners converted — and every pass that runs is an equal
+     * share of the second, because their real proportions depend on the scene and a bar that
+     * moves steadily is worth more than one that is right on average.
+     */
+    struct LoadProgress {
+        std::atomic<float> fraction{ 0.0f };
+        /// A string literal naming the current stage, so the reading thread never sees it freed.
+        std::atomic<const char*> phase{ "" };
+
+        /**
+         * When set, given a copy of what the reader produced, bounds filled in, before the load
+         * passes run on the original — on the loading thread, and only if any pass is enabled.
+         * The passes are much of a cold load on a large scene, and the copy can be drawn while
+         * they run. It costs the scene's geometry a second time until the caller drops it.
+         */
+        std::function<void(Mesh&&)> preview;
+    };
+
     /**
      * @brief Loads a model, dispatching on file extension.
      * @param path The .obj, .stl, .ply or .fbx file.
      * @param[out] error Human-readable reason on failure.
+     * @param[out] progress Updated as the load advances, when given; read from any thread.
      * @return The loaded mesh, or an empty one on failure.
      */
-    Mesh loadMesh(const std::filesystem::path& path, std::string& error);
+    Mesh loadMesh(const std::filesystem::path& path, std::string& error,
+                  LoadProgress* progress = nullptr);
+
+    // ─────────────────────────────────────────────────────────────────────────
+    // Load passes
+    //
+    // Optional stages loadMesh() runs on whatever the reader produced, each restructuring the
+    // mesh for the renderer. Defined in MeshOptimize.cpp. Which of them ran is stored in the
+    // cache, so changing the setting rebuilds it rather than serving the other variant.
+    // ─────────────────────────────────────────────────────────────────────────
+
+    enum LoadPass : uint32_t {
+        LoadPassSplitSubsets    = 1u << 0,   ///< splitLargeSubsets(); off with `DMRENDER_NOSPLIT`.
+        LoadPassVertexOrder     = 1u << 1,   ///< optimizeVertexOrder(); off with `DMRENDER_NOREORDER`.
+        LoadPassMergeSubsets    = 1u << 2,   ///< mergeSmallSubsets(); off with `DMRENDER_MERGE_TRIANGLES=0`.
+        LoadPassClusters        = 1u << 3,   ///< buildClusters(); off with `DMRENDER_NOCLUSTERS`.
+        LoadPassLods            = 1u << 4,   ///< buildLods(); off with `DMRENDER_NOLOD`.
+        LoadPassCompactVertices = 1u << 5,   ///< buildCompactVertices(); on with `DMRENDER_COMPACT_VERTICES`.
+        LoadPassIndex16         = 1u << 6,   ///< narrowIndices(); off with `DMRENDER_NOINDEX16`.
+        LoadPassInstances       = 1u << 7,   ///< findInstances(); off with `DMRENDER_NOINSTANCES`.
+    };
+
+    /// @brief The LoadPass bits the environment leaves enabled.
+    uint32_t enabledLoadPasses();
+
+    /// @brief Triangle budget of a merged subset from `DMRENDER_MERGE_TRIANGLES`; 0 when disabled.
+    uint32_t subsetMergeTriangles();
+
+    /// @brief Grid spacing loadStl() welds corners to, from `DMRENDER_STL_WELD`; 0 for exact welding.
+    float stlWeldDistance();
+
+    /**
+     * @brief Replaces repeated copies of a subset with instances of one of them.
+     *
+     * Two subsets are copies when they share a material, the same triangles over the same
+     * texture coordinates, and positions and normals that one rotation, uniform scale and
+     * translation carry onto the other — a prop placed twenty times, a row of chairs, a leaf
+     * cluster repeated over a tree. The first copy keeps its geometry, every copy becomes a
+     * MeshInstance, and the rest of the geometry is dropped. Runs first, while subsets are still
+     * the objects the file described; the passes after it leave instanced subsets whole.
+     */
+    void findInstances(Mesh& mesh);
+
+    /**
+     * @brief Cuts subsets that are too large or too spread out to cull into compact pieces.
+     *
+     * The pieces keep the material and together cover the subset's original index range, so no
+     * other subset moves. Bounds are left for computeBounds() to fill.
+     */
+    void splitLargeSubsets(Mesh& mesh);
+
+    /**
+     * @brief Gathers small subsets of one material that lie close together into single subsets.
+     *
+     * Each subset is a draw call, and a fragmented scene spends its frame issuing them rather
+     * than drawing. A merged subset stays within the subsetMergeTriangles() budget and the same
+     * extent splitLargeSubsets() cuts down to, so culling keeps working. Transparent subsets are
+     * left as they are, since the renderer sorts them back-to-front one by one. Rewrites the index
+     * buffer so every merged subset is one contiguous run. Needs computeBounds() first.
+     */
+    void mergeSmallSubsets(Mesh& mesh);
+
+    /**
+     * @brief Reorders triangles for the post-transform cache and vertices for fetch locality.
+     *
+     * Triangles move only within their subset, so subsets and bounds are unaffected. Reports the
+     * modelled cache miss rates before and after.
+     */
+    void optimizeVertexOrder(Mesh& mesh);
+
+    /**
+     * @brief Cuts every subset into MeshClusters, with bounding spheres and normal cones.
+     *
+     * Clusters are consecutive runs of the subset's triangles as they stand, so this runs after
+     * the last pass that moves triangles: after optimizeVertexOrder() neighbouring triangles share
+     * vertices and the runs are compact. The passes after it, buildLods(), buildCompactVertices()
+     * and narrowIndices(), append to or re-encode the buffers but leave every triangle in place.
+     */
+    void buildClusters(Mesh& mesh);
+
+    /**
+     * @brief Gives every sizeable subset a chain of up to three simplified MeshLods.
+     *
+     * Each level aims at half the triangles of the one before, by quadric-error edge collapse
+     * (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997). Open
+     * borders stay put, so neighbouring subsets drawn at different levels do not crack apart.
+     * Appends the levels to the index buffer, so it runs after everything that rewrites it.
+     */
+    void buildLods(Mesh& mesh);
+
+    /**
+     * @brief Encodes the vertices as CompactVertex, if the scene loses nothing visible by it.
+     *
+     * Every block must resolve positions to 1/256 of the mean length of its edges, and texture
+     * coordinates to a sixteen-thousandth of a repeat so that the tiled coordinates the
+     * MeshVertex note warns about do not swim. A block that falls short is cut into pieces that
+     * do not, each padded out to a block of its own, and the vertices and indices are renumbered
+     * to match; only if the padding would eat the saving does the scene keep the 24-byte layout.
+     * A position held by several blocks is rounded to the coarsest of their grids, which is
+     * within what that block allows its own triangles. Runs after buildLods(), on the final
+     * vertex order; only narrowIndices() follows it, and it takes the vertex ranges as they are.
+     */
+    void buildCompactVertices(Mesh& mesh);
+
+    /**
+     * @brief Moves every subset whose vertices span fewer than 65535 ids to 16-bit indices.
+     *
+     * Most subsets touch a few thousand vertices, and 32 bits of index for each corner is twice
+     * what they need in memory and in index fetch. A subset that fits is stored relative to a
+     * base vertex shared with as many neighbours as fit under it, so their draws can still
+     * merge; the rest stay 32-bit. Everything that reads indices on the CPU runs before this.
+     */
+    void narrowIndices(Mesh& mesh);
+
+    /**
+     * @brief Highest resident memory of the process so far, in bytes. Defined in LoadSupport.cpp.
+     *
+     * Reported after loading: for the large scenes the loader's transient peak, not the mesh it
+     * leaves behind, decides whether a machine can open them at all.
+     */
+    size_t peakResidentBytes();
+
+    /// @brief Resident memory of the process right now, in bytes. Defined in LoadSupport.cpp.
+    size_t currentResidentBytes();
 
     /**
      * @brief Reads a binary FBX. Defined in FbxLoader.cpp.
@@ -179,8 +535,11 @@ namespace dmrender {
      * Separate from the other readers because FBX is a container rather than a geometry format:
      * the parser that gets to the vertices is most of the file, and none of it is shared with the
      * line-oriented readers in Mesh.cpp.
+     *
+     * @param[out] progress Moved through its reading half as arrays inflate and geometry converts.
      */
-    bool loadFbx(const std::filesystem::path& path, Mesh& mesh, std::string& error);
+    bool loadFbx(const std::filesystem::path& path, Mesh& mesh, std::string& error,
+                 LoadProgress* progress = nullptr);
 
     /**
      * @brief Reads a `.dmscene` kit layout. Defined in SceneKit.cpp.
@@ -188,8 +547,11 @@ namespace dmrender {
      * Asset kits ship every prop at the origin with no placement data, so the arrangement has to
      * come from somewhere: this reads a small hand-editable text file naming assets, positions
      * and yaws, and merges the referenced models into one mesh.
+     *
+     * @param[out] progress Moved through its reading half as the layout's lines are placed.
      */
-    bool loadScene(const std::filesystem::path& path, Mesh& mesh, std::string& error);
+    bool loadScene(const std::filesystem::path& path, Mesh& mesh, std::string& error,
+                   LoadProgress* progress = nullptr);
 
     // ─────────────────────────────────────────────────────────────────────────
     // Binary cache
@@ -0,0 +1,1946 @@
+//
+// Restructuring a loaded mesh for the GPU.
+//
+// Two things are wrong with a mesh straight out of a reader, and neither is the reader's fault.
+//
+// Its subsets are whatever the file grouped by material, which for a terrain, a floor or a
+// scanned statue is one subset spanning the whole scene. Per-subset culling can never reject
+// that subset, so every one of its triangles is drawn from every viewpoint. Such subsets are cut
+// into compact pieces by recursive median splits of their triangles, so each piece has tight
+// bounds and culls on its own.
+//
+// And its order is wrong. Loaders emit triangles in whatever order the source file lists them,
+// and vertices in the order deduplication first met them. Neither is the order the hardware
+// wants. After a vertex is shaded its result sits in a small post-transform cache, and a
+// triangle whose corners are all still there costs no vertex work at all; triangles in file
+// order revisit a vertex long after it has been evicted. And since the vertex shader pulls
+// MeshVertex out of a storage buffer by vertex id, vertices referenced close together in time
+// should sit close together in memory, or every fetch is a cache line of its own.
+//
+// So ordering takes two passes. Each subset's triangles are reordered with Tipsify (Sander, Nehab and
+// Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007) — linear
+// time, which matters at thirty million triangles, and within a few percent of the slower
+// Forsyth ordering on cache misses. Then the vertices are renumbered in the order the new index
+// stream first uses them. Subsets keep their index ranges, so nothing else in the mesh moves.
+//
+// Then every subset is cut into clusters: runs of its now well-ordered triangles small enough
+// that the renderer can cull each one by a bounding sphere and a normal cone.
+//
+// Then every subset that is large enough gets simplified versions of itself for the renderer
+// to draw when it is far away, appended after the full-detail indices.
+//
+// Then, only on request, the vertices are re-encoded in 16 bytes instead of 24, on grids fitted
+// to runs of 256 of them; a run too spread out for one grid is cut into pieces that are not.
+//
+// Last, the indices of every subset that references fewer than 65535 vertices are rebased and
+// stored in 16 bits. That is most of them, and it halves what the index buffer costs.
+//
+// Before any of this, though, copies are looked for. A scene assembled by copying stores the
+// same prop once per placement; each set of copies becomes one subset drawn through a list of
+// instances, and the passes above see only that one.
+//
+
+#include "Mesh.hpp"
+#include "LoadSupport.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace dmrender {
+
+    namespace {
+
+        /// Entries of the modelled post-transform cache. Real hardware is neither FIFO nor
+        /// exactly this size, but sixteen is the figure ACMR is conventionally quoted at, and an
+        /// order that is good for it is good for the real thing.
+        constexpr uint32_t kCacheSize = 16;
+
+        /**
+         * @struct CacheStats
+         * @brief How often the modelled cache misses, the usual two ways.
+         *
+         * ACMR — misses per triangle — is 3 for no reuse at all and approaches 0.5 on a large
+         * regular grid. ATVR — misses per referenced vertex — is 1 when every vertex is shaded
+         * exactly once, and is comparable across meshes of different connectivity, which ACMR
+         * is not.
+         */
+        struct CacheStats {
+            double acmr = 0.0;
+            double atvr = 0.0;
+        };
+
+        /// @brief Runs the whole index buffer through a FIFO of kCacheSize entries.
+        CacheStats simulateCache(const std::vector<uint32_t>& indices, size_t vertexCount)
+        {
+            // A vertex is cached if it entered within the last kCacheSize misses: a timestamp
+            // per vertex models the FIFO without storing it.
+            std::vector<uint32_t> entered(vertexCount, 0);
+            uint32_t time = kCacheSize + 1;
+            size_t misses = 0;
+            for (const uint32_t index : indices) {
+                if (time - entered[index] > kCacheSize) {
+                    entered[index] = time++;
+                    ++misses;
+                }
+            }
+            const size_t referenced = vertexCount - static_cast<size_t>(
+                std::count(entered.begin(), entered.end(), 0u));
+
+            CacheStats stats;
+            if (!indices.empty()) stats.acmr = static_cast<double>(misses) / static_cast<double>(indices.size() / 3);
+            if (referenced > 0)   stats.atvr = static_cast<double>(misses) / static_cast<double>(referenced);
+            return stats;
+        }
+
+        /**
+         * @brief Tipsify over one subset's triangles, in place.
+         *
+         * Vertices are first renumbered densely within the subset, so the working arrays are
+         * sized by the subset rather than the mesh — a kit scene has thousands of subsets over
+         * one shared vertex buffer, and each must not cost the whole buffer.
+         */
+        void tipsify(uint32_t* indices, size_t indexCount)
+        {
+            const size_t triangleCount = indexCount / 3;
+            if (triangleCount < 2) return;
+
+            // ── Dense local numbering, in mesh vertex order ──
+            std::vector<uint64_t> keys(indexCount);
+            for (size_t corner = 0; corner < indexCount; ++corner) {
+                keys[corner] = (static_cast<uint64_t>(indices[corner]) << 32) | corner;
+            }
+            std::sort(keys.begin(), keys.end());
+
+            std::vector<uint32_t> local(indexCount);
+            std::vector<uint32_t> global;
+            for (const uint64_t key : keys) {
+                const uint32_t vertex = static_cast<uint32_t>(key >> 32);
+                if (global.empty() || global.back() != vertex) global.push_back(vertex);
+                local[static_cast<uint32_t>(key)] = static_cast<uint32_t>(global.size() - 1);
+            }
+            keys = {};
+            const size_t vertexCount = global.size();
+
+            // ── Triangles around each vertex ──
+            std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+            for (const uint32_t vertex : local) ++adjacencyStart[vertex + 1];
+            for (size_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] += adjacencyStart[v];
+            std::vector<uint32_t> adjacency(indexCount);
+            {
+                std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+                for (size_t corner = 0; corner < indexCount; ++corner) {
+                    adjacency[cursor[local[corner]]++] = static_cast<uint32_t>(corner / 3);
+                }
+            }
+
+            // Triangles not yet emitted that use each vertex.
+            std::vector<uint32_t> live(vertexCount);
+            for (size_t v = 0; v < vertexCount; ++v) live[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+
+            std::vector<uint32_t> entered(vertexCount, 0);
+            std::vector<uint8_t> emitted(triangleCount, 0);
+            std::vector<uint32_t> deadEnds;       // recently used vertices, to resume from
+            std::vector<uint32_t> candidates;
+            std::vector<uint32_t> output;
+            output.reserve(indexCount);
+
+            uint32_t time = kCacheSize + 1;
+            size_t cursor = 0;                    // next vertex to try once the dead ends run out
+            int64_t fan = local[0];
+
+            while (fan >= 0) {
+                // Emit every remaining triangle around the fanning vertex.
+                candidates.clear();
+                for (uint32_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; ++a) {
+                    const uint32_t triangle = adjacency[a];
+                    if (emitted[triangle]) continue;
+                    emitted[triangle] = 1;
+                    for (int corner = 0; corner < 3; ++corner) {
+                        const uint32_t vertex = local[triangle * 3 + corner];
+                        output.push_back(global[vertex]);
+                        deadEnds.push_back(vertex);
+                        candidates.push_back(vertex);
+                        --live[vertex];
+                        if (time - entered[vertex] > kCacheSize) entered[vertex] = time++;
+                    }
+                }
+
+                // Next, the candidate that will still be in the cache after its own remaining
+                // triangles are emitted and has been there longest — it is the one about to fall
+                // out. Failing that, any candidate with work left.
+                int64_t next = -1;
+                int64_t bestPriority = -1;
+                for (const uint32_t vertex : candidates) {
+                    if (live[vertex] == 0) continue;
+                    int64_t priority = 0;
+                    const int64_t age = static_cast<int64_t>(time - entered[vertex]);
+                    if (age + 2 * static_cast<int64_t>(live[vertex]) <= kCacheSize) priority = age;
+                    if (priority > bestPriority) { bestPriority = priority; next = vertex; }
+                }
+
+                // A dead end: back up through recently used vertices, then sweep forward.
+                while (next < 0 && !deadEnds.empty()) {
+                    const uint32_t vertex = deadEnds.back();
+                    deadEnds.pop_back();
+                    if (live[vertex] > 0) next = vertex;
+                }
+                while (next < 0 && cursor < vertexCount) {
+                    if (live[cursor] > 0) next = static_cast<int64_t>(cursor);
+                    else ++cursor;
+                }
+                fan = next;
+            }
+
+            std::copy(output.begin(), output.end(), indices);
+        }
+
+        /// Longest a subset may be, as a fraction of the scene, before it is too big to cull
+        /// well. Splitting cuts down to it and merging never builds past it, so the two passes
+        /// cannot undo each other.
+        constexpr float kMaxExtentFraction = 1.0f / 8.0f;
+
+        /// Subsets are cut until no piece has more triangles than this or is longer than the
+        /// limit above...
+        constexpr size_t kSplitMaxTriangles = size_t(1) << 15;
+        /// ...but never below this: past it a piece saves less drawing than its draw call costs.
+        constexpr size_t kSplitMinTriangles = size_t(1) << 11;
+
+        /// Default triangle budget of a merged subset, when `DMRENDER_MERGE_TRIANGLES` is unset.
+        constexpr uint32_t kDefaultMergeTriangles = 4096;
+
+        /// The usual meshlet limits: 64 vertices and 124 triangles are what mesh-shading hardware
+        /// is built around, and small enough that a cluster's normals mostly agree.
+        constexpr size_t kClusterVertices = 64;
+        constexpr size_t kClusterTriangles = 124;
+
+        /**
+         * @brief Splits one subset, rewriting its index range in place.
+         *
+         * A k-d split on triangle centroids: the longest axis of a piece's centroid bounds is
+         * cut at the median, which keeps pieces balanced whatever the triangle density. Pieces
+         * come out depth first, so neighbours in the subset list are neighbours in space.
+         */
+        std::vector<MeshSubset> splitSubset(const Mesh& mesh, const MeshSubset& subset,
+                                            float maxExtent, uint32_t* indices)
+        {
+            const size_t triangleCount = subset.indexCount / 3;
+
+            std::vector<float> centroids(triangleCount * 3);
+            for (size_t t = 0; t < triangleCount; ++t) {
+                const MeshVertex& a = mesh.vertices[indices[t * 3 + 0]];
+                const MeshVertex& b = mesh.vertices[indices[t * 3 + 1]];
+                const MeshVertex& c = mesh.vertices[indices[t * 3 + 2]];
+                for (int axis = 0; axis < 3; ++axis) {
+                    centroids[t * 3 + axis] = (a.position[axis] + b.position[axis] + c.position[axis]) / 3.0f;
+                }
+            }
+
+            std::vector<uint32_t> order(triangleCount);
+            for (size_t t = 0; t < triangleCount; ++t) order[t] = static_cast<uint32_t>(t);
+
+            std::vector<MeshSubset> pieces;
+            struct Range { size_t begin, end; };
+            std::vector<Range> pending{ { 0, triangleCount } };
+            while (!pending.empty()) {
+                const Range range = pending.back();
+                pending.pop_back();
+
+                float lo[3] = {  1e30f,  1e30f,  1e30f };
+                float hi[3] = { -1e30f, -1e30f, -1e30f };
+                for (size_t i = range.begin; i < range.end; ++i) {
+                    for (int axis = 0; axis < 3; ++axis) {
+                        lo[axis] = std::min(lo[axis], centroids[order[i] * 3 + axis]);
+                        hi[axis] = std::max(hi[axis], centroids[order[i] * 3 + axis]);
+                    }
+                }
+                int axis = 0;
+                for (int a = 1; a < 3; ++a) {
+                    if (hi[a] - lo[a] > hi[axis] - lo[axis]) axis = a;
+                }
+
+                const size_t count = range.end - range.begin;
+                const bool small = count <= kSplitMaxTriangles && hi[axis] - lo[axis] <= maxExtent;
+                if (small || count <= kSplitMinTriangles || hi[axis] <= lo[axis]) {
+                    MeshSubset piece;
+                    piece.firstIndex = subset.firstIndex + static_cast<uint32_t>(range.begin * 3);
+                    piece.indexCount = static_cast<uint32_t>(count * 3);
+                    piece.materialIndex = subset.materialIndex;
+                    pieces.push_back(piece);
+                    continue;
+                }
+
+                const size_t middle = range.begin + count / 2;
+                std::nth_element(order.begin() + static_cast<std::ptrdiff_t>(range.begin),
+                                 order.begin() + static_cast<std::ptrdiff_t>(middle),
+                                 order.begin() + static_cast<std::ptrdiff_t>(range.end),
+                                 [&](uint32_t x, uint32_t y) {
+                                     return centroids[x * 3 + axis] < centroids[y * 3 + axis];
+                                 });
+                // Upper half pushed first so the lower half is emitted first.
+                pending.push_back({ middle, range.end });
+                pending.push_back({ range.begin, middle });
+            }
+
+            // Pieces were emitted in order of their ranges, so permuting the triangles by the
+            // final order places every piece at the indices it was given.
+            std::vector<uint32_t> reordered(subset.indexCount);
+            for (size_t i = 0; i < triangleCount; ++i) {
+                std::copy_n(indices + order[i] * 3, 3, reordered.data() + i * 3);
+            }
+            std::copy(reordered.begin(), reordered.end(), indices);
+            return pieces;
+        }
+
+        /// @brief Fills in the bounding sphere and normal cone of @p cluster's triangles.
+        void fitCluster(const Mesh& mesh, MeshCluster& cluster)
+        {
+            const uint32_t* indices = mesh.indices.data() + cluster.firstIndex;
+
+            float lo[3] = {  1e30f,  1e30f,  1e30f };
+            float hi[3] = { -1e30f, -1e30f, -1e30f };
+            for (uint32_t i = 0; i < cluster.indexCount; ++i) {
+                const float* p = mesh.vertices[indices[i]].position;
+                for (int axis = 0; axis < 3; ++axis) {
+                    lo[axis] = std::min(lo[axis], p[axis]);
+                    hi[axis] = std::max(hi[axis], p[axis]);
+                }
+            }
+            float radiusSquared = 0.0f;
+            for (int axis = 0; axis < 3; ++axis) cluster.center[axis] = (lo[axis] + hi[axis]) * 0.5f;
+            for (uint32_t i = 0; i < cluster.indexCount; ++i) {
+                const float* p = mesh.vertices[indices[i]].position;
+                const float dx = p[0] - cluster.center[0];
+                const float dy = p[1] - cluster.center[1];
+                const float dz = p[2] - cluster.center[2];
+                radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+            }
+            cluster.radius = std::sqrt(radiusSquared);
+
+            // Face normals from the positions, not the stored vertex normals: winding is what
+            // the rasteriser culls by, and smoothed normals say nothing about it.
+            std::vector<std::array<float, 3>> normals;
+            normals.reserve(cluster.indexCount / 3);
+            float axis[3] = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t t = 0; t + 2 < cluster.indexCount; t += 3) {
+                const float* a = mesh.vertices[indices[t + 0]].position;
+                const float* b = mesh.vertices[indices[t + 1]].position;
+                const float* c = mesh.vertices[indices[t + 2]].position;
+                const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                std::array<float, 3> n = { e1[1] * e2[2] - e1[2] * e2[1],
+                                           e1[2] * e2[0] - e1[0] * e2[2],
+                                           e1[0] * e2[1] - e1[1] * e2[0] };
+                const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                // A degenerate triangle covers no pixels; it may face any way it likes.
+                if (length <= 1e-20f) continue;
+                for (float& component : n) component /= length;
+                for (int k = 0; k < 3; ++k) axis[k] += n[k];
+                normals.push_back(n);
+            }
+
+            const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+            if (normals.empty() || axisLength <= 1e-6f) return;   // the defaults never cull
+            for (float& component : axis) component /= axisLength;
+
+            float minDot = 1.0f;
+            for (const std::array<float, 3>& n : normals) {
+                minDot = std::min(minDot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+            }
+            // At ninety degrees or more the cone holds a front face from every direction.
+            if (minDot <= 0.0f) return;
+
+            std::copy_n(axis, 3, cluster.coneAxis);
+            cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+
+        /// Subsets with fewer triangles than this get no LODs: a level would save less drawing
+        /// than the selection and the index memory cost.
+        constexpr size_t kLodMinTriangles = 256;
+        /// Levels below the full subset. Each aims at half the triangles of the one before...
+        constexpr size_t kLodLevels = 3;
+        /// ...and is kept only if it gets below this fraction of it. A level that barely
+        /// simplifies is index memory for nothing, and the chain stops there.
+        constexpr double kLodMinReduction = 0.75;
+        /// No collapse may move the surface by more than this fraction of the subset's radius.
+        /// Past it a level is a different shape, and no viewing distance makes that right.
+        constexpr double kLodMaxErrorFraction = 0.05;
+
+        /**
+         * @struct Quadric
+         * @brief Squared distance to a set of planes, summed with triangle area as the weight.
+         *
+         * Divided by the summed weight it is the mean squared distance of a point from the
+         * surface the planes came from, which is a length once rooted — what the renderer needs
+         * to compare against a pixel.
+         */
+        struct Quadric {
+            double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+            double weight = 0.0;
+
+            void addPlane(const double n[3], double d, double w)
+            {
+                a00 += w * n[0] * n[0]; a11 += w * n[1] * n[1]; a22 += w * n[2] * n[2];
+                a01 += w * n[0] * n[1]; a02 += w * n[0] * n[2]; a12 += w * n[1] * n[2];
+                b0 += w * n[0] * d; b1 += w * n[1] * d; b2 += w * n[2] * d;
+                c += w * d * d;
+                weight += w;
+            }
+
+            Quadric& operator+=(const Quadric& other)
+            {
+                a00 += other.a00; a11 += other.a11; a22 += other.a22;
+                a01 += other.a01; a02 += other.a02; a12 += other.a12;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                weight += other.weight;
+                return *this;
+            }
+
+            /// @brief The weighted sum of squared distances of @p p, not yet divided by weight.
+            double sum(const std::array<double, 3>& p) const
+            {
+                const double x = p[0], y = p[1], z = p[2];
+                const double value = a00 * x * x + a11 * y * y + a22 * z * z
+                                   + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                                   + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+                return std::max(value, 0.0);
+            }
+        };
+
+        /// @brief One simplified level of a subset, in mesh vertex numbering.
+        struct LodLevel {
+            std::vector<uint32_t> indices;
+            float error = 0.0f;
+        };
+
+        /**
+         * @brief Simplifies one subset by edge collapse, keeping a snapshot at each level.
+         *
+         * Collapses move one vertex onto a neighbour, never to a new position, so every level
+         * indexes the vertices the mesh already has. The topology is that of positions: the
+         * vertices either side of a UV or normal seam are welded into one position for the
+         * purpose, and a position on a seam only collapses along it: across an edge whose two
+         * sides have different vertices, and only where the seam runs straight through rather
+         * than ends or meets another. Onto a seam position across any other edge would drag the
+         * seam off its line, or onto a second seam, so the seam keeps its shape and each side
+         * keeps its own attributes. Positions on an open or
+         * non-manifold edge never move, which is what keeps neighbouring subsets at different
+         * levels joined up.
+         *
+         * Collapses are done in passes of independent edges, cheapest first: one collapse per
+         * neighbourhood per pass keeps the fold-over test exact without updating a priority queue
+         * after every collapse.
+         */
+        std::vector<LodLevel> simplifySubset(const Mesh& mesh, const MeshSubset& subset)
+        {
+            const uint32_t* source = mesh.indices.data() + subset.firstIndex;
+            const size_t indexCount = subset.indexCount - subset.indexCount % 3;
+
+            // ── Dense local numbering, as in tipsify() ──
+            std::vector<uint64_t> keys(indexCount);
+            for (size_t corner = 0; corner < indexCount; ++corner) {
+                keys[corner] = (static_cast<uint64_t>(source[corner]) << 32) | corner;
+            }
+            std::sort(keys.begin(), keys.end());
+            std::vector<uint32_t> vertexOf(indexCount);
+            std::vector<uint32_t> global;
+            for (const uint64_t key : keys) {
+                const uint32_t vertex = static_cast<uint32_t>(key >> 32);
+                if (global.empty() || global.back() != vertex) global.push_back(vertex);
+                vertexOf[static_cast<uint32_t>(key)] = static_cast<uint32_t>(global.size() - 1);
+            }
+            keys = {};
+            const size_t vertexCount = global.size();
+
+            // ── Positions: vertices that share one are a single point of the topology ──
+            std::vector<uint32_t> byPosition(vertexCount);
+            std::iota(byPosition.begin(), byPosition.end(), 0u);
+            std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) {
+                const float* pa = mesh.vertices[global[a]].position;
+                const float* pb = mesh.vertices[global[b]].position;
+                if (pa[0] != pb[0]) return pa[0] < pb[0];
+                if (pa[1] != pb[1]) return pa[1] < pb[1];
+                if (pa[2] != pb[2]) return pa[2] < pb[2];
+                return a < b;
+            });
+            std::vector<uint32_t> pointOf(vertexCount);
+            std::vector<uint32_t> memberStart;      // point p owns byPosition[memberStart[p], [p + 1])
+            for (size_t i = 0; i < vertexCount; ++i) {
+                const float* p = mesh.vertices[global[byPosition[i]]].position;
+                const bool same = i > 0 &&
+                    std::equal(p, p + 3, mesh.vertices[global[byPosition[i - 1]]].position);
+                if (!same) memberStart.push_back(static_cast<uint32_t>(i));
+                pointOf[byPosition[i]] = static_cast<uint32_t>(memberStart.size() - 1);
+            }
+            const size_t pointCount = memberStart.size();
+            memberStart.push_back(static_cast<uint32_t>(vertexCount));
+
+            // Relative to the subset's centre, so the quadrics do not lose precision to a scene
+            // that sits a kilometre from the origin.
+            const std::array<float, 3> center = subset.center();
+            std::vector<std::array<double, 3>> points(pointCount);
+            for (size_t p = 0; p < pointCount; ++p) {
+                const float* position = mesh.vertices[global[byPosition[memberStart[p]]]].position;
+                for (int axis = 0; axis < 3; ++axis) {
+                    points[p][axis] = static_cast<double>(position[axis]) - center[axis];
+                }
+            }
+
+            // ── Working triangles, as points and as vertices; degenerate ones are dropped ──
+            std::vector<uint32_t> cornerPoint, cornerVertex;
+            cornerPoint.reserve(indexCount);
+            cornerVertex.reserve(indexCount);
+            for (size_t t = 0; t < indexCount; t += 3) {
+                const uint32_t a = pointOf[vertexOf[t]], b = pointOf[vertexOf[t + 1]], c = pointOf[vertexOf[t + 2]];
+                if (a == b || b == c || a == c) continue;
+                for (int k = 0; k < 3; ++k) {
+                    cornerPoint.push_back(pointOf[vertexOf[t + k]]);
+                    cornerVertex.push_back(vertexOf[t + k]);
+                }
+            }
+            vertexOf = {};
+
+            // ── What may move: an edge used by one triangle, or by more than two, pins its ends ──
+            enum PointKind : uint8_t { Interior, Seam, Pinned };
+            std::vector<uint8_t> kind(pointCount, Interior);
+            for (size_t p = 0; p < pointCount; ++p) {
+                if (memberStart[p + 1] - memberStart[p] > 1) kind[p] = Seam;
+            }
+            {
+                std::vector<uint64_t> edges;
+                edges.reserve(cornerPoint.size());
+                for (size_t t = 0; t < cornerPoint.size(); t += 3) {
+                    for (int k = 0; k < 3; ++k) {
+                        const uint32_t a = cornerPoint[t + k], b = cornerPoint[t + (k + 1) % 3];
+                        edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+                    }
+                }
+                std::sort(edges.begin(), edges.end());
+                for (size_t i = 0; i < edges.size();) {
+                    size_t j = i + 1;
+                    while (j < edges.size() && edges[j] == edges[i]) ++j;
+                    if (j - i != 2) {
+                        kind[static_cast<uint32_t>(edges[i] >> 32)] = Pinned;
+                        kind[static_cast<uint32_t>(edges[i])] = Pinned;
+                    }
+                    i = j;
+                }
+            }
+
+            // ── One quadric per point, from the planes of the triangles around it ──
+            std::vector<Quadric> quadrics(pointCount);
+            for (size_t t = 0; t < cornerPoint.size(); t += 3) {
+                const std::array<double, 3>& a = points[cornerPoint[t]];
+                const std::array<double, 3>& b = points[cornerPoint[t + 1]];
+                const std::array<double, 3>& c = points[cornerPoint[t + 2]];
+                const double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                const double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                double n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                                e1[2] * e2[0] - e1[0] * e2[2],
+                                e1[0] * e2[1] - e1[1] * e2[0] };
+                const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (length <= 0.0) continue;
+                for (double& component : n) component /= length;
+                const double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+                for (int k = 0; k < 3; ++k) quadrics[cornerPoint[t + k]].addPlane(n, d, length * 0.5);
+            }
+
+            // Which of @p point's vertices should stand in for @p vertex: the nearest in texture
+            // coordinates and then in normal, i.e. the one on the same side of the seam.
+            auto closestMember = [&](uint32_t vertex, uint32_t point) -> uint32_t {
+                if (memberStart[point + 1] - memberStart[point] == 1) return byPosition[memberStart[point]];
+                const MeshVertex& from = mesh.vertices[global[vertex]];
+                float fromNormal[3];
+                unpackNormal(from.packedNormal, fromNormal);
+                uint32_t best = byPosition[memberStart[point]];
+                float bestScore = std::numeric_limits<float>::max();
+                for (uint32_t m = memberStart[point]; m < memberStart[point + 1]; ++m) {
+                    const MeshVertex& to = mesh.vertices[global[byPosition[m]]];
+                    float toNormal[3];
+                    unpackNormal(to.packedNormal, toNormal);
+                    const float du = to.uv[0] - from.uv[0], dv = to.uv[1] - from.uv[1];
+                    const float score = du * du + dv * dv + 1.0f -
+                        (fromNormal[0] * toNormal[0] + fromNormal[1] * toNormal[1] + fromNormal[2] * toNormal[2]);
+                    if (score < bestScore) { bestScore = score; best = byPosition[m]; }
+                }
+                return best;
+            };
+
+            auto faceNormal = [](const std::array<double, 3>& a, const std::array<double, 3>& b,
+                                 const std::array<double, 3>& c) {
+                const double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                const double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                return std::array<double, 3>{ e1[1] * e2[2] - e1[2] * e2[1],
+                                              e1[2] * e2[0] - e1[0] * e2[2],
+                                              e1[0] * e2[1] - e1[1] * e2[0] };
+            };
+
+            const double maxError = subset.radius() * kLodMaxErrorFraction;
+            const double maxCost = maxError * maxError;
+            double worstCost = 0.0;
+
+            struct Collapse {
+                double   cost;
+                uint32_t from;
+                uint32_t to;
+            };
+            std::vector<Collapse> collapses;
+            std::vector<uint32_t> aroundStart, around, remap(pointCount);
+            std::vector<uint8_t> touched(pointCount);
+            // An edge's two uses: its points, then the vertex each use has at either end.
+            struct EdgeUse {
+                uint64_t points;
+                uint64_t vertices;
+                bool operator<(const EdgeUse& other) const {
+                    return points != other.points ? points < other.points : vertices < other.vertices;
+                }
+            };
+            std::vector<EdgeUse> edgeUses;
+            std::vector<uint64_t> seamEdges;
+            std::vector<uint8_t> seamEdgeCount(pointCount);
+
+            // One pass of independent collapses, aiming at @p target triangles; false when
+            // nothing more can collapse within the error limit.
+            auto collapsePass = [&](size_t target) -> bool {
+                const size_t triangleCount = cornerPoint.size() / 3;
+
+                // Triangles around each point.
+                aroundStart.assign(pointCount + 1, 0);
+                for (const uint32_t point : cornerPoint) ++aroundStart[point + 1];
+                for (size_t p = 0; p < pointCount; ++p) aroundStart[p + 1] += aroundStart[p];
+                around.resize(cornerPoint.size());
+                {
+                    std::vector<uint32_t> cursor(aroundStart.begin(), aroundStart.end() - 1);
+                    for (size_t corner = 0; corner < cornerPoint.size(); ++corner) {
+                        around[cursor[cornerPoint[corner]]++] = static_cast<uint32_t>(corner / 3);
+                    }
+                }
+
+                // Seam edges: the two triangles on them use different vertices at either end.
+                // Recounted every pass, since collapses carry vertices along the seam.
+                edgeUses.clear();
+                for (size_t t = 0; t < cornerPoint.size(); t += 3) {
+                    for (int k = 0; k < 3; ++k) {
+                        const int next = (k + 1) % 3;
+                        const bool flip = cornerPoint[t + k] > cornerPoint[t + next];
+                        const size_t lo = t + (flip ? next : k), hi = t + (flip ? k : next);
+                        edgeUses.push_back({ (static_cast<uint64_t>(cornerPoint[lo]) << 32) | cornerPoint[hi],
+                                             (static_cast<uint64_t>(cornerVertex[lo]) << 32) | cornerVertex[hi] });
+                    }
+                }
+                std::sort(edgeUses.begin(), edgeUses.end());
+                seamEdges.clear();
+                std::fill(seamEdgeCount.begin(), seamEdgeCount.end(), 0);
+                for (size_t i = 0; i < edgeUses.size();) {
+                    size_t j = i + 1;
+                    while (j < edgeUses.size() && edgeUses[j].points == edgeUses[i].points) ++j;
+                    if (j - i == 2 && edgeUses[i].vertices != edgeUses[i + 1].vertices) {
+                        seamEdges.push_back(edgeUses[i].points);
+                        for (const uint32_t point : { static_cast<uint32_t>(edgeUses[i].points >> 32),
+                                                      static_cast<uint32_t>(edgeUses[i].points) }) {
+                            seamEdgeCount[point] = static_cast<uint8_t>(std::min(seamEdgeCount[point] + 1, 3));
+                        }
+                    }
+                    i = j;
+                }
+                auto isSeamEdge = [&](uint32_t a, uint32_t b) {
+                    const uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+                    return std::binary_search(seamEdges.begin(), seamEdges.end(), key);
+                };
+
+                collapses.clear();
+                for (size_t t = 0; t < cornerPoint.size(); t += 3) {
+                    for (int k = 0; k < 3; ++k) {
+                        const uint32_t a = cornerPoint[t + k], b = cornerPoint[t + (k + 1) % 3];
+                        for (const auto& [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+                            if (kind[from] == Pinned) continue;
+                            if (kind[from] == Seam &&
+                                (kind[to] != Seam || seamEdgeCount[from] != 2 || !isSeamEdge(from, to))) continue;
+                            const double weight = quadrics[from].weight + quadrics[to].weight;
+                            if (weight <= 0.0) continue;
+                            const double cost =
+                                (quadrics[from].sum(points[to]) + quadrics[to].sum(points[to])) / weight;
+                            if (cost <= maxCost) collapses.push_back({ cost, from, to });
+                        }
+                    }
+                }
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+                    if (x.cost != y.cost) return x.cost < y.cost;
+                    return x.from != y.from ? x.from < y.from : x.to < y.to;
+                });
+
+                // Each collapse removes about two triangles.
+                const size_t goal = std::max<size_t>((triangleCount - target + 1) / 2, 1);
+                std::iota(remap.begin(), remap.end(), 0u);
+                std::fill(touched.begin(), touched.end(), 0);
+                size_t done = 0;
+                for (const Collapse& collapse : collapses) {
+                    if (touched[collapse.from] || touched[collapse.to]) continue;
+
+                    // No triangle that survives may turn over or swing almost edge-on.
+                    bool folds = false;
+                    for (uint32_t a = aroundStart[collapse.from]; a < aroundStart[collapse.from + 1] && !folds; ++a) {
+                        const uint32_t* corners = cornerPoint.data() + around[a] * 3;
+                        if (std::find(corners, corners + 3, collapse.to) != corners + 3) continue;
+                        std::array<double, 3> moved[3];
+                        for (int k = 0; k < 3; ++k) {
+                            moved[k] = points[corners[k] == collapse.from ? collapse.to : corners[k]];
+                        }
+                        const std::array<double, 3> before =
+                            faceNormal(points[corners[0]], points[corners[1]], points[corners[2]]);
+                        const std::array<double, 3> after = faceNormal(moved[0], moved[1], moved[2]);
+                        const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                        const double lengths =
+                            std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                      (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+                        folds = dot <= 0.25 * lengths;
+                    }
+                    if (folds) continue;
+
+                    remap[collapse.from] = collapse.to;
+                    quadrics[collapse.to] += quadrics[collapse.from];
+                    worstCost = std::max(worstCost, collapse.cost);
+                    // The whole neighbourhood sits out the rest of the pass: its triangles have
+                    // changed under any test made against them.
+                    for (uint32_t a = aroundStart[collapse.from]; a < aroundStart[collapse.from + 1]; ++a) {
+                        for (int k = 0; k < 3; ++k) touched[cornerPoint[around[a] * 3 + k]] = 1;
+                    }
+                    if (++done == goal) break;
+                }
+                if (done == 0) return false;
+
+                size_t written = 0;
+                for (size_t t = 0; t < cornerPoint.size(); t += 3) {
+                    uint32_t points3[3], vertices3[3];
+                    for (int k = 0; k < 3; ++k) {
+                        const uint32_t point = cornerPoint[t + k];
+                        points3[k] = remap[point];
+                        vertices3[k] = points3[k] == point ? cornerVertex[t + k]
+                                                           : closestMember(cornerVertex[t + k], points3[k]);
+                    }
+                    if (points3[0] == points3[1] || points3[1] == points3[2] || points3[0] == points3[2]) continue;
+                    std::copy_n(points3, 3, cornerPoint.data() + written);
+                    std::copy_n(vertices3, 3, cornerVertex.data() + written);
+                    written += 3;
+                }
+                cornerPoint.resize(written);
+                cornerVertex.resize(written);
+                return true;
+            };
+
+            std::vector<LodLevel> levels;
+            size_t previous = subset.indexCount / 3;
+            for (size_t level = 0; level < kLodLevels; ++level) {
+                const size_t target = previous / 2;
+                while (cornerPoint.size() / 3 > target && collapsePass(target)) {}
+
+                const size_t reached = cornerPoint.size() / 3;
+                if (reached == 0 || reached > previous * kLodMinReduction) break;
+
+                LodLevel lod;
+                lod.indices.resize(cornerVertex.size());
+                for (size_t corner = 0; corner < cornerVertex.size(); ++corner) {
+                    lod.indices[corner] = global[cornerVertex[corner]];
+                }
+                lod.error = static_cast<float>(std::sqrt(worstCost));
+                tipsify(lod.indices.data(), lod.indices.size());
+                levels.push_back(std::move(lod));
+                previous = reached;
+            }
+            return levels;
+        }
+
+        /// Coarsest grids a compact scene may use. For positions, relative to the block's own
+        /// triangles: rounding moves a vertex by at most half a step, 1/512 of a typical edge,
+        /// which reaches a pixel only once that triangle is 500 pixels across — a bound that
+        /// holds at every scale, unlike one relative to the scene. For texture coordinates, a
+        /// sixteen-thousandth of a repeat: a quarter of a texel at 4096.
+        constexpr double kCompactEdgeSteps = 256.0;
+        constexpr float kCompactUvStep = 1.0f / 16384.0f;
+
+        /**
+         * @brief The finest power-of-two grid that covers [@p lo, @p hi] in 65536 points.
+         * @param[out] origin The grid point at or below @p lo where the block's grid starts.
+         */
+        float gridStep(float lo, float hi, float& origin)
+        {
+            int exponent = 0;
+            std::frexp(std::max((hi - lo) / 65535.0f, std::numeric_limits<float>::min()), &exponent);
+            double step = std::ldexp(1.0, exponent);
+            for (;;) {
+                origin = static_cast<float>(std::floor(lo / step) * step);
+                if ((static_cast<double>(hi) - origin) / step <= 65535.0) break;
+                step *= 2.0;
+            }
+            return static_cast<float>(step);
+        }
+
+        uint16_t gridPoint(float value, float origin, float step)
+        {
+            const double steps = std::round((static_cast<double>(value) - origin) / step);
+            return static_cast<uint16_t>(std::clamp(steps, 0.0, 65535.0));
+        }
+
+        /// @brief One step for all three axes, so the grid is the same in every block that lands
+        ///        on it, whatever the block's shape.
+        float positionGridStep(const float lo[3], const float hi[3])
+        {
+            float range = 0.0f;
+            for (int axis = 0; axis < 3; ++axis) range = std::max(range, hi[axis] - lo[axis]);
+            float unusedOrigin = 0.0f, step = 0.0f;
+            for (int axis = 0; axis < 3; ++axis) {
+                step = std::max(step, gridStep(lo[axis], lo[axis] + range, unusedOrigin));
+            }
+            return step;
+        }
+
+        /// @brief What a set of vertices spans, and the edges that touch them.
+        struct VertexExtent {
+            float lo[5], hi[5];          ///< x, y, z, u, v
+            double edgeLength = 0.0;     ///< Summed over the edges of every vertex.
+            uint64_t edgeCount = 0;
+        };
+
+        /// @param edgeLength Per vertex, with @p edgeCount; both null when only the span is wanted.
+        VertexExtent measureVertices(const std::vector<MeshVertex>& vertices, const double* edgeLength,
+                                     const uint32_t* edgeCount, const uint32_t* ids, size_t count)
+        {
+            VertexExtent extent;
+            std::fill_n(extent.lo, 5, std::numeric_limits<float>::max());
+            std::fill_n(extent.hi, 5, std::numeric_limits<float>::lowest());
+            for (size_t i = 0; i < count; ++i) {
+                const MeshVertex& vertex = vertices[ids[i]];
+                const float values[5] = { vertex.position[0], vertex.position[1], vertex.position[2],
+                                          vertex.uv[0], vertex.uv[1] };
+                for (int k = 0; k < 5; ++k) {
+                    extent.lo[k] = std::min(extent.lo[k], values[k]);
+                    extent.hi[k] = std::max(extent.hi[k], values[k]);
+                }
+                if (edgeLength) {
+                    extent.edgeLength += edgeLength[ids[i]];
+                    extent.edgeCount += edgeCount[ids[i]];
+                }
+            }
+            return extent;
+        }
+
+        /**
+         * @brief Fits @p block's grids to @p extent.
+         * @return Which grid is coarser than kCompactEdgeSteps and kCompactUvStep allow: bit 0
+         *         for positions, bit 1 for texture coordinates. Vertices no triangle touches are
+         *         never drawn, and are held to no standard.
+         */
+        uint8_t fitVertexBlock(const VertexExtent& extent, VertexBlock& block)
+        {
+            block.positionStep = positionGridStep(extent.lo, extent.hi);
+            for (int axis = 0; axis < 3; ++axis) {
+                block.positionOrigin[axis] = static_cast<float>(
+                    std::floor(extent.lo[axis] / static_cast<double>(block.positionStep)) * block.positionStep);
+            }
+            float unusedOrigin = 0.0f;
+            const float uvRange = std::max(extent.hi[3] - extent.lo[3], extent.hi[4] - extent.lo[4]);
+            block.uvStep = std::max(gridStep(extent.lo[3], extent.lo[3] + uvRange, unusedOrigin),
+                                    gridStep(extent.lo[4], extent.lo[4] + uvRange, unusedOrigin));
+            for (int k = 0; k < 2; ++k) {
+                block.uvOrigin[k] = static_cast<float>(
+                    std::floor(extent.lo[3 + k] / static_cast<double>(block.uvStep)) * block.uvStep);
+            }
+
+            uint8_t coarse = 0;
+            if (extent.edgeCount == 0) return coarse;
+            if (block.positionStep > extent.edgeLength / extent.edgeCount / kCompactEdgeSteps) coarse |= 1;
+            if (block.uvStep > kCompactUvStep) coarse |= 2;
+            return coarse;
+        }
+
+        /**
+         * @brief Cuts @p ids, too spread out for one VertexBlock, into pieces that each fit one.
+         *
+         * Splits along the widest coordinate of whichever grid falls further short, so a piece
+         * gathers vertices that are near each other in space, or in texture space. A single
+         * vertex always fits.
+         */
+        void splitVertexBlock(const std::vector<MeshVertex>& vertices, const double* edgeLength,
+                              const uint32_t* edgeCount, uint32_t* ids, size_t count,
+                              std::vector<std::vector<uint32_t>>& pieces)
+        {
+            const VertexExtent extent = measureVertices(vertices, edgeLength, edgeCount, ids, count);
+            VertexBlock block;
+            const uint8_t coarse = fitVertexBlock(extent, block);
+            if (coarse == 0 || count == 1) {
+                pieces.emplace_back(ids, ids + count);
+                return;
+            }
+
+            const double positionShortfall = (coarse & 1)
+                ? block.positionStep / (extent.edgeLength / extent.edgeCount / kCompactEdgeSteps) : 0.0;
+            const double uvShortfall = (coarse & 2) ? block.uvStep / kCompactUvStep : 0.0;
+            const int first = positionShortfall >= uvShortfall ? 0 : 3;
+            const int last = first == 0 ? 3 : 5;
+            int key = first;
+            for (int k = first + 1; k < last; ++k) {
+                if (extent.hi[k] - extent.lo[k] > extent.hi[key] - extent.lo[key]) key = k;
+            }
+            auto value = [&](uint32_t id) {
+                const MeshVertex& vertex = vertices[id];
+                return key < 3 ? vertex.position[key] : vertex.uv[key - 3];
+            };
+
+            // At the widest gap rather than the median: a block is usually a few far-apart
+            // clumps, or one clump and a stray, and each should come out as one piece.
+            std::sort(ids, ids + count, [&](uint32_t a, uint32_t b) { return value(a) < value(b); });
+            size_t half = count / 2;
+            float widest = -1.0f;
+            for (size_t i = 1; i < count; ++i) {
+                const float gap = value(ids[i]) - value(ids[i - 1]);
+                if (gap > widest) { widest = gap; half = i; }
+            }
+            splitVertexBlock(vertices, edgeLength, edgeCount, ids, half, pieces);
+            splitVertexBlock(vertices, edgeLength, edgeCount, ids + half, count - half, pieces);
+        }
+
+        /// Largest index a 16-bit subset may use relative to its base. One short of 0xFFFF,
+        /// which both APIs reserve as the primitive-restart marker: it is off here, but a scene
+        /// that happened to need it would then depend on a pipeline setting.
+        constexpr uint32_t kMaxIndex16 = 0xFFFE;
+
+        /// How far a copy's vertex may land from where the fitted transform puts it, relative to
+        /// the size of the shape. Copies an exporter wrote out agree to float rounding, around
+        /// 1e-7; this is far looser than that and still far below anything visible.
+        constexpr double kInstanceTolerance = 1e-4;
+        /// Smallest cosine between a copy's normal and the transformed original's. Packed
+        /// normals round to about 1e-4 radians, so copies pass easily and a bent copy does not.
+        constexpr double kInstanceNormalCos = 0.9995;
+        /// Different shapes tried per hash before giving up on a subset. Hashes collide for
+        /// shapes with the same triangles and texture coordinates — every unit quad in a scene
+        /// has the same ones — and without a limit the search would be quadratic in them.
+        constexpr size_t kInstanceMaxShapes = 16;
+
+        /**
+         * @struct ShapeFrame
+         * @brief Three vertices of a shape that pin down its orientation, found once per shape.
+         *
+         * The centroid, the vertex farthest from it, and the vertex farthest from the line
+         * through those two. The same three, by local number, in a copy give the copy's frame,
+         * and the two frames give the transform.
+         */
+        struct ShapeFrame {
+            std::array<double, 3> centroid{ 0.0, 0.0, 0.0 };
+            uint32_t far = 0;
+            uint32_t side = 0;
+            double   size = 0.0;   ///< Distance from the centroid to `far`.
+        };
+
+        using Point = std::array<double, 3>;
+
+        Point offset(const float* p, const Point& origin)
+        {
+            return { p[0] - origin[0], p[1] - origin[1], p[2] - origin[2] };
+        }
+        double dot3(const Point& a, const Point& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+        Point cross3(const Point& a, const Point& b)
+        {
+            return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        }
+        Point normalized(const Point& a)
+        {
+            const double length = std::sqrt(dot3(a, a));
+            return { a[0] / length, a[1] / length, a[2] / length };
+        }
+
+        Point centroidOf(const Mesh& mesh, const std::vector<uint32_t>& vertices)
+        {
+            Point sum{ 0.0, 0.0, 0.0 };
+            for (const uint32_t v : vertices) {
+                for (int axis = 0; axis < 3; ++axis) sum[axis] += mesh.vertices[v].position[axis];
+            }
+            for (double& value : sum) value /= static_cast<double>(vertices.size());
+            return sum;
+        }
+
+        /// @return false for a shape with no orientation to find: a point or a line.
+        bool findFrame(const Mesh& mesh, const std::vector<uint32_t>& vertices, ShapeFrame& frame)
+        {
+            frame.centroid = centroidOf(mesh, vertices);
+            double best = 0.0;
+            for (uint32_t k = 0; k < vertices.size(); ++k) {
+                const Point d = offset(mesh.vertices[vertices[k]].position, frame.centroid);
+                if (dot3(d, d) > best) { best = dot3(d, d); frame.far = k; }
+            }
+            frame.size = std::sqrt(best);
+            if (frame.size <= 0.0) return false;
+
+            const Point axis = normalized(offset(mesh.vertices[vertices[frame.far]].position, frame.centroid));
+            best = 0.0;
+            for (uint32_t k = 0; k < vertices.size(); ++k) {
+                const Point off = cross3(axis, offset(mesh.vertices[vertices[k]].position, frame.centroid));
+                if (dot3(off, off) > best) { best = dot3(off, off); frame.side = k; }
+            }
+            // Too thin to say which way it faces, at the precision the copies are checked to.
+            return std::sqrt(best) > frame.size * kInstanceTolerance * 10.0;
+        }
+
+        /// @brief Orthonormal right-handed basis from a centroid and two points.
+        void frameBasis(const Point& centroid, const float* far, const float* side, Point basis[3])
+        {
+            basis[0] = normalized(offset(far, centroid));
+            const Point toSide = offset(side, centroid);
+            const double along = dot3(basis[0], toSide);
+            basis[1] = normalized({ toSide[0] - basis[0][0] * along, toSide[1] - basis[0][1] * along,
+                                    toSide[2] - basis[0][2] * along });
+            basis[2] = cross3(basis[0], basis[1]);
+        }
+
+        /// @brief @p subset's triangles over its vertices' first-use numbers, which @p local lists.
+        std::vector<uint32_t> localTriangles(const Mesh& mesh, const MeshSubset& subset,
+                                             const std::vector<uint32_t>& local)
+        {
+            std::unordered_map<uint32_t, uint32_t> number;
+            number.reserve(local.size());
+            for (uint32_t k = 0; k < local.size(); ++k) number.emplace(local[k], k);
+            std::vector<uint32_t> triangles(subset.indexCount);
+            for (uint32_t i = 0; i < subset.indexCount; ++i) {
+                triangles[i] = number[mesh.indices[subset.firstIndex + i]];
+            }
+            return triangles;
+        }
+
+        /**
+         * @brief Whether @p copy has exactly the material, triangles and texture coordinates of
+         *        @p shape, vertex k of one standing for vertex k of the other.
+         *
+         * The hash only says two subsets are worth comparing; a collision must not turn one into
+         * a copy of a different shape. @p shapeTriangles is localTriangles() of the shape.
+         */
+        bool sameShape(const Mesh& mesh, const MeshSubset& shape, const std::vector<uint32_t>& shapeLocal,
+                       const std::vector<uint32_t>& shapeTriangles, const MeshSubset& copy,
+                       const std::vector<uint32_t>& copyLocal)
+        {
+            if (copy.materialIndex != shape.materialIndex || copy.indexCount != shape.indexCount ||
+                copyLocal.size() != shapeLocal.size()) {
+                return false;
+            }
+            // copyLocal lists distinct vertices, so this holds exactly when the copy's first-use
+            // numbering of its triangles is the shape's.
+            for (uint32_t i = 0; i < copy.indexCount; ++i) {
+                if (mesh.indices[copy.firstIndex + i] != copyLocal[shapeTriangles[i]]) return false;
+            }
+            for (size_t k = 0; k < shapeLocal.size(); ++k) {
+                if (std::memcmp(mesh.vertices[shapeLocal[k]].uv, mesh.vertices[copyLocal[k]].uv,
+                                sizeof(MeshVertex::uv)) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Finds the transform that carries @p shape onto @p copy, if there is one.
+         *
+         * Both vertex lists are in first-use order, and sameShape() has established that vertex
+         * k of one corresponds to vertex k of the other. The transform is fitted from the frame's three
+         * points and then checked against every vertex and normal; a copy that is mirrored,
+         * sheared or slightly different fails the check.
+         */
+        bool fitInstance(const Mesh& mesh, const std::vector<uint32_t>& shape, const ShapeFrame& frame,
+                         const std::vector<uint32_t>& copy, MeshInstance& instance)
+        {
+            const Point centroid = centroidOf(mesh, copy);
+            const float* copyFar = mesh.vertices[copy[frame.far]].position;
+            const double copySize = std::sqrt(dot3(offset(copyFar, centroid), offset(copyFar, centroid)));
+            const double scale = copySize / frame.size;
+            if (!(scale > 0.0)) return false;
+
+            Point from[3], to[3];
+            frameBasis(frame.centroid, mesh.vertices[shape[frame.far]].position,
+                       mesh.vertices[shape[frame.side]].position, from);
+            frameBasis(centroid, copyFar, mesh.vertices[copy[frame.side]].position, to);
+
+            // rotation = to * transpose(from); the rows of the placed matrix are scale * rotation
+            // followed by the translation that takes one centroid to the other.
+            double m[3][4];
+            for (int row = 0; row < 3; ++row) {
+                for (int column = 0; column < 3; ++column) {
+                    double r = 0.0;
+                    for (int k = 0; k < 3; ++k) {
+                        r += to[k][row] * from[k][column];
+                    }
+                    m[row][column] = r * scale;
+                }
+                m[row][3] = centroid[row] - (m[row][0] * frame.centroid[0] +
+                                             m[row][1] * frame.centroid[1] +
+                                             m[row][2] * frame.centroid[2]);
+            }
+
+            const double tolerance = copySize * kInstanceTolerance;
+            for (size_t k = 0; k < shape.size(); ++k) {
+                const MeshVertex& a = mesh.vertices[shape[k]];
+                const MeshVertex& b = mesh.vertices[copy[k]];
+                double error = 0.0;
+                for (int row = 0; row < 3; ++row) {
+                    const double placed = m[row][0] * a.position[0] + m[row][1] * a.position[1] +
+                                          m[row][2] * a.position[2] + m[row][3];
+                    error += (placed - b.position[row]) * (placed - b.position[row]);
+                }
+                // Plus the rounding of the copy's own coordinates, which far from the origin is
+                // coarser than the tolerance of a small prop.
+                const double slack = tolerance + 1e-6 * (std::abs(b.position[0]) + std::abs(b.position[1]) +
+                                                         std::abs(b.position[2]));
+                if (error > slack * slack) return false;
+
+                float na[3], nb[3];
+                unpackNormal(a.packedNormal, na);
+                unpackNormal(b.packedNormal, nb);
+                double cosine = 0.0;
+                for (int row = 0; row < 3; ++row) {
+                    cosine += (m[row][0] * na[0] + m[row][1] * na[1] + m[row][2] * na[2]) / scale * nb[row];
+                }
+                if (cosine < kInstanceNormalCos) return false;
+            }
+
+            for (int row = 0; row < 3; ++row) {
+                for (int column = 0; column < 4; ++column) {
+                    instance.transform[row * 4 + column] = static_cast<float>(m[row][column]);
+                }
+            }
+            instance.scale = static_cast<float>(scale);
+            return true;
+        }
+
+    } // namespace
+
+    uint32_t enabledLoadPasses()
+    {
+        uint32_t passes = 0;
+        if (!std::getenv("DMRENDER_NOSPLIT"))   passes |= LoadPassSplitSubsets;
+        if (subsetMergeTriangles() > 0)         passes |= LoadPassMergeSubsets;
+        if (!std::getenv("DMRENDER_NOREORDER")) passes |= LoadPassVertexOrder;
+        if (!std::getenv("DMRENDER_NOCLUSTERS")) passes |= LoadPassClusters;
+        if (!std::getenv("DMRENDER_NOLOD"))     passes |= LoadPassLods;
+        if (std::getenv("DMRENDER_COMPACT_VERTICES")) passes |= LoadPassCompactVertices;
+        if (!std::getenv("DMRENDER_NOINDEX16")) passes |= LoadPassIndex16;
+        if (!std::getenv("DMRENDER_NOINSTANCES")) passes |= LoadPassInstances;
+        return passes;
+    }
+
+    uint32_t subsetMergeTriangles()
+    {
+        const char* text = std::getenv("DMRENDER_MERGE_TRIANGLES");
+        if (!text) return kDefaultMergeTriangles;
+        const long value = std::strtol(text, nullptr, 10);
+        return value > 0 ? static_cast<uint32_t>(std::min<long>(value, 1L << 24)) : 0;
+    }
+
+    void findInstances(Mesh& mesh)
+    {
+        mesh.loadPasses |= LoadPassInstances;
+        const auto start = std::chrono::steady_clock::now();
+        const size_t subsetCount = mesh.subsets.size();
+
+        // Each subset's vertices in the order its triangles first use them, and a hash of what a
+        // rigid motion leaves alone: the material, the triangles over those local numbers, and
+        // the texture coordinates.
+        std::vector<std::vector<uint32_t>> local(subsetCount);
+        std::vector<uint64_t> hash(subsetCount, 0);
+        parallelFor(subsetCount, [&](size_t s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            if (subset.indexCount == 0) return;
+            uint64_t h = 1469598103934665603ull;
+            auto mix = [&h](uint64_t value) { h ^= value; h *= 1099511628211ull; };
+            mix(static_cast<uint32_t>(subset.materialIndex));
+            mix(subset.indexCount);
+
+            std::unordered_map<uint32_t, uint32_t> number;
+            number.reserve(subset.indexCount);
+            for (uint32_t i = 0; i < subset.indexCount; ++i) {
+                const uint32_t index = mesh.indices[subset.firstIndex + i];
+                const auto [it, added] = number.try_emplace(index, static_cast<uint32_t>(local[s].size()));
+                if (added) local[s].push_back(index);
+                mix(it->second);
+            }
+            for (const uint32_t v : local[s]) {
+                uint32_t bits[2];
+                std::memcpy(bits, mesh.vertices[v].uv, sizeof(bits));
+                mix(bits[0]);
+                mix(bits[1]);
+            }
+            hash[s] = h;
+        });
+
+        // Subsets of one hash are consecutive once sorted, and each run is searched on its own.
+        std::vector<uint32_t> order;
+        for (uint32_t s = 0; s < subsetCount; ++s) {
+            if (!local[s].empty()) order.push_back(s);
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return hash[a] != hash[b] ? hash[a] < hash[b] : a < b;
+        });
+        std::vector<std::pair<size_t, size_t>> runs;
+        for (size_t i = 0; i < order.size();) {
+            size_t j = i + 1;
+            while (j < order.size() && hash[order[j]] == hash[order[i]]) ++j;
+            if (j - i > 1) runs.emplace_back(i, j);
+            i = j;
+        }
+
+        // Within a run each subset is tried against the shapes found so far, and becomes a new
+        // one if none fits. The lowest-numbered subset of a shape is its original.
+        std::vector<uint32_t> shapeOf(subsetCount);
+        std::iota(shapeOf.begin(), shapeOf.end(), 0u);
+        std::vector<MeshInstance> placement(subsetCount);
+        struct Shape {
+            uint32_t              subset;
+            ShapeFrame            frame;
+            std::vector<uint32_t> triangles;   ///< localTriangles() of the subset.
+        };
+        parallelFor(runs.size(), [&](size_t r) {
+            std::vector<Shape> shapes;
+            for (size_t i = runs[r].first; i < runs[r].second; ++i) {
+                const uint32_t s = order[i];
+                bool placed = false;
+                for (const Shape& shape : shapes) {
+                    if (sameShape(mesh, mesh.subsets[shape.subset], local[shape.subset], shape.triangles,
+                                  mesh.subsets[s], local[s]) &&
+                        fitInstance(mesh, local[shape.subset], shape.frame, local[s], placement[s])) {
+                        shapeOf[s] = shape.subset;
+                        placed = true;
+                        break;
+                    }
+                }
+                ShapeFrame frame;
+                if (!placed && shapes.size() < kInstanceMaxShapes && findFrame(mesh, local[s], frame)) {
+                    shapes.push_back({ s, frame, localTriangles(mesh, mesh.subsets[s], local[s]) });
+                }
+            }
+        });
+
+        std::vector<std::vector<uint32_t>> copies(subsetCount);
+        for (uint32_t s = 0; s < subsetCount; ++s) {
+            if (shapeOf[s] != s) copies[shapeOf[s]].push_back(s);
+        }
+        size_t copyCount = 0;
+        for (const std::vector<uint32_t>& list : copies) copyCount += list.size();
+        if (copyCount == 0) return;
+
+        // The original keeps its geometry, so its own instance is the identity. The copies of
+        // one shape are put in Morton order of where they stand: the renderer draws runs of
+        // consecutive visible instances, and neighbours tend to be visible together.
+        mesh.instances.clear();
+        std::vector<MeshSubset> subsets;
+        std::vector<uint32_t> indices;
+        indices.reserve(mesh.indices.size());
+        size_t shapeCount = 0;
+        for (uint32_t s = 0; s < subsetCount; ++s) {
+            if (shapeOf[s] != s) continue;
+            MeshSubset subset = mesh.subsets[s];
+            const uint32_t first = static_cast<uint32_t>(indices.size());
+            indices.insert(indices.end(), mesh.indices.begin() + subset.firstIndex,
+                           mesh.indices.begin() + subset.firstIndex + subset.indexCount);
+            subset.firstIndex = first;
+
+            if (!copies[s].empty()) {
+                std::vector<MeshInstance> placed(1);
+                for (const uint32_t c : copies[s]) placed.push_back(placement[c]);
+
+                const Point origin = centroidOf(mesh, local[s]);
+                const float shapeCenter[3] = { static_cast<float>(origin[0]), static_cast<float>(origin[1]),
+                                               static_cast<float>(origin[2]) };
+                std::vector<std::array<float, 3>> centers(placed.size());
+                float lo[3] = {  1e30f,  1e30f,  1e30f };
+                float hi[3] = { -1e30f, -1e30f, -1e30f };
+                for (size_t k = 0; k < placed.size(); ++k) {
+                    placed[k].apply(shapeCenter, centers[k].data());
+                    for (int axis = 0; axis < 3; ++axis) {
+                        lo[axis] = std::min(lo[axis], centers[k][axis]);
+                        hi[axis] = std::max(hi[axis], centers[k][axis]);
+                    }
+                }
+                std::vector<std::pair<uint32_t, uint32_t>> codes(placed.size());
+                for (uint32_t k = 0; k < placed.size(); ++k) {
+                    uint32_t code = 0;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        const float range = hi[axis] - lo[axis];
+                        const float t = range > 0.0f ? (centers[k][axis] - lo[axis]) / range : 0.0f;
+                        const uint32_t cell = static_cast<uint32_t>(std::clamp(t, 0.0f, 1.0f) * 1023.0f);
+                        for (int bit = 0; bit < 10; ++bit) code |= ((cell >> bit) & 1u) << (bit * 3 + axis);
+                    }
+                    codes[k] = { code, k };
+                }
+                std::sort(codes.begin(), codes.end());
+
+                subset.firstInstance = static_cast<uint32_t>(mesh.instances.size());
+                subset.instanceCount = static_cast<uint32_t>(placed.size());
+                for (const auto& [code, k] : codes) mesh.instances.push_back(placed[k]);
+                ++shapeCount;
+            }
+            subsets.push_back(subset);
+        }
+
+        // Drop the vertices only the copies used, keeping the rest in their order.
+        std::vector<uint32_t> remap(mesh.vertices.size(), std::numeric_limits<uint32_t>::max());
+        for (const uint32_t index : indices) remap[index] = 0;
+        uint32_t kept = 0;
+        for (uint32_t& slot : remap) {
+            if (slot == 0) slot = kept++;
+        }
+        std::vector<MeshVertex> vertices(kept);
+        for (size_t v = 0; v < mesh.vertices.size(); ++v) {
+            if (remap[v] != std::numeric_limits<uint32_t>::max()) vertices[remap[v]] = mesh.vertices[v];
+        }
+        for (uint32_t& index : indices) index = remap[index];
+
+        const size_t before = mesh.vertices.size() * sizeof(MeshVertex) + mesh.indices.size() * sizeof(uint32_t);
+        const size_t verticesBefore = mesh.vertices.size();
+        mesh.vertices = std::move(vertices);
+        mesh.indices = std::move(indices);
+        mesh.subsets = std::move(subsets);
+        const size_t after = mesh.vertices.size() * sizeof(MeshVertex) + mesh.indices.size() * sizeof(uint32_t);
+
+        std::fprintf(stderr, "  instances: %zu copies of %zu shapes; vertices %zu -> %zu, "
+                     "%.1f MB -> %.1f MB of geometry, %zu subsets left to draw in %.2f s\n",
+                     copyCount + shapeCount, shapeCount, verticesBefore, mesh.vertices.size(),
+                     before / 1e6, after / 1e6, mesh.subsets.size(),
+                     std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void splitLargeSubsets(Mesh& mesh)
+    {
+        // The extent limit is relative to the whole scene: a piece an eighth of the scene across
+        // is out of view often enough to be worth its own bounds, whatever the scene's scale.
+        float lo[3] = {  1e30f,  1e30f,  1e30f };
+        float hi[3] = { -1e30f, -1e30f, -1e30f };
+        for (const MeshVertex& vertex : mesh.vertices) {
+            for (int axis = 0; axis < 3; ++axis) {
+                lo[axis] = std::min(lo[axis], vertex.position[axis]);
+                hi[axis] = std::max(hi[axis], vertex.position[axis]);
+            }
+        }
+        const float sceneExtent = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 0.0f });
+        const float maxExtent = sceneExtent * kMaxExtentFraction;
+
+        std::vector<std::vector<MeshSubset>> pieces(mesh.subsets.size());
+        parallelFor(mesh.subsets.size(), [&](size_t s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            if (subset.indexCount / 3 <= kSplitMinTriangles || subset.instanceCount > 0) return;
+            pieces[s] = splitSubset(mesh, subset, maxExtent, mesh.indices.data() + subset.firstIndex);
+        });
+
+        const size_t before = mesh.subsets.size();
+        std::vector<MeshSubset> subsets;
+        for (size_t s = 0; s < mesh.subsets.size(); ++s) {
+            if (pieces[s].empty()) subsets.push_back(mesh.subsets[s]);
+            else subsets.insert(subsets.end(), pieces[s].begin(), pieces[s].end());
+        }
+        mesh.subsets = std::move(subsets);
+        mesh.loadPasses |= LoadPassSplitSubsets;
+
+        if (mesh.subsets.size() != before) {
+            std::fprintf(stderr, "  split: %zu subsets -> %zu\n", before, mesh.subsets.size());
+        }
+    }
+
+    void mergeSmallSubsets(Mesh& mesh)
+    {
+        const uint32_t budget = subsetMergeTriangles();
+        if (budget == 0) return;
+        mesh.loadPasses |= LoadPassMergeSubsets;
+        if (mesh.subsets.size() < 2) return;
+
+        float sceneExtent = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            sceneExtent = std::max(sceneExtent, mesh.boundsMax[axis] - mesh.boundsMin[axis]);
+        }
+        const float maxExtent = sceneExtent * kMaxExtentFraction;
+
+        // Candidates in Morton order of their centres, grouped by material: walking the list,
+        // consecutive entries of one material are close in space, so greedily absorbing the next
+        // one while it fits yields compact clusters without any search.
+        auto morton = [&](const MeshSubset& subset) -> uint32_t {
+            const std::array<float, 3> center = subset.center();
+            uint32_t code = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                const float range = mesh.boundsMax[axis] - mesh.boundsMin[axis];
+                const float t = range > 0.0f ? (center[axis] - mesh.boundsMin[axis]) / range : 0.0f;
+                const uint32_t cell = static_cast<uint32_t>(std::clamp(t, 0.0f, 1.0f) * 1023.0f);
+                for (int bit = 0; bit < 10; ++bit) code |= ((cell >> bit) & 1u) << (bit * 3 + axis);
+            }
+            return code;
+        };
+        struct Candidate {
+            int32_t  materialIndex;
+            uint32_t code;
+            uint32_t subset;
+        };
+        // Transparent subsets are sorted back-to-front one by one when drawn; a merged run of
+        // them would be blended as a single item, in whatever order its triangles happen to lie.
+        auto transparent = [&](const MeshSubset& subset) {
+            return subset.materialIndex >= 0
+                && static_cast<size_t>(subset.materialIndex) < mesh.materials.size()
+                && mesh.materials[subset.materialIndex].blendMode == MaterialBlendMode::Transparent;
+        };
+        std::vector<Candidate> candidates;
+        for (uint32_t s = 0; s < mesh.subsets.size(); ++s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            if (subset.indexCount == 0 || subset.indexCount / 3 >= budget || subset.instanceCount > 0) continue;
+            if (transparent(subset)) continue;
+            candidates.push_back({ subset.materialIndex, morton(subset), s });
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            if (a.materialIndex != b.materialIndex) return a.materialIndex < b.materialIndex;
+            if (a.code != b.code) return a.code < b.code;
+            return a.subset < b.subset;
+        });
+
+        // Every subset starts as its own cluster, led by itself.
+        std::vector<uint32_t> leader(mesh.subsets.size());
+        for (uint32_t s = 0; s < leader.size(); ++s) leader[s] = s;
+        std::vector<MeshSubset> merged = mesh.subsets;
+
+        for (size_t i = 0; i < candidates.size();) {
+            const uint32_t first = candidates[i].subset;
+            MeshSubset& cluster = merged[first];
+            size_t j = i + 1;
+            for (; j < candidates.size() && candidates[j].materialIndex == candidates[i].materialIndex; ++j) {
+                const MeshSubset& next = mesh.subsets[candidates[j].subset];
+                if ((cluster.indexCount + next.indexCount) / 3 > budget) break;
+                float lo[3], hi[3];
+                float extent = 0.0f;
+                for (int axis = 0; axis < 3; ++axis) {
+                    lo[axis] = std::min(cluster.boundsMin[axis], next.boundsMin[axis]);
+                    hi[axis] = std::max(cluster.boundsMax[axis], next.boundsMax[axis]);
+                    extent = std::max(extent, hi[axis] - lo[axis]);
+                }
+                if (extent > maxExtent) break;
+
+                std::copy_n(lo, 3, cluster.boundsMin);
+                std::copy_n(hi, 3, cluster.boundsMax);
+                cluster.indexCount += next.indexCount;
+                leader[candidates[j].subset] = first;
+            }
+            i = j;
+        }
+
+        // A cluster's index ranges are scattered through the buffer; gather each into one run,
+        // placed where its leader stood in the original order. The leader is the cluster's first
+        // member in Morton order, not necessarily the first in the buffer.
+        std::vector<std::vector<uint32_t>> members(mesh.subsets.size());
+        for (uint32_t s = 0; s < mesh.subsets.size(); ++s) members[leader[s]].push_back(s);
+
+        std::vector<uint32_t> indices(mesh.indices.size());
+        std::vector<MeshSubset> subsets;
+        uint32_t written = 0;
+        for (uint32_t s = 0; s < mesh.subsets.size(); ++s) {
+            if (leader[s] != s) continue;
+            MeshSubset subset = merged[s];
+            subset.firstIndex = written;
+            for (const uint32_t member : members[s]) {
+                const MeshSubset& source = mesh.subsets[member];
+                std::copy_n(mesh.indices.data() + source.firstIndex, source.indexCount, indices.data() + written);
+                written += source.indexCount;
+            }
+            subsets.push_back(subset);
+        }
+        // Indices no subset referred to are dropped; nothing could have drawn them anyway.
+        indices.resize(written);
+
+        const size_t before = mesh.subsets.size();
+        mesh.indices = std::move(indices);
+        mesh.subsets = std::move(subsets);
+
+        if (mesh.subsets.size() != before) {
+            std::fprintf(stderr, "  merge: %zu subsets -> %zu (at most %u triangles each)\n",
+                         before, mesh.subsets.size(), budget);
+        }
+    }
+
+    void optimizeVertexOrder(Mesh& mesh)
+    {
+        if (mesh.indices.empty()) return;
+        const auto start = std::chrono::steady_clock::now();
+        const CacheStats before = simulateCache(mesh.indices, mesh.vertices.size());
+
+        // ── Triangle order, per subset ──
+        parallelFor(mesh.subsets.size(), [&](size_t s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            tipsify(mesh.indices.data() + subset.firstIndex, subset.indexCount);
+        });
+
+        // ── Vertex order: first use by the new index stream ──
+        constexpr uint32_t kUnseen = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(mesh.vertices.size(), kUnseen);
+        uint32_t next = 0;
+        for (const uint32_t index : mesh.indices) {
+            if (remap[index] == kUnseen) remap[index] = next++;
+        }
+        // Vertices no triangle uses keep their relative order at the end.
+        for (uint32_t& slot : remap) {
+            if (slot == kUnseen) slot = next++;
+        }
+
+        std::vector<MeshVertex> reordered(mesh.vertices.size());
+        for (size_t v = 0; v < mesh.vertices.size(); ++v) reordered[remap[v]] = mesh.vertices[v];
+        mesh.vertices = std::move(reordered);
+
+        constexpr size_t kPieceIndices = size_t(1) << 18;
+        parallelFor((mesh.indices.size() + kPieceIndices - 1) / kPieceIndices, [&](size_t p) {
+            const size_t end = std::min(mesh.indices.size(), (p + 1) * kPieceIndices);
+            for (size_t i = p * kPieceIndices; i < end; ++i) mesh.indices[i] = remap[mesh.indices[i]];
+        });
+        mesh.loadPasses |= LoadPassVertexOrder;
+
+        const CacheStats after = simulateCache(mesh.indices, mesh.vertices.size());
+        std::fprintf(stderr, "  order: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %u) in %.2f s\n",
+                     before.acmr, after.acmr, before.atvr, after.atvr, kCacheSize,
+                     std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void buildClusters(Mesh& mesh)
+    {
+        // Cut each subset greedily: a cluster takes triangles in order until the next one would
+        // bring a 65th vertex or a 125th triangle.
+        std::vector<std::vector<MeshCluster>> perSubset(mesh.subsets.size());
+        parallelFor(mesh.subsets.size(), [&](size_t s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            std::vector<MeshCluster>& clusters = perSubset[s];
+            uint32_t vertices[kClusterVertices];
+            size_t vertexCount = 0;
+
+            MeshCluster current;
+            current.firstIndex = subset.firstIndex;
+            for (uint32_t t = 0; t + 2 < subset.indexCount; t += 3) {
+                const uint32_t* corners = mesh.indices.data() + subset.firstIndex + t;
+                size_t added = 0;
+                for (int c = 0; c < 3; ++c) {
+                    if (std::find(vertices, vertices + vertexCount, corners[c]) == vertices + vertexCount &&
+                        std::find(corners, corners + c, corners[c]) == corners + c) ++added;
+                }
+                if (vertexCount + added > kClusterVertices || current.indexCount / 3 == kClusterTriangles) {
+                    clusters.push_back(current);
+                    current = MeshCluster{};
+                    current.firstIndex = subset.firstIndex + t;
+                    vertexCount = 0;
+                }
+                for (int c = 0; c < 3; ++c) {
+                    if (std::find(vertices, vertices + vertexCount, corners[c]) == vertices + vertexCount) {
+                        vertices[vertexCount++] = corners[c];
+                    }
+                }
+                current.indexCount += 3;
+            }
+            if (current.indexCount > 0) clusters.push_back(current);
+            for (MeshCluster& cluster : clusters) fitCluster(mesh, cluster);
+        });
+
+        mesh.clusters.clear();
+        size_t coneCount = 0;
+        for (size_t s = 0; s < mesh.subsets.size(); ++s) {
+            mesh.subsets[s].firstCluster = static_cast<uint32_t>(mesh.clusters.size());
+            mesh.subsets[s].clusterCount = static_cast<uint32_t>(perSubset[s].size());
+            for (const MeshCluster& cluster : perSubset[s]) coneCount += cluster.coneCutoff < 1.0f;
+            mesh.clusters.insert(mesh.clusters.end(), perSubset[s].begin(), perSubset[s].end());
+        }
+        mesh.loadPasses |= LoadPassClusters;
+
+        std::fprintf(stderr, "  clusters: %zu, %.1f triangles each, %.0f%% with a usable normal cone\n",
+                     mesh.clusters.size(),
+                     mesh.clusters.empty() ? 0.0 : mesh.indices.size() / 3.0 / mesh.clusters.size(),
+                     mesh.clusters.empty() ? 0.0 : 100.0 * coneCount / mesh.clusters.size());
+    }
+
+    void buildLods(Mesh& mesh)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<LodLevel>> perSubset(mesh.subsets.size());
+        parallelFor(mesh.subsets.size(), [&](size_t s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            if (subset.indexCount / 3 < kLodMinTriangles) return;
+            perSubset[s] = simplifySubset(mesh, subset);
+        });
+
+        mesh.lods.clear();
+        size_t lodIndices = 0;
+        for (const std::vector<LodLevel>& levels : perSubset) {
+            for (const LodLevel& level : levels) lodIndices += level.indices.size();
+        }
+        mesh.indices.reserve(mesh.indices.size() + lodIndices);
+
+        size_t simplified = 0;
+        size_t coarsest = 0;
+        for (size_t s = 0; s < mesh.subsets.size(); ++s) {
+            MeshSubset& subset = mesh.subsets[s];
+            subset.firstLod = static_cast<uint32_t>(mesh.lods.size());
+            subset.lodCount = static_cast<uint32_t>(perSubset[s].size());
+            for (const LodLevel& level : perSubset[s]) {
+                MeshLod lod;
+                lod.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+                lod.indexCount = static_cast<uint32_t>(level.indices.size());
+                lod.error = level.error;
+                mesh.indices.insert(mesh.indices.end(), level.indices.begin(), level.indices.end());
+                mesh.lods.push_back(lod);
+            }
+            if (!perSubset[s].empty()) {
+                ++simplified;
+                coarsest += perSubset[s].back().indices.size() / 3 * std::max<uint32_t>(subset.instanceCount, 1);
+            } else {
+                coarsest += subset.indexCount / 3 * std::max<uint32_t>(subset.instanceCount, 1);
+            }
+        }
+        mesh.loadPasses |= LoadPassLods;
+
+        std::fprintf(stderr, "  lod: %zu of %zu subsets simplified, %zu levels, coarsest %.1f%% of the triangles, "
+                     "+%.1f MB of indices in %.2f s\n",
+                     simplified, mesh.subsets.size(), mesh.lods.size(),
+                     100.0 * coarsest / std::max<size_t>(mesh.triangleCount(), 1),
+                     lodIndices * sizeof(uint32_t) / 1e6,
+                     std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void buildCompactVertices(Mesh& mesh)
+    {
+        mesh.loadPasses |= LoadPassCompactVertices;
+        mesh.compactVertices.clear();
+        mesh.vertexBlocks.clear();
+        if (mesh.vertices.empty()) return;
+
+        const size_t vertexCount = mesh.vertices.size();
+        const size_t blockCount = (vertexCount + kVertexBlockSize - 1) >> kVertexBlockShift;
+
+        // Summed length of the edges touching each vertex, for the mean over any set of them.
+        std::vector<double> edgeLength(vertexCount, 0.0);
+        std::vector<uint32_t> edgeCount(vertexCount, 0);
+        for (const MeshSubset& subset : mesh.subsets) {
+            const uint32_t* indices = mesh.indices.data() + subset.firstIndex;
+            for (uint32_t t = 0; t + 2 < subset.indexCount; t += 3) {
+                for (int k = 0; k < 3; ++k) {
+                    const uint32_t a = indices[t + k], b = indices[t + (k + 1) % 3];
+                    const float* pa = mesh.vertices[a].position;
+                    const float* pb = mesh.vertices[b].position;
+                    const double length = std::sqrt(double(pa[0] - pb[0]) * (pa[0] - pb[0]) +
+                                                    double(pa[1] - pb[1]) * (pa[1] - pb[1]) +
+                                                    double(pa[2] - pb[2]) * (pa[2] - pb[2]));
+                    for (const uint32_t vertex : { a, b }) {
+                        edgeLength[vertex] += length;
+                        ++edgeCount[vertex];
+                    }
+                }
+            }
+        }
+
+        // ── Layout. A block too spread out for one grid — pieces far apart that the vertex order
+        // happened to put together — is cut into pieces that are not, each padded to a block of
+        // its own with copies of its first vertex. Every other block stays where it is ──
+        std::vector<std::vector<std::vector<uint32_t>>> pieces(blockCount);
+        parallelFor(blockCount, [&](size_t b) {
+            const size_t begin = b << kVertexBlockShift;
+            const size_t end = std::min(vertexCount, begin + kVertexBlockSize);
+            std::vector<uint32_t> ids(end - begin);
+            std::iota(ids.begin(), ids.end(), static_cast<uint32_t>(begin));
+            VertexBlock block;
+            if (fitVertexBlock(measureVertices(mesh.vertices, edgeLength.data(), edgeCount.data(),
+                                               ids.data(), ids.size()), block) == 0) return;
+            splitVertexBlock(mesh.vertices, edgeLength.data(), edgeCount.data(), ids.data(), ids.size(),
+                             pieces[b]);
+        });
+        edgeLength = {};
+        edgeCount = {};
+
+        size_t splitBlocks = 0;
+        std::vector<uint32_t> slots;   // the vertex each slot of the compact layout holds
+        slots.reserve(vertexCount);
+        for (size_t b = 0; b < blockCount; ++b) {
+            if (pieces[b].empty()) {
+                const size_t begin = b << kVertexBlockShift;
+                const size_t end = std::min(vertexCount, begin + kVertexBlockSize);
+                for (size_t v = begin; v < end; ++v) slots.push_back(static_cast<uint32_t>(v));
+                continue;
+            }
+            ++splitBlocks;
+            for (const std::vector<uint32_t>& piece : pieces[b]) {
+                slots.insert(slots.end(), piece.begin(), piece.end());
+                slots.resize((slots.size() + kVertexBlockSize - 1) & ~size_t(kVertexBlockSize - 1), piece.front());
+            }
+        }
+        pieces = {};
+
+        const size_t slotCount = slots.size();
+        const size_t finalBlockCount = (slotCount + kVertexBlockSize - 1) >> kVertexBlockShift;
+        const size_t compactBytes = slotCount * sizeof(CompactVertex) + finalBlockCount * sizeof(VertexBlock);
+        if (compactBytes >= vertexCount * sizeof(MeshVertex)) {
+            std::fprintf(stderr, "  compact: kept 24-byte vertices; splitting %zu of %zu blocks that are "
+                         "too spread out would pad the layout to %.1f MB\n",
+                         splitBlocks, blockCount, compactBytes / 1e6);
+            return;
+        }
+
+        std::vector<VertexBlock> blocks(finalBlockCount);
+        std::vector<float> steps(finalBlockCount);
+        parallelFor(finalBlockCount, [&](size_t b) {
+            const size_t begin = b << kVertexBlockShift;
+            const size_t end = std::min(slotCount, begin + kVertexBlockSize);
+            fitVertexBlock(measureVertices(mesh.vertices, nullptr, nullptr, slots.data() + begin, end - begin),
+                           blocks[b]);
+            steps[b] = blocks[b].positionStep;
+        });
+
+        // ── Shared positions. Two blocks that hold one position — a seam between subsets, or
+        // between texture charts — decode it to the same float only on the same grid. Each such
+        // position goes on the coarsest grid among its blocks, which every finer one of them
+        // contains, since steps are powers of two. That can widen a block past its grid, which
+        // coarsens the block and possibly its neighbours' shared positions in turn; steps only
+        // grow, so it settles, in practice after one round ──
+        struct PositionKey {
+            std::array<uint32_t, 3> bits;   // compared as integers, so a NaN cannot upset the sort
+            uint32_t slot;
+            bool operator<(const PositionKey& other) const {
+                return bits != other.bits ? bits < other.bits : slot < other.slot;
+            }
+        };
+        std::vector<PositionKey> byPosition(slotCount);
+        parallelFor(finalBlockCount, [&](size_t b) {
+            const size_t end = std::min(slotCount, (b + 1) << kVertexBlockShift);
+            for (size_t slot = b << kVertexBlockShift; slot < end; ++slot) {
+                std::memcpy(byPosition[slot].bits.data(), mesh.vertices[slots[slot]].position, sizeof(float) * 3);
+                byPosition[slot].slot = static_cast<uint32_t>(slot);
+            }
+        });
+        std::sort(byPosition.begin(), byPosition.end());
+        std::vector<uint32_t> shared;       // slots of positions held by more than one block
+        std::vector<size_t> sharedEnds;     // where each position's run in `shared` ends
+        for (size_t i = 0; i < slotCount;) {
+            size_t j = i + 1;
+            while (j < slotCount && byPosition[j].bits == byPosition[i].bits) ++j;
+            // Sorted by slot within a position, so the run spans blocks if its ends do.
+            if ((byPosition[j - 1].slot >> kVertexBlockShift) != (byPosition[i].slot >> kVertexBlockShift)) {
+                for (size_t k = i; k < j; ++k) shared.push_back(byPosition[k].slot);
+                sharedEnds.push_back(shared.size());
+            }
+            i = j;
+        }
+        byPosition = {};
+
+        std::vector<float> positions(slotCount * 3);
+        parallelFor((slotCount + kVertexBlockSize - 1) >> kVertexBlockShift, [&](size_t b) {
+            const size_t end = std::min(slotCount, (b + 1) << kVertexBlockShift);
+            for (size_t slot = b << kVertexBlockShift; slot < end; ++slot) {
+                std::memcpy(&positions[slot * 3], mesh.vertices[slots[slot]].position, 3 * sizeof(float));
+            }
+        });
+        std::vector<uint8_t> holdsShared(finalBlockCount, 0);
+        for (const uint32_t slot : shared) holdsShared[slot >> kVertexBlockShift] = 1;
+
+        size_t coarsened = 0;
+        for (bool grew = true; grew;) {
+            coarsened = 0;
+            size_t runBegin = 0;
+            for (const size_t runEnd : sharedEnds) {
+                float step = 0.0f;
+                for (size_t i = runBegin; i < runEnd; ++i) step = std::max(step, steps[shared[i] >> kVertexBlockShift]);
+                for (size_t i = runBegin; i < runEnd; ++i) {
+                    const uint32_t slot = shared[i];
+                    if (steps[slot >> kVertexBlockShift] < step) ++coarsened;
+                    const float* original = mesh.vertices[slots[slot]].position;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        positions[size_t(slot) * 3 + axis] = static_cast<float>(
+                            std::nearbyint(original[axis] / static_cast<double>(step)) * step);
+                    }
+                }
+                runBegin = runEnd;
+            }
+
+            grew = false;
+            for (size_t b = 0; b < finalBlockCount; ++b) {
+                if (!holdsShared[b]) continue;
+                const size_t begin = b << kVertexBlockShift;
+                const size_t end = std::min(slotCount, begin + kVertexBlockSize);
+                float lo[3], hi[3];
+                std::fill_n(lo, 3, std::numeric_limits<float>::max());
+                std::fill_n(hi, 3, std::numeric_limits<float>::lowest());
+                for (size_t slot = begin; slot < end; ++slot) {
+                    for (int axis = 0; axis < 3; ++axis) {
+                        lo[axis] = std::min(lo[axis], positions[slot * 3 + axis]);
+                        hi[axis] = std::max(hi[axis], positions[slot * 3 + axis]);
+                    }
+                }
+                // A coarser step than needed still covers the block, so steps never shrink.
+                const float step = positionGridStep(lo, hi);
+                if (step > steps[b]) { steps[b] = step; grew = true; }
+                for (int axis = 0; axis < 3; ++axis) {
+                    blocks[b].positionOrigin[axis] = static_cast<float>(
+                        std::floor(lo[axis] / static_cast<double>(steps[b])) * steps[b]);
+                }
+                blocks[b].positionStep = steps[b];
+            }
+        }
+        shared = {};
+        sharedEnds = {};
+
+        std::vector<CompactVertex> compact(slotCount);
+        parallelFor(finalBlockCount, [&](size_t b) {
+            const VertexBlock& block = blocks[b];
+            const size_t end = std::min(slotCount, (b + 1) << kVertexBlockShift);
+            for (size_t slot = b << kVertexBlockShift; slot < end; ++slot) {
+                const MeshVertex& vertex = mesh.vertices[slots[slot]];
+                CompactVertex& out = compact[slot];
+                for (int axis = 0; axis < 3; ++axis) {
+                    out.position[axis] = gridPoint(positions[slot * 3 + axis], block.positionOrigin[axis],
+                                                   block.positionStep);
+                }
+                out.packedNormal = vertex.packedNormal;
+                for (int k = 0; k < 2; ++k) {
+                    out.uv[k] = gridPoint(vertex.uv[k], block.uvOrigin[k], block.uvStep);
+                }
+            }
+        });
+        positions = {};
+
+        // The 24-byte vertices and the indices follow the new layout, so the two stay
+        // interchangeable. A padding slot repeats a vertex no index names.
+        if (splitBlocks > 0) {
+            std::vector<uint32_t> remap(vertexCount);
+            for (size_t slot = slotCount; slot-- > 0;) remap[slots[slot]] = static_cast<uint32_t>(slot);
+            std::vector<MeshVertex> vertices(slotCount);
+            parallelFor(finalBlockCount, [&](size_t b) {
+                const size_t end = std::min(slotCount, (b + 1) << kVertexBlockShift);
+                for (size_t slot = b << kVertexBlockShift; slot < end; ++slot) vertices[slot] = mesh.vertices[slots[slot]];
+            });
+            mesh.vertices = std::move(vertices);
+            constexpr size_t kIndexChunk = size_t(1) << 16;
+            parallelFor((mesh.indices.size() + kIndexChunk - 1) / kIndexChunk, [&](size_t c) {
+                const size_t end = std::min(mesh.indices.size(), (c + 1) * kIndexChunk);
+                for (size_t i = c * kIndexChunk; i < end; ++i) mesh.indices[i] = remap[mesh.indices[i]];
+            });
+        }
+
+        mesh.compactVertices = std::move(compact);
+        mesh.vertexBlocks = std::move(blocks);
+        std::fprintf(stderr, "  compact: %zu vertices at %zu bytes, %.1f MB -> %.1f MB; %zu of %zu blocks split, "
+                     "%zu vertices moved to a coarser grid\n",
+                     vertexCount, sizeof(CompactVertex), vertexCount * sizeof(MeshVertex) / 1e6,
+                     compactBytes / 1e6, splitBlocks, blockCount, coarsened);
+    }
+
+    void narrowIndices(Mesh& mesh)
+    {
+        mesh.loadPasses |= LoadPassIndex16;
+        const size_t subsetCount = mesh.subsets.size();
+
+        // The vertex range of each subset, levels included: they draw the same vertices.
+        std::vector<uint32_t> lo(subsetCount, std::numeric_limits<uint32_t>::max());
+        std::vector<uint32_t> hi(subsetCount, 0);
+        parallelFor(subsetCount, [&](size_t s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            auto cover = [&](uint32_t first, uint32_t count) {
+                for (uint32_t i = first; i < first + count; ++i) {
+                    lo[s] = std::min(lo[s], mesh.indices[i]);
+                    hi[s] = std::max(hi[s], mesh.indices[i]);
+                }
+            };
+            cover(subset.firstIndex, subset.indexCount);
+            for (uint32_t l = 0; l < subset.lodCount; ++l) {
+                const MeshLod& lod = mesh.lods[subset.firstLod + l];
+                cover(lod.firstIndex, lod.indexCount);
+            }
+        });
+
+        // A draw command has one vertex offset, so two neighbours merge into one command only if
+        // they share a base. Consecutive subsets that fit are therefore grouped while their
+        // ranges together still fit, and the group's lowest vertex is the base of all of them.
+        // After optimizeVertexOrder() subsets use vertices in the order they come, so a group
+        // covers a long run of the scene.
+        std::vector<uint8_t> fits(subsetCount, 0);
+        std::vector<uint32_t> base(subsetCount, 0);
+        size_t baseCount = 0;
+        {
+            std::vector<size_t> group;
+            uint32_t groupLo = 0, groupHi = 0;
+            auto close = [&]() {
+                for (const size_t s : group) base[s] = groupLo;
+                if (!group.empty()) ++baseCount;
+                group.clear();
+            };
+            for (size_t s = 0; s < subsetCount; ++s) {
+                if (lo[s] > hi[s] || hi[s] - lo[s] > kMaxIndex16) continue;
+                fits[s] = 1;
+                if (!group.empty() &&
+                    std::max(groupHi, hi[s]) - std::min(groupLo, lo[s]) <= kMaxIndex16) {
+                    groupLo = std::min(groupLo, lo[s]);
+                    groupHi = std::max(groupHi, hi[s]);
+                } else {
+                    close();
+                    groupLo = lo[s];
+                    groupHi = hi[s];
+                }
+                group.push_back(s);
+            }
+            close();
+        }
+
+        // Rebuild both arrays in the old order, subsets first and levels after, so whatever was
+        // adjacent before is adjacent still within its array.
+        std::vector<uint32_t> wide;
+        std::vector<uint16_t> narrow;
+        size_t narrowCount = 0, wideCount = 0;
+        for (size_t s = 0; s < subsetCount; ++s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            size_t count = subset.indexCount;
+            for (uint32_t l = 0; l < subset.lodCount; ++l) count += mesh.lods[subset.firstLod + l].indexCount;
+            (fits[s] ? narrowCount : wideCount) += count;
+        }
+        wide.reserve(wideCount);
+        narrow.reserve(narrowCount);
+
+        // Returns where the range starts in its new array.
+        auto move = [&](size_t s, uint32_t first, uint32_t count) -> uint32_t {
+            const uint32_t* source = mesh.indices.data() + first;
+            if (!fits[s]) {
+                const uint32_t at = static_cast<uint32_t>(wide.size());
+                wide.insert(wide.end(), source, source + count);
+                return at;
+            }
+            const uint32_t at = static_cast<uint32_t>(narrow.size());
+            for (uint32_t i = 0; i < count; ++i) {
+                narrow.push_back(static_cast<uint16_t>(source[i] - base[s]));
+            }
+            return at;
+        };
+
+        size_t narrowSubsets = 0;
+        for (size_t s = 0; s < subsetCount; ++s) {
+            MeshSubset& subset = mesh.subsets[s];
+            const uint32_t first = move(s, subset.firstIndex, subset.indexCount);
+            for (uint32_t c = 0; c < subset.clusterCount; ++c) {
+                MeshCluster& cluster = mesh.clusters[subset.firstCluster + c];
+                cluster.firstIndex = cluster.firstIndex - subset.firstIndex + first;
+            }
+            subset.firstIndex = first;
+            subset.index16 = fits[s] != 0 ? 1u : 0u;
+            subset.baseVertex = base[s];
+            narrowSubsets += fits[s];
+        }
+        for (size_t s = 0; s < subsetCount; ++s) {
+            const MeshSubset& subset = mesh.subsets[s];
+            for (uint32_t l = 0; l < subset.lodCount; ++l) {
+                MeshLod& lod = mesh.lods[subset.firstLod + l];
+                lod.firstIndex = move(s, lod.firstIndex, lod.indexCount);
+            }
+        }
+
+        const size_t before = mesh.indices.size() * sizeof(uint32_t);
+        mesh.indices = std::move(wide);
+        mesh.indices16 = std::move(narrow);
+        std::fprintf(stderr, "  index16: %zu of %zu subsets over %zu base vertices, %.1f MB -> %.1f MB of indices\n",
+                     narrowSubsets, subsetCount, baseCount, before / 1e6,
+                     (mesh.indices.size() * sizeof(uint32_t) + mesh.indices16.size() * sizeof(uint16_t)) / 1e6);
+    }
+
+} // namespace dmrender
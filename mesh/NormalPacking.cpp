@@ -0,0 +1,331 @@
+//
+// Octahedral normal packing, one normal at a time and in batches.
+//
+// Every normal a loader produces passes through here, and a scene kit passes each one through
+// twice more to rotate it. One at a time that is a square root, two divides and a handful of
+// branches per normal; across four or eight lanes the branches become selects and the cost is
+// shared.
+//
+// The batched paths must produce exactly what packNormal() produces: the cache stores packed
+// normals, and a vertex deduplicated on its packed normal must not split in two depending on
+// which path packed it. So there is only one algorithm, written once as a template over a set of
+// lane operations, and instantiated for plain floats as well as for SSE2, AVX2 and NEON
+// registers. Every step is an IEEE operation that rounds identically in all of them — no
+// reciprocal estimates, and lround() spelled out as truncate-and-correct. The one thing that
+// could still tell them apart is the compiler fusing a multiply and an add in one instantiation
+// and not in another, which is why this file is built with contraction off.
+//
+
+#include "Mesh.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define DMRENDER_NORMALS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define DMRENDER_NORMALS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define DMRENDER_NORMALS_NEON 1
+#endif
+
+namespace dmrender {
+
+    namespace {
+
+        // ─────────────────────────────────────────────────────────────────────
+        // Lane operations
+        //
+        // F is a register of floats, I of 32-bit integers, M a comparison mask. Comparisons are
+        // ordered: false when either side is NaN, as the scalar `<` is.
+        // ─────────────────────────────────────────────────────────────────────
+
+        struct ScalarLanes {
+            static constexpr size_t kWidth = 1;
+            using F = float;
+            using I = int32_t;
+            using M = bool;
+
+            static F load(const float* p) { return *p; }
+            static I loadInt(const uint32_t* p) { return static_cast<I>(*p); }
+            static void storeInt(uint32_t* p, I v) { *p = static_cast<uint32_t>(v); }
+            static F set(float v) { return v; }
+            static F add(F a, F b) { return a + b; }
+            static F sub(F a, F b) { return a - b; }
+            static F mul(F a, F b) { return a * b; }
+            static F div(F a, F b) { return a / b; }
+            static F sqrt(F a) { return std::sqrt(a); }
+            static F abs(F a) { return std::abs(a); }
+            static M lt(F a, F b) { return a < b; }
+            static M ge(F a, F b) { return a >= b; }
+            static M le(F a, F b) { return a <= b; }
+            static F select(M m, F a, F b) { return m ? a : b; }
+            static I truncate(F a) { return static_cast<I>(a); }
+            static F toFloat(I a) { return static_cast<F>(a); }
+            static I addIf(I a, M m) { return m ? a + 1 : a; }
+            static I subIf(I a, M m) { return m ? a - 1 : a; }
+            static I join(I low, I high) {
+                return static_cast<I>((static_cast<uint32_t>(low) & 0xFFFFu) |
+                                      (static_cast<uint32_t>(high) << 16));
+            }
+            static I lowHalf(I packed) { return static_cast<int16_t>(static_cast<uint16_t>(packed)); }
+            static I highHalf(I packed) {
+                return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(packed) >> 16));
+            }
+        };
+
+#if DMRENDER_NORMALS_SSE2
+        struct WideLanes {
+            static constexpr size_t kWidth = 4;
+            using F = __m128;
+            using I = __m128i;
+            using M = __m128;
+
+            static F load(const float* p) { return _mm_loadu_ps(p); }
+            static I loadInt(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+            static void storeInt(uint32_t* p, I v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+            static F set(float v) { return _mm_set1_ps(v); }
+            static F add(F a, F b) { return _mm_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+            static F div(F a, F b) { return _mm_div_ps(a, b); }
+            static F sqrt(F a) { return _mm_sqrt_ps(a); }
+            static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+            static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+            static M ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+            static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+            static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+            static I truncate(F a) { return _mm_cvttps_epi32(a); }
+            static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+            // A true mask is -1, so subtracting it adds one.
+            static I addIf(I a, M m) { return _mm_sub_epi32(a, _mm_castps_si128(m)); }
+            static I subIf(I a, M m) { return _mm_add_epi32(a, _mm_castps_si128(m)); }
+            static I join(I low, I high) {
+                return _mm_or_si128(_mm_and_si128(low, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(high, 16));
+            }
+            static I lowHalf(I packed) { return _mm_srai_epi32(_mm_slli_epi32(packed, 16), 16); }
+            static I highHalf(I packed) { return _mm_srai_epi32(packed, 16); }
+        };
+#elif DMRENDER_NORMALS_AVX2
+        struct WideLanes {
+            static constexpr size_t kWidth = 8;
+            using F = __m256;
+            using I = __m256i;
+            using M = __m256;
+
+            static F load(const float* p) { return _mm256_loadu_ps(p); }
+            static I loadInt(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+            static void storeInt(uint32_t* p, I v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+            static F set(float v) { return _mm256_set1_ps(v); }
+            static F add(F a, F b) { return _mm256_add_ps(a, b); }
+            static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+            static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+            static F div(F a, F b) { return _mm256_div_ps(a, b); }
+            static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+            static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static M ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+            static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+            static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+            static I truncate(F a) { return _mm256_cvttps_epi32(a); }
+            static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+            static I addIf(I a, M m) { return _mm256_sub_epi32(a, _mm256_castps_si256(m)); }
+            static I subIf(I a, M m) { return _mm256_add_epi32(a, _mm256_castps_si256(m)); }
+            static I join(I low, I high) {
+                return _mm256_or_si256(_mm256_and_si256(low, _mm256_set1_epi32(0xFFFF)),
+                                       _mm256_slli_epi32(high, 16));
+            }
+            static I lowHalf(I packed) { return _mm256_srai_epi32(_mm256_slli_epi32(packed, 16), 16); }
+            static I highHalf(I packed) { return _mm256_srai_epi32(packed, 16); }
+        };
+#elif DMRENDER_NORMALS_NEON
+        struct WideLanes {
+            static constexpr size_t kWidth = 4;
+            using F = float32x4_t;
+            using I = int32x4_t;
+            using M = uint32x4_t;
+
+            static F load(const float* p) { return vld1q_f32(p); }
+            static I loadInt(const uint32_t* p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+            static void storeInt(uint32_t* p, I v) { vst1q_u32(p, vreinterpretq_u32_s32(v)); }
+            static F set(float v) { return vdupq_n_f32(v); }
+            static F add(F a, F b) { return vaddq_f32(a, b); }
+            static F sub(F a, F b) { return vsubq_f32(a, b); }
+            static F mul(F a, F b) { return vmulq_f32(a, b); }
+            static F div(F a, F b) { return vdivq_f32(a, b); }
+            static F sqrt(F a) { return vsqrtq_f32(a); }
+            static F abs(F a) { return vabsq_f32(a); }
+            static M lt(F a, F b) { return vcltq_f32(a, b); }
+            static M ge(F a, F b) { return vcgeq_f32(a, b); }
+            static M le(F a, F b) { return vcleq_f32(a, b); }
+            static F select(M m, F a, F b) { return vbslq_f32(m, a, b); }
+            static I truncate(F a) { return vcvtq_s32_f32(a); }
+            static F toFloat(I a) { return vcvtq_f32_s32(a); }
+            static I addIf(I a, M m) { return vsubq_s32(a, vreinterpretq_s32_u32(m)); }
+            static I subIf(I a, M m) { return vaddq_s32(a, vreinterpretq_s32_u32(m)); }
+            static I join(I low, I high) {
+                return vreinterpretq_s32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_s32(low), vdupq_n_u32(0xFFFFu)),
+                                                       vshlq_n_u32(vreinterpretq_u32_s32(high), 16)));
+            }
+            static I lowHalf(I packed) { return vshrq_n_s32(vshlq_n_s32(packed, 16), 16); }
+            static I highHalf(I packed) { return vshrq_n_s32(packed, 16); }
+        };
+#else
+        using WideLanes = ScalarLanes;
+#endif
+
+        // ─────────────────────────────────────────────────────────────────────
+        // The algorithm, once
+        // ─────────────────────────────────────────────────────────────────────
+
+        template <typename L>
+        typename L::I packLanes(typename L::F x, typename L::F y, typename L::F z)
+        {
+            using F = typename L::F;
+            const F zero = L::set(0.0f), one = L::set(1.0f), minusOne = L::set(-1.0f);
+
+            const F length = L::sqrt(L::add(L::add(L::mul(x, x), L::mul(y, y)), L::mul(z, z)));
+            const auto tiny = L::lt(length, L::set(1e-20f));
+            x = L::select(tiny, zero, L::div(x, length));
+            y = L::select(tiny, one,  L::div(y, length));
+            z = L::select(tiny, zero, L::div(z, length));
+
+            // Octahedron mapping: project the unit sphere onto the |x|+|y|+|z| = 1 octahedron,
+            // then unfold its lower half outwards into the corners of the square, so the whole
+            // sphere covers [-1,1]^2 exactly once.
+            const F invL1 = L::div(one, L::add(L::add(L::abs(x), L::abs(y)), L::abs(z)));
+            const F px = L::mul(x, invL1);
+            const F py = L::mul(y, invL1);
+
+            const auto below = L::lt(z, zero);
+            const F fx = L::mul(L::sub(one, L::abs(py)), L::select(L::ge(px, zero), one, minusOne));
+            const F fy = L::mul(L::sub(one, L::abs(px)), L::select(L::ge(py, zero), one, minusOne));
+
+            // Signed 16-bit normalised, matching GLSL's unpackSnorm2x16 exactly: clamp, scale,
+            // and round half away from zero the way std::lround does.
+            auto quantise = [&](F value) {
+                const F lessThanOne = L::select(L::lt(value, one), value, one);
+                const F clamped = L::select(L::lt(minusOne, lessThanOne), lessThanOne, minusOne);
+                const F scaled = L::mul(clamped, L::set(32767.0f));
+                const auto whole = L::truncate(scaled);
+                const F fraction = L::sub(scaled, L::toFloat(whole));   // exact below 2^23
+                return L::subIf(L::addIf(whole, L::ge(fraction, L::set(0.5f))),
+                                L::le(fraction, L::set(-0.5f)));
+            };
+            return L::join(quantise(L::select(below, fx, px)), quantise(L::select(below, fy, py)));
+        }
+
+        template <typename L>
+        void unpackLanes(typename L::I packed, typename L::F& outX, typename L::F& outY, typename L::F& outZ)
+        {
+            using F = typename L::F;
+            const F zero = L::set(0.0f), one = L::set(1.0f), minusOne = L::set(-1.0f);
+
+            // Exactly the inverse of the mapping above, and the same arithmetic the shaders do.
+            auto dequantise = [&](typename L::I bits) {
+                const F value = L::div(L::toFloat(bits), L::set(32767.0f));
+                return L::select(L::lt(minusOne, value), value, minusOne);
+            };
+            F x = dequantise(L::lowHalf(packed));
+            F y = dequantise(L::highHalf(packed));
+            const F z = L::sub(one, L::add(L::abs(x), L::abs(y)));
+
+            // Below the fold, the square's corners hold the lower hemisphere; fold them back.
+            const auto below = L::lt(z, zero);
+            const F fx = L::mul(L::sub(one, L::abs(y)), L::select(L::ge(x, zero), one, minusOne));
+            const F fy = L::mul(L::sub(one, L::abs(x)), L::select(L::ge(y, zero), one, minusOne));
+            x = L::select(below, fx, x);
+            y = L::select(below, fy, y);
+
+            const F length = L::sqrt(L::add(L::add(L::mul(x, x), L::mul(y, y)), L::mul(z, z)));
+            const auto tiny = L::lt(length, L::set(1e-20f));
+            outX = L::select(tiny, zero, L::div(x, length));
+            outY = L::select(tiny, one,  L::div(y, length));
+            outZ = L::select(tiny, zero, L::div(z, length));
+        }
+
+        /// @brief result[r] = m[0][r]·x + m[1][r]·y + m[2][r]·z, summed left to right.
+        template <typename L>
+        typename L::I transformLanes(typename L::I packed, const float m[3][3])
+        {
+            typename L::F x, y, z;
+            unpackLanes<L>(packed, x, y, z);
+            typename L::F rotated[3];
+            for (int row = 0; row < 3; ++row) {
+                rotated[row] = L::add(L::add(L::mul(L::set(m[0][row]), x), L::mul(L::set(m[1][row]), y)),
+                                      L::mul(L::set(m[2][row]), z));
+            }
+            return packLanes<L>(rotated[0], rotated[1], rotated[2]);
+        }
+
+    } // namespace
+
+    uint32_t packNormal(float x, float y, float z)
+    {
+        return static_cast<uint32_t>(packLanes<ScalarLanes>(x, y, z));
+    }
+
+    void unpackNormal(uint32_t packed, float out[3])
+    {
+        unpackLanes<ScalarLanes>(static_cast<int32_t>(packed), out[0], out[1], out[2]);
+    }
+
+    void packNormals(const float* xyz, uint32_t* out, size_t count)
+    {
+        constexpr size_t W = WideLanes::kWidth;
+        size_t i = 0;
+        for (; i + W <= count; i += W) {
+            // Deinterleave through the stack; the arithmetic that follows dwarfs the shuffle.
+            float x[W], y[W], z[W];
+            for (size_t lane = 0; lane < W; ++lane) {
+                x[lane] = xyz[(i + lane) * 3 + 0];
+                y[lane] = xyz[(i + lane) * 3 + 1];
+                z[lane] = xyz[(i + lane) * 3 + 2];
+            }
+            WideLanes::storeInt(out + i, packLanes<WideLanes>(WideLanes::load(x), WideLanes::load(y),
+                                                              WideLanes::load(z)));
+        }
+        for (; i < count; ++i) out[i] = packNormal(xyz[i * 3 + 0], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+    }
+
+    void unpackNormals(const uint32_t* packed, float* xyz, size_t count)
+    {
+        constexpr size_t W = WideLanes::kWidth;
+        size_t i = 0;
+        for (; i + W <= count; i += W) {
+            WideLanes::F x, y, z;
+            unpackLanes<WideLanes>(WideLanes::loadInt(packed + i), x, y, z);
+            float lanes[3][W];
+            std::memcpy(lanes[0], &x, sizeof(lanes[0]));
+            std::memcpy(lanes[1], &y, sizeof(lanes[1]));
+            std::memcpy(lanes[2], &z, sizeof(lanes[2]));
+            for (size_t lane = 0; lane < W; ++lane) {
+                xyz[(i + lane) * 3 + 0] = lanes[0][lane];
+                xyz[(i + lane) * 3 + 1] = lanes[1][lane];
+                xyz[(i + lane) * 3 + 2] = lanes[2][lane];
+            }
+        }
+        for (; i < count; ++i) unpackNormal(packed[i], xyz + i * 3);
+    }
+
+    void transformPackedNormals(MeshVertex* vertices, size_t count, const float matrix[3][3])
+    {
+        constexpr size_t W = WideLanes::kWidth;
+        size_t i = 0;
+        for (; i + W <= count; i += W) {
+            uint32_t lanes[W];
+            for (size_t lane = 0; lane < W; ++lane) lanes[lane] = vertices[i + lane].packedNormal;
+            WideLanes::storeInt(lanes, transformLanes<WideLanes>(WideLanes::loadInt(lanes), matrix));
+            for (size_t lane = 0; lane < W; ++lane) vertices[i + lane].packedNormal = lanes[lane];
+        }
+        for (; i < count; ++i) {
+            vertices[i].packedNormal = static_cast<uint32_t>(
+                transformLanes<ScalarLanes>(static_cast<int32_t>(vertices[i].packedNormal), matrix));
+        }
+    }
+
+} // namespace dmrender
@@ -1,5 +1,7 @@
 #include "Mesh.hpp"
+#include "LoadSupport.hpp"
 
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
@@ -27,7 +29,7 @@ namespace dmrender {
          */
         struct SceneCacheHeader {
             char     magic[8] = { 'D','M','S','C','N','0','0','\0' };
-            uint32_t version = 2;
+            uint32_t version = 15;
             uint32_t vertexStride = static_cast<uint32_t>(sizeof(MeshVertex));
 
             uint64_t sourceSize = 0;
@@ -35,15 +37,28 @@ namespace dmrender {
 
             uint64_t vertexCount = 0;
             uint64_t indexCount = 0;
+            uint64_t index16Count = 0;
             uint64_t subsetCount = 0;
             uint64_t materialCount = 0;
+            uint64_t clusterCount = 0;
+            uint64_t lodCount = 0;
+            uint64_t instanceCount = 0;
+            uint64_t compactVertexCount = 0;   ///< 0, or vertexCount when the compact pass chose it.
 
             float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
             float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
 
             uint32_t hadNormals = 0;
             uint32_t hadTexCoords = 0;
+            uint32_t loadPasses = 0;
+            uint32_t mergeTriangles = 0;
+            float    stlWeldDistance = 0.0f;
+            /// Fills what would otherwise be tail padding. The header is written whole, and
+            /// padding is not zeroed by `header{}`, so it would carry stack bytes to disk.
+            uint32_t reserved = 0;
         };
+        static_assert(sizeof(SceneCacheHeader) == 152,
+                      "SceneCacheHeader must have no padding: it is written to disk as it is");
 
         void writeString(std::ofstream& out, const std::string& value)
         {
@@ -86,6 +101,7 @@ namespace dmrender {
 
     bool loadSceneCache(const std::filesystem::path& modelPath, Mesh& mesh)
     {
+        const auto loadStart = std::chrono::steady_clock::now();
         const std::filesystem::path cachePath = sceneCachePath(modelPath);
         std::ifstream in(cachePath, std::ios::binary);
         if (!in) return false;
@@ -103,21 +119,39 @@ namespace dmrender {
         int64_t writeTime = 0;
         if (!sourceStamp(modelPath, size, writeTime)) return false;
         if (header.sourceSize != size || header.sourceWriteTime != writeTime) return false;
+        // A cache written with different load passes is stale too: rebuilding is the only way to
+        // get the mesh that was asked for.
+        if (header.loadPasses != enabledLoadPasses()) return false;
+        if (header.mergeTriangles != subsetMergeTriangles()) return false;
+        if (header.stlWeldDistance != stlWeldDistance()) return false;
 
         // Guard against a header that survived the checks but describes something impossible,
         // which would otherwise turn into a multi-gigabyte allocation.
-        if (header.vertexCount > (1ull << 32) || header.indexCount > (1ull << 33)) return false;
+        if (header.vertexCount > (1ull << 32) || header.indexCount > (1ull << 33) ||
+            header.index16Count > (1ull << 33)) return false;
+        const uint64_t allIndices = header.indexCount + header.index16Count;
+        if (header.clusterCount > allIndices / 3) return false;
+        if (header.lodCount > allIndices / 3) return false;
+        if (header.instanceCount > (1ull << 32)) return false;
+        if (header.compactVertexCount != 0 && header.compactVertexCount != header.vertexCount) return false;
 
         mesh = Mesh{};
         mesh.baseDirectory = modelPath.parent_path();
         mesh.hadNormals = header.hadNormals != 0;
         mesh.hadTexCoords = header.hadTexCoords != 0;
+        mesh.loadPasses = header.loadPasses;
         std::memcpy(mesh.boundsMin, header.boundsMin, sizeof(mesh.boundsMin));
         std::memcpy(mesh.boundsMax, header.boundsMax, sizeof(mesh.boundsMax));
 
         mesh.vertices.resize(static_cast<size_t>(header.vertexCount));
         mesh.indices.resize(static_cast<size_t>(header.indexCount));
+        mesh.indices16.resize(static_cast<size_t>(header.index16Count));
         mesh.subsets.resize(static_cast<size_t>(header.subsetCount));
+        mesh.clusters.resize(static_cast<size_t>(header.clusterCount));
+        mesh.lods.resize(static_cast<size_t>(header.lodCount));
+        mesh.instances.resize(static_cast<size_t>(header.instanceCount));
+        mesh.compactVertices.resize(static_cast<size_t>(header.compactVertexCount));
+        mesh.vertexBlocks.resize((mesh.compactVertices.size() + kVertexBlockSize - 1) >> kVertexBlockShift);
 
         // The whole point of the cache: three large reads instead of parsing a gigabyte of text.
         if (!mesh.vertices.empty()) {
@@ -128,10 +162,32 @@ namespace dmrender {
             in.read(reinterpret_cast<char*>(mesh.indices.data()),
                     static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
         }
+        if (!mesh.indices16.empty()) {
+            in.read(reinterpret_cast<char*>(mesh.indices16.data()),
+                    static_cast<std::streamsize>(mesh.indices16.size() * sizeof(uint16_t)));
+        }
         if (!mesh.subsets.empty()) {
             in.read(reinterpret_cast<char*>(mesh.subsets.data()),
                     static_cast<std::streamsize>(mesh.subsets.size() * sizeof(MeshSubset)));
         }
+        if (!mesh.clusters.empty()) {
+            in.read(reinterpret_cast<char*>(mesh.clusters.data()),
+                    static_cast<std::streamsize>(mesh.clusters.size() * sizeof(MeshCluster)));
+        }
+        if (!mesh.lods.empty()) {
+            in.read(reinterpret_cast<char*>(mesh.lods.data()),
+                    static_cast<std::streamsize>(mesh.lods.size() * sizeof(MeshLod)));
+        }
+        if (!mesh.instances.empty()) {
+            in.read(reinterpret_cast<char*>(mesh.instances.data()),
+                    static_cast<std::streamsize>(mesh.instances.size() * sizeof(MeshInstance)));
+        }
+        if (!mesh.compactVertices.empty()) {
+            in.read(reinterpret_cast<char*>(mesh.compactVertices.data()),
+                    static_cast<std::streamsize>(mesh.compactVertices.size() * sizeof(CompactVertex)));
+            in.read(reinterpret_cast<char*>(mesh.vertexBlocks.data()),
+                    static_cast<std::streamsize>(mesh.vertexBlocks.size() * sizeof(VertexBlock)));
+        }
         if (!in) return false;
 
         mesh.materials.resize(static_cast<size_t>(header.materialCount));
@@ -164,6 +220,15 @@ namespace dmrender {
         std::string format;
         if (!readString(in, format)) return false;
         mesh.sourceFormat = format + " (cached)";
+
+        // One phase: there is nothing left to break down, which is the point of the cache.
+        LoadStats& stats = mesh.loadStats;
+        stats.fromCache = true;
+        stats.bytesRead = fileBytes(cachePath);
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        stats.add("cache", stats.seconds);
+        stats.residentBytes = currentResidentBytes();
+        stats.peakResidentBytes = peakResidentBytes();
         return true;
     }
 
@@ -182,12 +247,20 @@ namespace dmrender {
         header.sourceWriteTime = writeTime;
         header.vertexCount = mesh.vertices.size();
         header.indexCount = mesh.indices.size();
+        header.index16Count = mesh.indices16.size();
         header.subsetCount = mesh.subsets.size();
         header.materialCount = mesh.materials.size();
+        header.clusterCount = mesh.clusters.size();
+        header.lodCount = mesh.lods.size();
+        header.instanceCount = mesh.instances.size();
+        header.compactVertexCount = mesh.compactVertices.size();
         std::memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
         std::memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
         header.hadNormals = mesh.hadNormals ? 1u : 0u;
         header.hadTexCoords = mesh.hadTexCoords ? 1u : 0u;
+        header.loadPasses = mesh.loadPasses;
+        header.mergeTriangles = (mesh.loadPasses & LoadPassMergeSubsets) ? subsetMergeTriangles() : 0;
+        header.stlWeldDistance = stlWeldDistance();
 
         out.write(reinterpret_cast<const char*>(&header), sizeof(header));
         if (!mesh.vertices.empty()) {
@@ -198,10 +271,32 @@ namespace dmrender {
             out.write(reinterpret_cast<const char*>(mesh.indices.data()),
                       static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
         }
+        if (!mesh.indices16.empty()) {
+            out.write(reinterpret_cast<const char*>(mesh.indices16.data()),
+                      static_cast<std::streamsize>(mesh.indices16.size() * sizeof(uint16_t)));
+        }
         if (!mesh.subsets.empty()) {
             out.write(reinterpret_cast<const char*>(mesh.subsets.data()),
                       static_cast<std::streamsize>(mesh.subsets.size() * sizeof(MeshSubset)));
         }
+        if (!mesh.clusters.empty()) {
+            out.write(reinterpret_cast<const char*>(mesh.clusters.data()),
+                      static_cast<std::streamsize>(mesh.clusters.size() * sizeof(MeshCluster)));
+        }
+        if (!mesh.lods.empty()) {
+            out.write(reinterpret_cast<const char*>(mesh.lods.data()),
+                      static_cast<std::streamsize>(mesh.lods.size() * sizeof(MeshLod)));
+        }
+        if (!mesh.instances.empty()) {
+            out.write(reinterpret_cast<const char*>(mesh.instances.data()),
+                      static_cast<std::streamsize>(mesh.instances.size() * sizeof(MeshInstance)));
+        }
+        if (!mesh.compactVertices.empty()) {
+            out.write(reinterpret_cast<const char*>(mesh.compactVertices.data()),
+                      static_cast<std::streamsize>(mesh.compactVertices.size() * sizeof(CompactVertex)));
+            out.write(reinterpret_cast<const char*>(mesh.vertexBlocks.data()),
+                      static_cast<std::streamsize>(mesh.vertexBlocks.size() * sizeof(VertexBlock)));
+        }
 
         auto relative = [&](const std::filesystem::path& path) -> std::string {
             if (path.empty()) return {};
@@ -21,6 +21,7 @@
 //
 
 #include "Mesh.hpp"
+#include "LoadSupport.hpp"
 
 #include <algorithm>
 #include <cctype>
@@ -108,6 +109,7 @@ namespace dmrender {
         void appendTransformed(Mesh& target, const Mesh& source, const Transform& transform,
                                int32_t materialIndex)
         {
+            LoadPhaseTimer phase(target.loadStats, "place");
             float normals[3][3];
             normalMatrix(transform, normals);
 
@@ -127,19 +129,11 @@ namespace dmrender {
             for (const MeshVertex& in : source.vertices) {
                 MeshVertex out = in;
                 transform.point(in.position, out.position);
-
-                // The normal is packed, so transforming it means unpacking and repacking.
-                float normal[3];
-                unpackNormal(in.packedNormal, normal);
-                float rotated[3];
-                for (int row = 0; row < 3; ++row) {
-                    rotated[row] = normals[0][row] * normal[0]
-                                 + normals[1][row] * normal[1]
-                                 + normals[2][row] * normal[2];
-                }
-                out.packedNormal = packNormal(rotated[0], rotated[1], rotated[2]);
                 target.vertices.push_back(out);
             }
+            // The normals are packed, so transforming them means unpacking and repacking — done
+            // in one batch over the whole copy rather than vertex by vertex.
+            transformPackedNormals(target.vertices.data() + vertexBase, source.vertices.size(), normals);
 
             target.indices.reserve(target.indices.size() + source.indices.size());
             for (size_t i = 0; i + 2 < source.indices.size(); i += 3) {
@@ -204,15 +198,20 @@ namespace dmrender {
      * @brief Loads a `.dmscene` layout and the kit assets it references.
      *
      * Each distinct asset is read from disk once however many times it is placed; the geometry is
-     * then copied per placement. Copying rather than instancing is a deliberate trade: the
-     * renderer draws from one vertex buffer with per-subset culling, and an interior of a few
-     * hundred props costs a few million triangles — well inside what the geometry path already
-     * handles, and it keeps every existing code path working unchanged.
+     * then copied per placement. Copying keeps this reader simple and every placement an
+     * ordinary subset; findInstances() turns the copies back into instances afterwards, the
+     * same way it does for copies written out by an exporter.
      */
-    bool loadScene(const std::filesystem::path& path, Mesh& mesh, std::string& error)
+    bool loadScene(const std::filesystem::path& path, Mesh& mesh, std::string& error, LoadProgress* progress)
     {
         std::ifstream file(path);
         if (!file) { error = "cannot open " + path.string(); return false; }
+        const uint64_t layoutBytes = fileBytes(path);
+        mesh.loadStats.bytesRead += layoutBytes;
+        // Assets load as the lines naming them are reached, so the layout read so far is a fair
+        // measure of the whole.
+        ReadProgress read(progress);
+        read.stage("reading", 0.0f, 1.0f, layoutBytes);
 
         const std::filesystem::path sceneDirectory = path.parent_path();
         std::filesystem::path kitRoot = sceneDirectory;
@@ -250,7 +249,9 @@ namespace dmrender {
 
             Mesh asset;
             asset.baseDirectory = assetPath.parent_path();
-            if (!loadFbx(assetPath, asset, why)) {
+            const bool assetLoaded = loadFbx(assetPath, asset, why);
+            mesh.loadStats.merge(asset.loadStats);
+            if (!assetLoaded) {
                 // Reported per distinct asset rather than per placement: a converted layout can
                 // reference one broken mesh from two hundred lines, and a silent skip means the
                 // scene simply comes up missing a wall with nothing to say why.
@@ -282,6 +283,7 @@ namespace dmrender {
 
         while (std::getline(file, line)) {
             ++lineNumber;
+            read.advance(line.size() + 1);
             if (const size_t comment = line.find('#'); comment != std::string::npos) {
                 line.erase(comment);
             }
@@ -2,6 +2,27 @@
 
 // GLSL/SPIR-V port of `mesh_vertex_shader` from shaders/metal/Mesh.metal.
 
+#ifdef COMPACT_VERTICES
+// 16 bytes, matching CompactVertex in mesh/Mesh.hpp. The 16-bit fields are read in pairs as
+// uints, low half first, since a storage buffer has no portable 16-bit type.
+struct MeshVertex {
+    uint positionXY;
+    uint positionZ;       // high half unused
+    uint packedNormal;    // octahedral, two signed 16-bit halves
+    uint uv;
+};
+
+// The grid a run of 2^kVertexBlockShift vertices counts on, matching VertexBlock.
+struct VertexBlock {
+    vec4 position;        // xyz origin, w step
+    vec4 uv;              // xy origin, z step
+};
+const uint kVertexBlockShift = 8u;
+
+layout(std430, set = 0, binding = 3) readonly buffer VertexBlockBuffer {
+    VertexBlock blocks[];
+} vertexBlockBuffer;
+#else
 // 24 bytes, matching MeshVertex in mesh/Mesh.hpp exactly.
 //
 // Every member is a scalar on purpose. A `vec3` has 16-byte alignment even in std430, so
@@ -16,6 +37,7 @@ struct MeshVertex {
     float u;
     float v;
 };
+#endif
 
 layout(std430, set = 0, binding = 0) readonly buffer VertexBuffer {
     MeshVertex vertices[];
@@ -75,12 +97,24 @@ void main() {
     MeshVertex v = vertexBuffer.vertices[gl_VertexIndex];
     InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
 
-    vec4 world = instance.model * vec4(v.positionX, v.positionY, v.positionZ, 1.0);
+#ifdef COMPACT_VERTICES
+    // An integer times a power of two is exact, and the loader puts a position two blocks share
+    // on a grid both contain, so it decodes to the same float in each.
+    VertexBlock block = vertexBlockBuffer.blocks[uint(gl_VertexIndex) >> kVertexBlockShift];
+    vec3 position = block.position.xyz + block.position.w *
+        vec3(float(v.positionXY & 0xFFFFu), float(v.positionXY >> 16), float(v.positionZ & 0xFFFFu));
+    vec2 uv = block.uv.xy + block.uv.z * vec2(float(v.uv & 0xFFFFu), float(v.uv >> 16));
+#else
+    vec3 position = vec3(v.positionX, v.positionY, v.positionZ);
+    vec2 uv = vec2(v.u, v.v);
+#endif
+
+    vec4 world = instance.model * vec4(position, 1.0);
 
     gl_Position      = frame.viewProjection * world;
     outWorldPosition = world.xyz;
     // Rotation and uniform scale only, so the upper 3x3 carries the normal correctly; it is
     // renormalised in the fragment stage regardless.
     outWorldNormal   = (instance.model * vec4(unpackOctNormal(v.packedNormal), 0.0)).xyz;
-    outUv            = vec2(v.u, v.v);
+    outUv            = uv;
 }
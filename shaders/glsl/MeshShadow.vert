@@ -2,6 +2,25 @@
 
 // GLSL/SPIR-V port of `shadow_vertex_shader` from shaders/metal/MeshShadow.metal.
 
+#ifdef COMPACT_VERTICES
+// 16 bytes, matching CompactVertex in mesh/Mesh.hpp; see Mesh.vert.
+struct MeshVertex {
+    uint positionXY;
+    uint positionZ;
+    uint packedNormal;
+    uint uv;
+};
+
+struct VertexBlock {
+    vec4 position;        // xyz origin, w step
+    vec4 uv;              // xy origin, z step
+};
+const uint kVertexBlockShift = 8u;
+
+layout(std430, set = 0, binding = 3) readonly buffer VertexBlockBuffer {
+    VertexBlock blocks[];
+} vertexBlockBuffer;
+#else
 // 24 bytes, matching MeshVertex in mesh/Mesh.hpp. Scalar members only: a vec3 would force a
 // 32-byte stride even in std430 and read every vertex from the wrong offset.
 struct MeshVertex {
@@ -12,6 +31,7 @@ struct MeshVertex {
     float u;
     float v;
 };
+#endif
 
 layout(std430, set = 0, binding = 0) readonly buffer VertexBuffer {
     MeshVertex vertices[];
@@ -39,7 +59,16 @@ void main() {
     MeshVertex v = vertexBuffer.vertices[gl_VertexIndex];
     InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
 
-    gl_Position = pass.lightViewProjection *
-                  (instance.model * vec4(v.positionX, v.positionY, v.positionZ, 1.0));
-    outUv = vec2(v.u, v.v);
+#ifdef COMPACT_VERTICES
+    VertexBlock block = vertexBlockBuffer.blocks[uint(gl_VertexIndex) >> kVertexBlockShift];
+    vec3 position = block.position.xyz + block.position.w *
+        vec3(float(v.positionXY & 0xFFFFu), float(v.positionXY >> 16), float(v.positionZ & 0xFFFFu));
+    vec2 uv = block.uv.xy + block.uv.z * vec2(float(v.uv & 0xFFFFu), float(v.uv >> 16));
+#else
+    vec3 position = vec3(v.positionX, v.positionY, v.positionZ);
+    vec2 uv = vec2(v.u, v.v);
+#endif
+
+    gl_Position = pass.lightViewProjection * (instance.model * vec4(position, 1.0));
+    outUv = uv;
 }
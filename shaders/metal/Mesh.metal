@@ -20,6 +20,22 @@ struct MeshVertex {
     packed_float2 uv;
 };
 
+// 16 bytes: CompactVertex in mesh/Mesh.hpp, integers on the grid of the vertex's
+// block. The scene uploads one layout or the other, never both.
+struct CompactVertex {
+    packed_ushort3 position;
+    ushort         unused;
+    uint           packedNormal;
+    packed_ushort2 uv;
+};
+
+// VertexBlock: the grid each run of 2^kVertexBlockShift vertices counts on.
+struct VertexBlock {
+    float4 position;   // xyz origin, w step
+    float4 uv;         // xy origin, z step
+};
+constant uint kVertexBlockShift = 8;
+
 // One entry per drawn copy. A storage buffer, so the count is bounded by memory
 // rather than by the 16 KiB a uniform block would allow.
 struct InstanceData {
@@ -80,6 +96,21 @@ float3 unpackOctNormal(uint packed)
     return normalize(n);
 }
 
+VertexOut transformVertex(float3 position, uint packedNormal, float2 uv,
+                          InstanceData instance, constant FrameUniforms& frame)
+{
+    const float4 world = instance.model * float4(position, 1.0);
+
+    VertexOut out;
+    out.clipPosition  = frame.viewProjection * world;
+    out.worldPosition = world.xyz;
+    // Rotation and uniform scale only, so the upper 3x3 carries the normal
+    // correctly; it is renormalised in the fragment stage regardless.
+    out.worldNormal   = (instance.model * float4(unpackOctNormal(packedNormal), 0.0)).xyz;
+    out.uv            = uv;
+    return out;
+}
+
 vertex VertexOut mesh_vertex_shader(
         const device MeshVertex*   vertices  [[buffer(0)]],
         const device InstanceData* instances [[buffer(2)]],
@@ -88,19 +119,26 @@ vertex VertexOut mesh_vertex_shader(
         uint instanceId [[instance_id]])
 {
     // `vertex` is a Metal function qualifier and cannot name a local, so this is `v`.
-    MeshVertex   v = vertices[vertexId];
-    InstanceData instance = instances[instanceId];
-
-    const float4 world = instance.model * float4(float3(v.position), 1.0);
+    MeshVertex v = vertices[vertexId];
+    return transformVertex(float3(v.position), v.packedNormal, float2(v.uv),
+                           instances[instanceId], frame);
+}
 
-    VertexOut out;
-    out.clipPosition  = frame.viewProjection * world;
-    out.worldPosition = world.xyz;
-    // Rotation and uniform scale only, so the upper 3x3 carries the normal
-    // correctly; it is renormalised in the fragment stage regardless.
-    out.worldNormal   = (instance.model * float4(unpackOctNormal(v.packedNormal), 0.0)).xyz;
-    out.uv            = float2(v.uv);
-    return out;
+vertex VertexOut mesh_vertex_compact(
+        const device CompactVertex* vertices  [[buffer(0)]],
+        const device InstanceData*  instances [[buffer(2)]],
+        const device VertexBlock*   blocks    [[buffer(3)]],
+        constant FrameUniforms&     frame     [[buffer(1)]],
+        uint vertexId   [[vertex_id]],
+        uint instanceId [[instance_id]])
+{
+    CompactVertex v = vertices[vertexId];
+    VertexBlock block = blocks[vertexId >> kVertexBlockShift];
+    // An integer times a power of two is exact, and the loader puts a position
+    // two blocks share on a grid both contain, so it decodes to the same float.
+    const float3 position = block.position.xyz + block.position.w * float3(ushort3(v.position));
+    const float2 uv = block.uv.xy + block.uv.z * float2(ushort2(v.uv));
+    return transformVertex(position, v.packedNormal, uv, instances[instanceId], frame);
 }
 
 // ── BRDF ────────────────────────────────────────────────────────────────────
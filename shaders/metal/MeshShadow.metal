@@ -23,6 +23,20 @@ struct MeshVertex {
     packed_float2 uv;
 };
 
+// The compact layout and its per-block grid; see Mesh.metal.
+struct CompactVertex {
+    packed_ushort3 position;
+    ushort         unused;
+    uint           packedNormal;
+    packed_ushort2 uv;
+};
+
+struct VertexBlock {
+    float4 position;   // xyz origin, w step
+    float4 uv;         // xy origin, z step
+};
+constant uint kVertexBlockShift = 8;
+
 struct InstanceData {
     float4x4 model;
     float4   tint;
@@ -64,6 +78,26 @@ vertex ShadowVertexOut shadow_vertex_shader(
     return out;
 }
 
+vertex ShadowVertexOut shadow_vertex_compact(
+        const device CompactVertex* vertices  [[buffer(0)]],
+        const device InstanceData*  instances [[buffer(2)]],
+        const device VertexBlock*   blocks    [[buffer(3)]],
+        constant ShadowPassUniforms& pass     [[buffer(1)]],
+        uint vertexId   [[vertex_id]],
+        uint instanceId [[instance_id]])
+{
+    CompactVertex v = vertices[vertexId];
+    VertexBlock block = blocks[vertexId >> kVertexBlockShift];
+    InstanceData instance = instances[instanceId];
+
+    const float3 position = block.position.xyz + block.position.w * float3(ushort3(v.position));
+
+    ShadowVertexOut out;
+    out.clipPosition = pass.lightViewProjection * (instance.model * float4(position, 1.0));
+    out.uv = block.uv.xy + block.uv.z * float2(ushort2(v.uv));
+    return out;
+}
+
 // [[position]] on the way *in* is window space, so .z is already the depth the
 // rasteriser computed, in [0, 1] across the orthographic volume. Scaling by the
 // volume's extent turns it into world units.
@@ -0,0 +1,122 @@
+//
+// buildLods() must keep a UV seam where it is.
+//
+// The simplifier welds the vertices either side of a seam into one position and lets a seam
+// position collapse only along the seam. Two seams one edge apart are where that goes wrong if
+// "along the seam" is read as "onto another seam position": the interior edge joining them has a
+// seam position at each end, and collapsing across it drags one seam onto the other and stretches
+// the texture on both sides.
+//
+// The mesh here is a flat grid cut into three charts by two seams in adjacent columns, every
+// chart with texture coordinates of its own. A collapse that keeps to the seams leaves each
+// triangle of every level with the corners of one chart; one across the gap between the seams
+// leaves triangles with corners from two. Flat, so every collapse costs nothing and the
+// simplifier is free to choose the wrong one.
+//
+
+#include "mesh/Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// FbxLoader.cpp inflates with stb_image's zlib decoder, as in tools/loadbench/LoadBench.cpp.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+
+    constexpr uint32_t kQuads = 32;
+    /// The seams run down these columns of grid points; the edges between them are interior.
+    constexpr uint32_t kSeamColumns[2] = { 15, 16 };
+    /// Texture coordinates of chart c start at c * kChartOffset, so the chart can be read back.
+    constexpr float kChartOffset = 10.0f;
+
+    /// @brief A grid of kQuads x kQuads quads in the XZ plane, cut into charts at the seams.
+    dmrender::Mesh makeSeamedGrid()
+    {
+        using namespace dmrender;
+        Mesh mesh;
+        const uint32_t normal = packNormal(0.0f, 1.0f, 0.0f);
+
+        // vertexAt[chart][point]: the point's vertex in that chart, or ~0u where it has none.
+        std::vector<uint32_t> vertexAt[3];
+        for (uint32_t chart = 0; chart < 3; ++chart) {
+            vertexAt[chart].assign((kQuads + 1) * (kQuads + 1), ~0u);
+            const uint32_t firstColumn = chart == 0 ? 0 : kSeamColumns[chart - 1];
+            const uint32_t lastColumn = chart == 2 ? kQuads : kSeamColumns[chart];
+            for (uint32_t row = 0; row <= kQuads; ++row) {
+                for (uint32_t column = firstColumn; column <= lastColumn; ++column) {
+                    MeshVertex vertex{};
+                    vertex.position[0] = static_cast<float>(column);
+                    vertex.position[2] = static_cast<float>(row);
+                    vertex.packedNormal = normal;
+                    vertex.uv[0] = chart * kChartOffset + column / static_cast<float>(kQuads);
+                    vertex.uv[1] = row / static_cast<float>(kQuads);
+                    vertexAt[chart][row * (kQuads + 1) + column] = static_cast<uint32_t>(mesh.vertices.size());
+                    mesh.vertices.push_back(vertex);
+                }
+            }
+        }
+
+        for (uint32_t row = 0; row < kQuads; ++row) {
+            for (uint32_t column = 0; column < kQuads; ++column) {
+                const uint32_t chart = column < kSeamColumns[0] ? 0 : column < kSeamColumns[1] ? 1 : 2;
+                const std::vector<uint32_t>& at = vertexAt[chart];
+                const uint32_t a = at[row * (kQuads + 1) + column];
+                const uint32_t b = at[row * (kQuads + 1) + column + 1];
+                const uint32_t c = at[(row + 1) * (kQuads + 1) + column + 1];
+                const uint32_t d = at[(row + 1) * (kQuads + 1) + column];
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, a, d, c });
+            }
+        }
+
+        MeshSubset subset;
+        subset.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        for (const MeshVertex& vertex : mesh.vertices) {
+            for (int axis = 0; axis < 3; ++axis) {
+                subset.boundsMin[axis] = std::min(subset.boundsMin[axis], vertex.position[axis]);
+                subset.boundsMax[axis] = std::max(subset.boundsMax[axis], vertex.position[axis]);
+            }
+        }
+        mesh.subsets.push_back(subset);
+        return mesh;
+    }
+
+} // namespace
+
+int main()
+{
+    dmrender::Mesh mesh = makeSeamedGrid();
+    dmrender::buildLods(mesh);
+
+    const dmrender::MeshSubset& subset = mesh.subsets[0];
+    if (subset.lodCount == 0) {
+        std::fprintf(stderr, "FAIL: the grid was not simplified at all\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (uint32_t l = 0; l < subset.lodCount; ++l) {
+        const dmrender::MeshLod& lod = mesh.lods[subset.firstLod + l];
+        size_t mixed = 0;
+        for (uint32_t i = lod.firstIndex; i + 2 < lod.firstIndex + lod.indexCount; i += 3) {
+            int charts[3];
+            for (int k = 0; k < 3; ++k) {
+                charts[k] = static_cast<int>(std::floor(mesh.vertices[mesh.indices[i + k]].uv[0] / kChartOffset));
+            }
+            if (charts[0] != charts[1] || charts[1] != charts[2]) ++mixed;
+        }
+        std::fprintf(stderr, "level %u: %u triangles, %zu across a seam\n",
+                     l + 1, lod.indexCount / 3, mixed);
+        if (mixed > 0) ++failures;
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "FAIL: %d of %u levels collapsed a seam across an interior edge\n",
+                     failures, subset.lodCount);
+        return 1;
+    }
+    std::fprintf(stderr, "OK\n");
+    return 0;
+}
@@ -0,0 +1,285 @@
+//
+// Timing the loaders without a renderer.
+//
+// RenderingApp prints how long a scene took to load, but getting it to print anything takes the
+// wrapper, a window and a GPU, so loader changes were measured on whatever machine had all three
+// and regressions surfaced on users' machines instead. This program links the mesh/ sources and
+// nothing else, and runs on any box that can build them:
+//
+//     dmrender_loadbench [--repeat N] [--output report.json] scene.obj other.fbx ...
+//
+// Every file goes through the three things a start does, N times over:
+//
+//     load       loadMesh(): parse the source and run the load passes. This is a cold start, the
+//                one every user sees the first time they open a scene.
+//     saveCache  saveSceneCache(): write the .dmcache beside the source, as the application does.
+//     loadCache  loadSceneCache(): read it back. This is a warm start, every time after the first.
+//
+// The report is JSON on stdout (or the --output file): every repetition's time, the first one
+// separately — the only one that may have found the source outside the OS page cache — the median,
+// throughput in MB/s of file read and in triangles per second, and the process's peak resident
+// memory, together with loadMesh()'s own LoadStats breakdown of the last run. The loaders' notes
+// still go to stderr, so the two never mix.
+//
+// The cache written here is the same file the application would have written, so running this over
+// a scene leaves it ready to open quickly; it replaces any cache already there.
+//
+
+#include "mesh/Mesh.hpp"
+#include "mesh/LoadSupport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// FbxLoader.cpp inflates compressed arrays with stb_image's zlib decoder. In the application the
+// implementation is compiled into TextureCache.cpp, which needs the wrapper; here it goes in the
+// one file of this program that has nothing else to do with images.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // ─────────────────────────────────────────────────────────────────────────
+    // Measurements
+    // ─────────────────────────────────────────────────────────────────────────
+
+    /// @brief Every repetition of one phase for one file.
+    struct Phase {
+        std::vector<double> seconds;
+
+        double median() const
+        {
+            if (seconds.empty()) return 0.0;
+            std::vector<double> sorted = seconds;
+            std::sort(sorted.begin(), sorted.end());
+            const size_t middle = sorted.size() / 2;
+            return sorted.size() % 2 ? sorted[middle] : 0.5 * (sorted[middle - 1] + sorted[middle]);
+        }
+    };
+
+    struct FileResult {
+        std::string path;
+        std::string format;
+        std::string error;                 ///< empty if the file loaded
+        uintmax_t sourceBytes = 0;
+        uintmax_t cacheBytes = 0;
+        size_t vertices = 0;
+        size_t triangles = 0;
+        size_t subsets = 0;
+        size_t geometryBytes = 0;
+        bool cacheMatches = true;          ///< the cache read back the same counts loadMesh produced
+        Phase load, saveCache, loadCache;
+        dmrender::LoadStats loadStats;     ///< loadMesh()'s own breakdown, from the last run
+        size_t peakResidentBytes = 0;      ///< process peak after this file, so it never decreases
+    };
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    FileResult benchmarkFile(const std::filesystem::path& path, int repeat)
+    {
+        FileResult result;
+        result.path = path.string();
+        result.sourceBytes = dmrender::fileBytes(path);
+
+        for (int run = 0; run < repeat; ++run) {
+            std::fprintf(stderr, "%s: run %d of %d\n", path.filename().string().c_str(), run + 1, repeat);
+
+            std::string error;
+            auto start = Clock::now();
+            dmrender::Mesh mesh = dmrender::loadMesh(path, error);
+            result.load.seconds.push_back(secondsSince(start));
+            if (mesh.empty()) {
+                result.error = error.empty() ? "loaded nothing" : error;
+                return result;
+            }
+            result.format = mesh.sourceFormat;
+            result.vertices = mesh.vertices.size();
+            result.triangles = mesh.triangleCount();
+            result.subsets = mesh.subsets.size();
+            result.geometryBytes = mesh.geometryBytes();
+            result.loadStats = mesh.loadStats;
+
+            start = Clock::now();
+            const bool saved = dmrender::saveSceneCache(path, mesh);
+            result.saveCache.seconds.push_back(secondsSince(start));
+            if (!saved) {
+                result.error = "could not write " + dmrender::sceneCachePath(path).string();
+                return result;
+            }
+            result.cacheBytes = dmrender::fileBytes(dmrender::sceneCachePath(path));
+            mesh = dmrender::Mesh{};
+
+            dmrender::Mesh cached;
+            start = Clock::now();
+            const bool hit = dmrender::loadSceneCache(path, cached);
+            result.loadCache.seconds.push_back(secondsSince(start));
+            if (!hit) {
+                result.error = "the cache just written was rejected on reading";
+                return result;
+            }
+            result.cacheMatches = result.cacheMatches
+                               && cached.vertices.size() == result.vertices
+                               && cached.triangleCount() == result.triangles
+                               && cached.subsets.size() == result.subsets;
+        }
+        return result;
+    }
+
+    // ─────────────────────────────────────────────────────────────────────────
+    // Report
+    // ─────────────────────────────────────────────────────────────────────────
+
+    std::string jsonString(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (const char c : text) {
+            switch (c) {
+                case '"':  quoted += "\\\""; break;
+                case '\\': quoted += "\\\\"; break;
+                case '\n': quoted += "\\n"; break;
+                case '\t': quoted += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        quoted += escaped;
+                    } else {
+                        quoted += c;
+                    }
+            }
+        }
+        return quoted + "\"";
+    }
+
+    /// @brief One phase: its times, and throughput at the median over @p bytes and @p triangles.
+    void writePhase(std::FILE* out, const char* name, const Phase& phase,
+                    uintmax_t bytes, size_t triangles, bool last)
+    {
+        const double median = phase.median();
+        std::fprintf(out, "        \"%s\": {\"seconds\": [", name);
+        for (size_t i = 0; i < phase.seconds.size(); ++i) {
+            std::fprintf(out, "%s%.6f", i ? ", " : "", phase.seconds[i]);
+        }
+        std::fprintf(out, "], \"first\": %.6f, \"median\": %.6f, \"mbPerSecond\": %.2f, "
+                          "\"trianglesPerSecond\": %.0f}%s\n",
+                     phase.seconds.empty() ? 0.0 : phase.seconds.front(), median,
+                     median > 0.0 ? bytes / 1e6 / median : 0.0,
+                     median > 0.0 ? triangles / median : 0.0,
+                     last ? "" : ",");
+    }
+
+    void writeReport(std::FILE* out, int repeat, const std::vector<FileResult>& results)
+    {
+        std::fprintf(out, "{\n  \"repeat\": %d,\n  \"files\": [\n", repeat);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const FileResult& r = results[i];
+            std::fprintf(out, "    {\n      \"path\": %s,\n", jsonString(r.path).c_str());
+            if (!r.error.empty()) {
+                std::fprintf(out, "      \"error\": %s,\n", jsonString(r.error).c_str());
+            }
+            std::fprintf(out,
+                         "      \"format\": %s,\n"
+                         "      \"sourceBytes\": %ju,\n"
+                         "      \"cacheBytes\": %ju,\n"
+                         "      \"vertices\": %zu,\n"
+                         "      \"triangles\": %zu,\n"
+                         "      \"subsets\": %zu,\n"
+                         "      \"geometryBytes\": %zu,\n"
+                         "      \"cacheMatches\": %s,\n"
+                         "      \"phases\": {\n",
+                         jsonString(r.format).c_str(), r.sourceBytes, r.cacheBytes,
+                         r.vertices, r.triangles, r.subsets, r.geometryBytes,
+                         r.cacheMatches ? "true" : "false");
+            // Parsing reads the source file; reading the cache reads the cache, and writing it
+            // writes as much.
+            writePhase(out, "load", r.load, r.sourceBytes, r.triangles, false);
+            writePhase(out, "saveCache", r.saveCache, r.cacheBytes, r.triangles, false);
+            writePhase(out, "loadCache", r.loadCache, r.cacheBytes, r.triangles, true);
+            std::fprintf(out, "      },\n      \"loadStats\": {\"cornersRead\": %zu, \"verticesAfterDedup\": %zu, "
+                              "\"phases\": {",
+                         r.loadStats.cornersRead, r.loadStats.verticesAfterDedup);
+            for (size_t p = 0; p < r.loadStats.phases.size(); ++p) {
+                std::fprintf(out, "%s%s: %.6f", p ? ", " : "",
+                             jsonString(r.loadStats.phases[p].name).c_str(), r.loadStats.phases[p].seconds);
+            }
+            std::fprintf(out, "}},\n      \"peakResidentBytes\": %zu\n    }%s\n",
+                         r.peakResidentBytes, i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ],\n  \"peakResidentBytes\": %zu\n}\n", dmrender::peakResidentBytes());
+    }
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+                     "usage: dmrender_loadbench [--repeat N] [--output report.json] model...\n"
+                     "  Times loadMesh, saveSceneCache and loadSceneCache over each model N times\n"
+                     "  (default 3) and prints a JSON report. Writes each model's .dmcache.\n");
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int repeat = 3;
+    std::string outputPath;
+    std::vector<std::filesystem::path> models;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "--repeat" || arg == "-n") && i + 1 < argc) {
+            repeat = std::atoi(argv[++i]);
+        } else if ((arg == "--output" || arg == "-o") && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::fprintf(stderr, "unknown option: %s\n", arg.c_str());
+            printUsage();
+            return 2;
+        } else {
+            models.emplace_back(arg);
+        }
+    }
+    if (models.empty() || repeat < 1) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<FileResult> results;
+    bool failed = false;
+    for (const std::filesystem::path& model : models) {
+        results.push_back(benchmarkFile(model, repeat));
+        results.back().peakResidentBytes = dmrender::peakResidentBytes();
+        if (!results.back().error.empty()) {
+            std::fprintf(stderr, "%s: %s\n", model.string().c_str(), results.back().error.c_str());
+            failed = true;
+        } else if (!results.back().cacheMatches) {
+            std::fprintf(stderr, "%s: the cache read back a different mesh\n", model.string().c_str());
+            failed = true;
+        }
+    }
+
+    std::FILE* out = stdout;
+    if (!outputPath.empty()) {
+        out = std::fopen(outputPath.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+            return 1;
+        }
+    }
+    writeReport(out, repeat, results);
+    if (out != stdout) std::fclose(out);
+
+    // A failed load fails the run, so a CI job can use the exit code alone.
+    return failed ? 1 : 0;
+}